@@ -0,0 +1,161 @@
+/**
+ * @file raster_bench.cpp
+ * @brief 光栅安全服务基准测试 - 在仿真控制器上按 IO 数 x 机器人数矩阵测量周期、触发到暂停、复位到恢复与锁持有时间
+ *
+ * 用法: raster_bench [--trips N] [--call-latency-us US] [--json]
+ *   --trips            每个矩阵单元的触发/复位次数 (缺省 20)
+ *   --call-latency-us  仿真控制器每次调用的耗时 (缺省 200, 模拟 NRC 接口开销)
+ *   --json             每个单元额外输出完整的 get_metrics JSON
+ * 结果表输出到 stderr (stdout 上是服务自身的控制台日志). 服务会在当前目录下创建配置与日志目录，请在临时目录中运行.
+ */
+
+#include "raster_safety_ext.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int IO_COUNTS[] = {4, 16, 64, 256, 1024, 2048};
+const int ROBOT_COUNTS[] = {2, 4, 8};
+const int TRIP_IO = 1;           // 每次触发使用的 IO (自动复位: reset_io_index 为 0)
+const int SETTLE_MS = 300;       // 配置更换后等待状态稳定
+const int QUIET_MS = 500;        // 无触发窗口, 用于测量稳态周期
+const int TRIP_HOLD_MS = 150;    // 触发保持时间 (大于仿真暂停延迟)
+const int RELEASE_HOLD_MS = 150; // 释放后等待恢复完成
+
+void sleep_ms(int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void control(const Json::Value& request) {
+    rasterSafetyControl(request);
+}
+
+void set_robots(int robot_count) {
+    Json::Value request;
+    request["operation"] = "set_robot_config";
+    for (int id = 1; id <= robot_count; ++id) request["robot_ids"].append(id);
+    control(request);
+}
+
+void set_lock_profiling(bool enabled) {
+    Json::Value request;
+    request["operation"] = "set_lock_profiling";
+    request["enabled"] = enabled;
+    control(request);
+}
+
+bool start_simulation(int call_latency_us) {
+    Json::Value config;
+    config["call_latency_us"] = call_latency_us;
+    std::string error;
+    if (!rasterSafetyStartSimulation(config, error)) {
+        std::fprintf(stderr, "仿真启动失败: %s\n", error.c_str());
+        return false;
+    }
+    return true;
+}
+
+void configure_io(int io_count) {
+    std::vector<IOConfig> config;
+    config.reserve(io_count);
+    for (int io = 1; io <= io_count; ++io) {
+        config.push_back(IOConfig(io, 0, 1, "bench io " + std::to_string(io)));
+    }
+    updateIOConfig(config, 40);
+}
+
+double p99_ms(const Json::Value& hist) {
+    return hist["p99_us"].asUInt64() / 1000.0;
+}
+
+double max_ms(const Json::Value& hist) {
+    return hist["max_us"].asUInt64() / 1000.0;
+}
+
+// 单元结果一行: 周期 p50/p99, 触发到暂停 p99/max, 复位到恢复 p99/max, io_mutex 最长持有
+void print_row(int io_count, int robot_count, const Json::Value& metrics) {
+    const Json::Value& cycle = metrics["cycle_duration"];
+    const Json::Value& paused = metrics["trip_to_paused"];
+    const Json::Value& resumed = metrics["reset_to_resumed"];
+    const Json::Value& longest = metrics["io_mutex"]["longest_hold"];
+    std::fprintf(stderr, "%6d %6d %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f  %s\n",
+                io_count, robot_count,
+                cycle["p50_us"].asUInt64() / 1000.0, p99_ms(cycle),
+                p99_ms(paused), max_ms(paused),
+                p99_ms(resumed), max_ms(resumed),
+                longest["hold_us"].asUInt64() / 1000.0, longest["site"].asString().c_str());
+    std::fflush(stderr);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int trips = 20;
+    int call_latency_us = 200;
+    bool print_json = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--trips") == 0 && i + 1 < argc) {
+            trips = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--call-latency-us") == 0 && i + 1 < argc) {
+            call_latency_us = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            print_json = true;
+        } else {
+            std::fprintf(stderr, "用法: %s [--trips N] [--call-latency-us US] [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // 先安装仿真后端, 服务启动时的首次读取就不会落到 NRC 接口上
+    if (!start_simulation(call_latency_us)) return 1;
+    std::thread service(rasterSafetyService);
+    sleep_ms(SETTLE_MS);
+
+    std::fprintf(stderr, "%6s %6s %10s %10s %10s %10s %10s %10s %10s  %s\n",
+                "io", "robots", "cycle_p50", "cycle_p99", "pause_p99", "pause_max",
+                "resume_p99", "resume_max", "hold_max", "hold_site");
+    std::fprintf(stderr, "%13s (ms)\n", "");
+    bool ok = true;
+    Json::StreamWriterBuilder writer;
+    for (int robot_count : ROBOT_COUNTS) {
+        for (int io_count : IO_COUNTS) {
+            set_robots(robot_count);
+            // 机器人列表变化后重新安装仿真, 新的受控机器人全部处于运行状态
+            if (!start_simulation(call_latency_us)) {
+                ok = false;
+                break;
+            }
+            configure_io(io_count);
+            sleep_ms(SETTLE_MS);
+            set_lock_profiling(true);
+            rasterSafetyGetMetrics(true);
+
+            sleep_ms(QUIET_MS);
+            for (int n = 0; n < trips; ++n) {
+                rasterSafetySimSetIO(TRIP_IO, true);
+                sleep_ms(TRIP_HOLD_MS);
+                rasterSafetySimSetIO(TRIP_IO, false);
+                sleep_ms(RELEASE_HOLD_MS);
+            }
+
+            Json::Value metrics = rasterSafetyGetMetrics(true);
+            set_lock_profiling(false);
+            print_row(io_count, robot_count, metrics);
+            if (print_json) {
+                std::fprintf(stderr, "%s\n", Json::writeString(writer, metrics).c_str());
+            }
+        }
+        if (!ok) break;
+    }
+
+    rasterSafetyStopSimulation();
+    stopRasterSafetyService();
+    service.join();
+    return ok ? 0 : 1;
+}
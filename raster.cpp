@@ -6,13 +6,16 @@
 
 // 包含必要的头文件
 #include "rasterSafety.h"
+#include "raster_safety_ext.h" // 后端函数表、仿真控制器等扩展入口
 #include "../nrcAPI.h" // 假设提供 NRC_* 函数
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/rotating_file_sink.h>
-#include <nlohmann/json.hpp> // 文件配置使用 nlohmann/json，外部API使用 JsonCpp
+#include <spdlog/async.h>    // 异步日志: 格式化后的消息交由后台线程写入 sink
+#include <json/json.h>       // 配置文件与外部 API 统一使用 JsonCpp
 #include <iostream>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <thread>
 #include <fstream>
@@ -22,22 +25,35 @@
 #include <errno.h>
 #include <cstring>
 #include <signal.h>
-#include <map>          // 包含 map 用于 robot_states
+#include <pthread.h>    // 监测线程实时调度与 CPU 绑定
+#include <sched.h>
+#include <sys/mman.h>   // mlockall, 事件日志文件映射
+#include <fcntl.h>      // 事件日志文件 open
+#include <time.h>       // clock_nanosleep
 #include <string>       // 用于 std::string 和 std::to_string
 #include <sstream>      // 备用，某些复杂拼接可能用得上
 #include <chrono>       // 用于 std::chrono::milliseconds
+#include <algorithm>    // 用于 std::min
+#include <array>        // CRC32 查找表
+#include <bitset>       // IO 快照位图
+#include <cstdint>      // 位运算评估内核使用的 uint64_t
+#include <cstddef>      // offsetof (二进制配置快照头部校验)
+#include <iterator>     // istreambuf_iterator (一次读入配置文件)
+#include <cmath>        // 直方图分位数计算
+#include <memory>       // 状态快照使用 std::shared_ptr
+#include <utility>      // std::pair (去抖配置列表)
+#include <unordered_map> // 描述字符串驻留
+#include <cstdarg>      // 通知消息格式化 (vsnprintf)
+#include <cstdio>
 #include <vector>       // For std::vector (already in header, but good practice)
 #include <ctime>        // For time_t (already in header, but good practice)
 
-
-// 文件配置使用 nlohmann/json
-using json = nlohmann::json;
-
 // 内部全局变量
 namespace {
     // 配置目录和文件名
     const std::string CONFIG_DIR = "raster_config";
     const std::string CONFIG_FILE_NAME = "raster_safety_config.json"; // 假设机器人对使用一个配置文件
+    const std::string CELL_CONFIG_DIR = CONFIG_DIR + "/cells";         // 各安全单元的配置文件与日志
 
     // 状态机状态
     enum SystemState {
@@ -52,716 +68,5091 @@ namespace {
     std::atomic<bool> limited_state_message_sent_this_cycle{false};
     std::atomic<bool> normal_state_message_sent_this_cycle{false};
 
-    // 机器人状态 - 受控机器人各自的信息
-    struct RobotState {
+    const size_t JOB_NAME_CAPACITY = 64; // 作业名缓冲区预留容量 (字节)，更长的作业名仍可存放
+
+    // 机器人状态 - 受控机器人各自的信息. 每个条目独占缓存行，避免相邻条目的伪共享.
+    struct alignas(64) RobotState {
         int current_run_status;      // 0:停止 1:暂停 2:运行 (来自 NRC 的快照)
+        int64_t status_checked_ns;   // 本线程最近一次查询得到 current_run_status 的时刻 (steady_clock 纳秒)
         std::string last_job_name;   // 由此安全模块暂停的作业名
+        std::string cached_job_name; // 后台预取的当前打开作业名 (仅运行中有效，空表示未知)，暂停路径直接使用
+        std::string job_check;       // 暂停确认后复核作业名的缓冲区
         bool message_sent_limited;   // 在 LIMITED 状态周期内，发送暂停消息的标志
         bool message_sent_recovered; // 在 LIMITED 恢复到 NORMAL 状态周期内，发送恢复消息的标志
+        bool paused_for_speed;       // 限速失败后改为暂停，由限速解除时恢复
+
+        // 作业名缓冲区预留容量，暂停时直接写入，转换期间不再分配
+        RobotState() : current_run_status(0), status_checked_ns(0), message_sent_limited(false), message_sent_recovered(false), paused_for_speed(false) {
+            last_job_name.reserve(JOB_NAME_CAPACITY);
+            cached_job_name.reserve(JOB_NAME_CAPACITY);
+            job_check.reserve(JOB_NAME_CAPACITY);
+        }
+    };
+    // 机器人 ID 上限. 受控机器人集合以位掩码表示 (位 i 对应机器人 i，位 0 不使用).
+    const int MAX_ROBOT_ID = 31;
+    // 按机器人 ID 直接索引的状态表. 归动作执行线程所有，只在该线程中访问，不加锁.
+    RobotState robot_table[MAX_ROBOT_ID + 1];
+    uint32_t robot_table_mask = 0; // 状态表当前对应的受控集合 (同样只在动作执行线程中访问，服务重启后保留)
+    // 运行状态刷新线程观察到的机器人运行状态 (刷新线程单写，任意线程无锁读取; 0 亦表示尚未观察).
+    // 观察值用于作业名预取，以及在暂停命令发出后区分由本模块暂停的机器人; 恢复前动作执行线程仍自行查询.
+    std::atomic<int> observed_run_status[MAX_ROBOT_ID + 1];
+    // 上述观察值对应查询的发起时刻 (steady_clock 纳秒). 刷新线程先写状态后写时刻，读取方先读时刻后读状态.
+    std::atomic<int64_t> observed_run_status_ns[MAX_ROBOT_ID + 1];
+    // 观察到运行状态变化、需要重新预取作业名的机器人 (刷新线程置位，动作执行线程取走)
+    std::atomic<uint32_t> run_status_changed_mask{0};
+
+    // 运行状态刷新线程 - 以低优先级 (SCHED_BATCH) 自适应轮询受控机器人的运行状态，监测线程不再逐周期查询.
+    // 状态变化或动作前后按快速周期轮询，状态不变时周期逐步加倍直至慢速周期.
+    const int RUN_STATUS_FAST_MS = 50;
+    const int RUN_STATUS_SLOW_MS = 1000;
+    std::mutex run_status_mutex;           // 保护以下两个标志 (叶子锁)
+    std::condition_variable run_status_cv;
+    bool run_status_running = false;
+    bool run_status_kicked = false;        // 机器人刚发生或即将发生状态转换，立即按快速周期轮询
+    std::thread* run_status_thread = nullptr;
+    const int JOB_NAME_REFRESH_MS = 1000; // 运行中机器人的作业名周期预取间隔
+
+    // IO 去抖 - 按 IO 号配置的触发/复位滤波 (缺省不滤波). 触发需最近 trigger_samples 个采样连续满足且持续
+    // trigger_min_ms; 已触发的 IO 需复位条件持续 reset_holdoff_ms 才复位. 触发条件在 debounce_max_delay_ms 内
+    // 反复出现 (抖动) 时，自首次满足起达到 debounce_max_delay_ms 后的下一个满足采样即强制触发，保证滤波对真实触发的延迟有上界;
+    // 强制触发的 IO 被锁存: 复位条件须持续 max(reset_holdoff_ms, debounce_max_delay_ms) 才复位，抖动期间保持已触发.
+    struct IODebounce {
+        int trigger_samples = 1;   // 1 表示不按样本数过滤 (最多 DEBOUNCE_MAX_SAMPLES)
+        int trigger_min_ms = 0;    // 触发条件最短持续时间，不超过 debounce_max_delay_ms
+        int reset_holdoff_ms = 0;  // 复位条件最短持续时间
+    };
+    const int DEBOUNCE_MAX_SAMPLES = 64;               // 每个 IO 的采样历史位数
+    const int DEBOUNCE_MAX_DELAY_DEFAULT_MS = 20;
+    const int DEBOUNCE_MAX_DELAY_LIMIT_MS = 100;       // debounce_max_delay_ms 的配置上限
+    const int DEBOUNCE_RESET_HOLDOFF_LIMIT_MS = 10000;
+    // 去抖滤波状态 (按槽位). history 为最近采样的触发条件位 (最低位为最新采样).
+    struct IODebounceState {
+        uint64_t history = 0;
+        bool asserting = false;    // 未触发的 IO 触发条件满足、尚在滤波中 (短暂脱落不结束)
+        bool resetting = false;    // 已触发的 IO 复位条件满足、尚在保持期中
+        bool forced = false;       // 本次触发由延迟上界强制接受 (锁存，按较长的保持期复位)
+        std::chrono::steady_clock::time_point assert_since; // 本次滤波首次满足触发条件的时间
+        std::chrono::steady_clock::time_point last_assert;  // 最近一次满足触发条件的时间
+        std::chrono::steady_clock::time_point reset_since;
+    };
 
-        RobotState() : current_run_status(0), message_sent_limited(false), message_sent_recovered(false) {}
+    // IO 配置表 - 已配置条目按 io_index 升序紧凑存放，热路径只遍历已配置条目 (通常 4-16 个)
+    // slot_by_index 按 IO 号 (0-2048) 映射到 entries 下标，未配置为 -1，用于按 IO 号查找
+    // read_set 为每周期需要读取的 IO 号 (触发 IO 与复位 IO，升序去重)，随配置变化重建
+    // 其余为按槽位 (entries 下标) 打包的数据，供位运算评估内核使用，随配置变化重建;
+    // triggered_mask 与 entries[i].already_triggered 保持同步.
+    // descriptions 为配置装载时驻留的描述字符串 (去重，只读共享)，发布状态快照时只复制下标.
+    typedef std::vector<std::string> DescriptionTable;
+    struct IOTable {
+        std::vector<IOConfig> entries;
+        std::vector<int> slot_by_index;
+        std::vector<int> read_set;
+        std::shared_ptr<const DescriptionTable> descriptions;
+        std::vector<uint32_t> description_id;   // 各槽位描述在 descriptions 中的下标
+
+        std::vector<uint16_t> trigger_io;       // 各槽位的触发 IO 号
+        std::vector<uint16_t> reset_io;         // 各槽位的复位 IO 号 (0 表示无专用复位 IO)
+        std::vector<uint64_t> valid_mask;       // 有效槽位 (最后一个字的多余高位为 0)
+        std::vector<uint64_t> polarity_mask;    // 触发值为 1 的槽位
+        std::vector<uint64_t> reset_io_mask;    // 配置了专用复位 IO 的槽位
+        std::vector<uint64_t> triggered_mask;   // already_triggered 为 true 的槽位
+
+        // 去抖: 按槽位的参数副本与滤波状态. debounce_version 与 io_debounce_version 不一致时在评估前重建.
+        std::vector<uint64_t> debounce_mask;    // 配置了去抖的槽位
+        std::vector<IODebounce> debounce_cfg;
+        std::vector<IODebounceState> debounce_state;
+        unsigned debounce_version = ~0u;
+
+        IOTable() : slot_by_index(2049, -1) {}
     };
-    // map 机器人ID (1, 2) 到其状态. 受 io_mutex 保护.
-    std::map<int, RobotState> robot_states;
+    IOTable io_table;
 
-    // IO 配置 - 按 IO 号索引 (0-2048)
-    // 未配置条目使用结构体的默认构造函数 (-1 io_index, is_configured=false)
-    std::vector<IOConfig> io_list_indexed(2049);
+    // IO 快照 - 一次集中读取的布尔变量值，按 IO 号 (0-2048) 存放.
+    // 每周期的所有判断 (触发 IO 与其复位 IO) 都基于同一快照，避免分散读取造成的前后不一致.
+    struct IOSnapshot {
+        std::bitset<2049> values;
+    };
+
+    // 位运算评估内核的工作字 (按槽位打包). 由调用线程持有并跨周期复用，避免重复分配.
+    struct IOEvalWords {
+        std::vector<uint64_t> value;            // 触发 IO 当前值
+        std::vector<uint64_t> reset_value;      // 复位 IO 当前值
+        std::vector<uint64_t> newly_triggered;  // 本周期新触发的槽位
+        std::vector<uint64_t> newly_reset;      // 本周期复位的槽位
+        bool debounce_pending = false;          // 有 IO 正在去抖滤波中 (监测线程应保持快速采样)
+    };
+
+    // 去抖配置 (按 IO 号) 与触发延迟上界. 受 io_mutex 保护. 修改后递增 io_debounce_version.
+    // debounce_list 为同一配置的非缺省条目列表 (按 IO 号升序)，随配置重建，状态快照直接共享.
+    std::vector<IODebounce> io_debounce(2049);
+    int debounce_max_delay_ms = DEBOUNCE_MAX_DELAY_DEFAULT_MS;
+    unsigned io_debounce_version = 0;
 
-    // 存储配置文件或API传入的限速值 (实际动作总是暂停/恢复)
+    // 存储配置文件或API传入的限速值 (%). 限速区域 (action = limit_speed) 受限时把机器人速度倍率降到此值，
+    // 其余区域仍为暂停/恢复.
     int configured_limited_speed = 30;
 
     // 线程管理
-    // 互斥锁，用于访问 io_list_indexed, configured_limited_speed, robot_states, current_system_state (更新时)
-    std::mutex io_mutex;
+    // io_mutex 的加锁调用点. 锁剖析按调用点分别统计等待/持有时间.
+    enum LockSite : uint8_t {
+        LOCK_SITE_MONITOR,           // io_monitor_thread
+        LOCK_SITE_MONITOR_SETTINGS,  // update_monitor_settings
+        LOCK_SITE_ROBOT_CONFIG,      // update_robot_config
+        LOCK_SITE_ZONE_CONFIG,       // update_zone_config
+        LOCK_SITE_CELL_CONFIG,       // update_cell_robots / add_cell / remove_cell
+        LOCK_SITE_DEBOUNCE_CONFIG,   // update_debounce_config
+        LOCK_SITE_UPDATE_IO_CONFIG,  // updateIOConfig
+        LOCK_SITE_IO_EDIT,           // apply_io_config_edits
+        LOCK_SITE_RESET_SPEED,       // resetSpeed
+        LOCK_SITE_LIMITED_SPEED,     // getCurrentLimitedSpeed
+        LOCK_SITE_SERVICE_START,     // rasterSafetyService
+        LOCK_SITE_COUNT
+    };
+    const char* const LOCK_SITE_NAMES[LOCK_SITE_COUNT] = {
+        "io_monitor_thread", "update_monitor_settings", "update_robot_config", "update_zone_config",
+        "update_cell_config", "update_debounce_config", "updateIOConfig", "apply_io_config_edits", "resetSpeed",
+        "getCurrentLimitedSpeed", "rasterSafetyService"
+    };
+    // 可剖析的互斥锁. 剖析关闭时在 std::mutex 之外只多一次原子读取与持有者记录;
+    // 开启后 (set_lock_profiling) 记录每个调用点的等待/持有时间与等待时的持有者 (lock_site_stats).
+    // 通过 ProfiledLock 按调用点加锁.
+    class ProfiledMutex {
+    public:
+        void lock(LockSite site);
+        void unlock();
+    private:
+        std::mutex mutex_;
+        std::atomic<int> holder_{-1};  // 当前持有的调用点，-1 表示空闲. 等待者无锁读取.
+        bool profiled_ = false;        // 本次持有是否计时 (仅持有者访问)
+        std::chrono::steady_clock::time_point acquired_at_;
+    };
+    // 按调用点加锁的 RAII 守卫，lock/unlock 用法与 std::unique_lock 相同
+    class ProfiledLock {
+    public:
+        ProfiledLock(ProfiledMutex& mutex, LockSite site) : mutex_(mutex), site_(site) { lock(); }
+        ~ProfiledLock() { if (owns_) mutex_.unlock(); }
+        ProfiledLock(const ProfiledLock&) = delete;
+        ProfiledLock& operator=(const ProfiledLock&) = delete;
+        void lock() { mutex_.lock(site_); owns_ = true; }
+        void unlock() { mutex_.unlock(); owns_ = false; }
+    private:
+        ProfiledMutex& mutex_;
+        LockSite site_;
+        bool owns_ = false;
+    };
+    // 共享状态按所有者划分为以下几个域:
+    //   配置      - IO 配置表、限速与区域等由请求线程在锁外整表构建，经 pending_io_config 交给监测线程切换;
+    //               读者 (get_config、保存、推送) 只读取 RCU 方式发布的不可变状态快照，不获取 io_mutex.
+    //   触发状态  - already_triggered / triggered_mask / 系统状态只由监测线程在 io_mutex 内修改;
+    //               人工复位经 pending_reset 交给监测线程基于同一 IO 快照执行.
+    //   机器人    - robot_table 归动作执行线程所有，不加锁; 运行状态刷新线程采样的运行状态写入 observed_run_status.
+    // io_mutex 保护 io_table、configured_limited_speed 与 current_system_state 的修改，正常运行时只有监测线程
+    // 获取; 请求线程仅在监测线程未运行或未及时接管 (IO_CONFIG_INSTALL_WAIT_MS) 时自行持锁安装/复位.
+    // 锁顺序 (左侧可在持有时获取右侧，反之不可):
+    //   config_update_mutex / reset_request_mutex -> io_mutex
+    //   io_mutex -> config_install_mutex / config_file_mutex / status_push_mutex / action_mutex
+    //   control_writer_mutex -> config_save_mutex
+    // monitor_wait_mutex、run_status_mutex 与 sim_controller.mutex 为叶子锁，持有期间不获取其他锁.
+    ProfiledMutex io_mutex;
     std::thread* monitor_thread = nullptr;     // IO 监测线程指针
     std::atomic<bool> thread_running{true};    // 线程运行控制标志
 
     // 日志记录
     std::shared_ptr<spdlog::logger> file_logger;
+    // 异步日志队列容量 (条). 队列满时丢弃最旧的消息，安全路径上的日志调用永不阻塞.
+    const size_t LOG_ASYNC_QUEUE_SIZE = 8192;
     const size_t LOG_FILE_SIZE = 1024 * 1024 * 20;  // 20MB
     const size_t LOG_FILES_COUNT = 3;               // 保留 3 个文件
+    const size_t CELL_LOG_FILE_SIZE = 1024 * 1024 * 5; // 单元日志 5MB
+
+    // 由此实例处理的机器人 ID 集合 (位掩码)，缺省为 1 和 2，可由配置 robot_ids 覆盖.
+    // 写入时持有 io_mutex; 读取无需加锁，各线程每次动作/周期读取一次. 动作执行线程据此同步状态表.
+    const uint32_t DEFAULT_ROBOT_MASK = (1u << 1) | (1u << 2);
+    std::atomic<uint32_t> handled_robot_mask{DEFAULT_ROBOT_MASK};
+    // 去抖配置列表 (发布快照用)
+    typedef std::vector<std::pair<int, IODebounce>> IODebounceList;
+    std::shared_ptr<const IODebounceList> debounce_list = std::make_shared<const IODebounceList>(); // 受 io_mutex 保护
+
+    // 安全单元实例 - 一条产线的各个单元在同一进程内运行，每个单元即一个安全区域: 区域定义给出其 IO 集合、
+    // 受控机器人与动作，实例持有单元自己的配置文件与日志器. 请求以 cell 字段路由到单元.
+    // 所有单元共享同一个 (可绑核的) 监测线程与动作执行线程: 监测线程一个周期内位并行评估全部单元的 IO，
+    // 单元数增加不增加线程与 IO 读取轮次.
+    struct RasterSafetyInstance {
+        std::string cell_id;                     // 与区域名称相同
+        std::string config_file;                 // CELL_CONFIG_DIR/<cell>.json: 本单元的 IO 条目、机器人与动作
+        std::shared_ptr<spdlog::logger> logger;  // CELL_CONFIG_DIR/<cell>.log，与主日志共用异步线程池; 可能为空
+    };
+
+    // 安全区域 - 把一组 IO 映射到其保护的机器人子集. 区域内任一 IO 触发只限制该区域的机器人，
+    // 未归属任何区域的 IO 保护全部受控机器人 (未配置区域时即整个单元一起暂停).
+    // 修改方同时持有 config_update_mutex 与 io_mutex，持有任一即可读取.
+    const int MAX_SAFETY_ZONES = 32;
+    enum ZoneAction : uint8_t {
+        ZONE_ACTION_PAUSE = 0,       // 受限时暂停机器人，解除后恢复作业
+        ZONE_ACTION_LIMIT_SPEED = 1  // 受限时把速度倍率降到 configured_limited_speed，解除后恢复倍率
+    };
+    struct SafetyZone {
+        std::string name;
+        std::vector<int> io_indices;  // 归属本区域的 IO 号 (升序，每个 IO 最多归属一个区域)
+        uint32_t robot_mask = 0;      // 本区域保护的机器人
+        ZoneAction action = ZONE_ACTION_PAUSE;
+        std::shared_ptr<const RasterSafetyInstance> instance; // 单元实例，安装前由 bind_cell_instances 绑定
+    };
+    // 区域定义整体替换，不原地修改; 状态快照直接共享同一份列表.
+    std::shared_ptr<const std::vector<SafetyZone>> safety_zones = std::make_shared<const std::vector<SafetyZone>>();
+    std::vector<int8_t> zone_by_io(2049, -1); // IO 号 -> safety_zones 下标，-1 表示未归属区域
+    // 当前被限制 (已投递暂停) 的机器人集合. 由持有 io_mutex 的监测线程/resetSpeed 写入，动作执行线程无锁读取.
+    std::atomic<uint32_t> limited_robot_mask{0};
+
+    // 速度倍率接口 - NRC 接口未提供速度倍率设置，由集成方通过 rasterSafetySetSpeedOverrideHandler 注册.
+    // percent 为 0-100 时设置倍率，小于 0 时恢复限速前的倍率; 返回 0 表示成功. 在动作执行线程中调用.
+    // 未注册时限速区域按暂停处理.
+    typedef int (*SpeedOverrideHandler)(int robot_id, int percent);
+    std::atomic<SpeedOverrideHandler> speed_override_handler{nullptr};
+    // 控制器后端. 缺省为真实控制器; 替换为指针原子交换，进行中的调用仍使用旧表 (调用方保证旧表的生命周期).
+    const RasterSafetyBackend nrc_backend = {
+        [](int io_index) { return NRC_ReadTcpBoolVar(io_index); },
+        [](int robot_id) { return NRC_Rbt_GetProgramRunStatus(robot_id); },
+        [](int robot_id, std::string& job_name) { return NRC_GetCurrentOpenJob(robot_id, job_name); },
+        [](int robot_id) { return NRC_Rbt_PauseRunJobfile(robot_id); },
+        [](const char* job_name) { return NRC_StartRunJobfile(job_name); },
+        [](int level, const std::string& message) { NRC_TriggerErrorReport(level, message); }
+    };
+    std::atomic<const RasterSafetyBackend*> controller_backend{&nrc_backend};
+
+    // 仿真控制器 - 无硬件时的后端 (rasterSafetyStartSimulation). IO 电平是相对仿真起点时间的确定函数:
+    // 静态电平 level 上叠加脉冲 (period_ms > 0 时每周期一次，否则仅在 phase_ms 处一次)，脉冲期间读数取反.
+    // 机器人按固定的暂停/恢复延迟转换运行状态，故障模式按命令计数注入. IO 波形为原子字段，读取无锁.
+    struct SimIOWave {
+        std::atomic<bool> level{false};
+        std::atomic<int> pulse_ms{0};   // 0 表示无脉冲
+        std::atomic<int> period_ms{0};
+        std::atomic<int> phase_ms{0};
+    };
+    struct SimRobot {
+        bool present = false;
+        int status = 0;              // 0 停止, 1 暂停, 2 运行
+        int pending_status = -1;     // 命令已受理、尚未完成的目标状态
+        std::chrono::steady_clock::time_point transition_at;
+        std::string job;
+    };
+    struct SimController {
+        std::atomic<bool> active{false};
+        std::atomic<int64_t> epoch_ns{0};   // 仿真起点 (steady_clock 纳秒)
+        std::atomic<int> call_latency_us{0}; // 每个机器人命令/状态查询的调用耗时
+        SimIOWave io[2049];
+        std::mutex mutex;                    // 保护以下字段
+        SimRobot robots[MAX_ROBOT_ID + 1];
+        int pause_latency_ms = 30;           // 暂停命令受理到状态变为暂停
+        int resume_latency_ms = 30;          // 恢复命令受理到状态变为运行
+        int fail_every = 0;                  // >0 时每第 N 个暂停/恢复命令返回 -1 且不生效
+        int job_ret = 0;                     // get_open_job 的返回值 (非 0 时不回填作业名)
+        bool pause_ignored = false;          // 暂停命令返回成功但机器人不停止
+        bool resume_ignored = false;         // 恢复命令返回成功但机器人不运行
+        uint64_t commands = 0;
+        uint64_t reports = 0;
+    };
+    SimController sim_controller;
 
-    // 由此实例处理的机器人ID. 根据上下文假定是 1 和 2.
-    const std::vector<int> handled_robot_ids = {1, 2};
+    // 当前被限速的机器人集合 (与暂停集合独立调和). 由持有 io_mutex 的监测线程/resetSpeed 写入，动作执行线程无锁读取.
+    std::atomic<uint32_t> speed_limited_robot_mask{0};
+    int applied_limited_speed = -1; // 已下发的限速值，无限速机器人时为 -1. 受 io_mutex 保护.
 
-    // 暂停/恢复操作后等待确认状态的时间 (毫秒)
+    // 暂停/恢复操作后等待确认状态的默认最长时间 (毫秒)，可由配置 state_confirm_timeout_ms 覆盖
     const int STATE_CONFIRM_WAIT_MS = 200;
+    // 确认期间查询运行状态的间隔 (毫秒). 达到目标状态即提前结束等待.
+    const int STATE_CONFIRM_POLL_MS = 10;
+    // confirm_run_status 的目标状态: 不再运行 (停止 0 或暂停 1 均视为已确认)
+    const int RUN_STATUS_NOT_RUNNING = -2;
+    // 当前生效的确认超时 (毫秒). 动作执行线程在锁外读取，故使用原子变量.
+    std::atomic<int> state_confirm_timeout_ms{STATE_CONFIRM_WAIT_MS};
+
+    // IO 变化检测: 事件驱动 + 自适应轮询
+    // 事件模式 (配置 io_event_mode=true): 控制器的 TCP 布尔变量变化回调调用 rasterSafetyNotifyIOChange()
+    // 立即唤醒监测线程，无事件时仅按兜底周期轮询. 轮询模式: 检测到 IO 变化后快速轮询，空闲时逐步退避.
+    // 以下为默认值，可由配置 "monitor" 对象或 set_monitor_config 操作覆盖.
+    const int IO_POLL_FAST_MS = 2;        // 检测到 IO 变化后的轮询周期 (毫秒)
+    const int IO_POLL_IDLE_MS = 8;        // 空闲时的最长轮询周期 (毫秒)，保证最坏检测延迟 < 10ms
+    const int IO_EVENT_WATCHDOG_MS = 50;  // 事件模式下的兜底轮询周期 (毫秒)，防止通知丢失
+    bool io_event_mode = false;           // 是否启用事件驱动模式. 受 io_mutex 保护.
+
+    // 监测线程周期与调度设置
+    struct MonitorSettings {
+        int period_ms;          // 空闲时的轮询周期 (毫秒)
+        int fast_period_ms;     // 检测到 IO 变化后的轮询周期 (毫秒)
+        int event_watchdog_ms;  // 事件模式下的兜底轮询周期 (毫秒)
+        int rt_priority;        // SCHED_FIFO 优先级 (1-99)，0 表示使用默认调度策略
+        int cpu_core;           // 绑定的 CPU 核编号，-1 表示不绑定
+        bool lock_memory;       // 是否 mlockall 锁定进程内存，避免缺页带来的抖动
+    };
+    // 当前设置. 受 io_mutex 保护. 修改后递增 monitor_settings_version，监测线程在下一周期重新应用.
+    MonitorSettings monitor_settings = {IO_POLL_IDLE_MS, IO_POLL_FAST_MS, IO_EVENT_WATCHDOG_MS, 0, -1, false};
+    std::atomic<unsigned> monitor_settings_version{0};
+
+    // 监测线程完成第一个评估周期 (已武装) 的时刻 (steady_clock 纳秒，0 表示尚未武装). 用于启动阶段耗时统计.
+    std::atomic<int64_t> monitor_armed_ns{0};
+
+    // 安全状态快照 - 在状态、触发集合或配置变化后，由持有 io_mutex 的修改方发布的不可变快照.
+    // 查询接口 (getTriggeredIOStates, getCurrentLimitedSpeed, get_config) 通过 std::atomic_load 读取，
+    // 不获取 io_mutex: HMI 轮询不会阻塞监测线程，监测线程发布时也不等待读者.
+    // 字符串与区域/去抖列表只在配置变化时重建并在快照间共享，监测线程发布快照只复制定长字段.
+    struct IOStatusEntry {
+        int io_index;
+        int reset_io_index;
+        int trigger_value;
+        bool already_triggered;
+        std::time_t trigger_time;
+        uint32_t description_id;           // descriptions 中的下标
+    };
+    struct SafetyStatusSnapshot {
+        SystemState system_state;
+        int limited_speed;
+        std::vector<IOStatusEntry> io_states;  // 所有已配置 IO，already_triggered/trigger_time 为发布时的值
+        std::shared_ptr<const DescriptionTable> descriptions;
+        MonitorSettings monitor;           // 监测线程周期与调度设置
+        bool io_event_mode;
+        uint32_t robot_mask;               // 受控机器人集合
+        std::shared_ptr<const std::vector<SafetyZone>> zones; // 安全区域定义
+        uint32_t limited_robots;           // 发布时被暂停限制的机器人集合
+        uint32_t speed_limited_robots;     // 发布时被限速的机器人集合
+        std::shared_ptr<const IODebounceList> debounce; // 非缺省的去抖配置 (按 IO 号升序)
+        int debounce_max_delay_ms;
+        uint64_t version;                  // 发布序号，每次发布递增
+    };
+    std::shared_ptr<const SafetyStatusSnapshot> status_snapshot; // 只通过 std::atomic_load/atomic_store 访问
+    uint64_t status_snapshot_version = 0; // 受 io_mutex 保护
+
+    // 监测线程等待/唤醒
+    std::mutex monitor_wait_mutex;
+    std::condition_variable monitor_cv;
+    bool io_change_pending = false;       // 有未处理的 IO 变化通知. 受 monitor_wait_mutex 保护.
+
+    // 动作执行线程 - 监测线程只投递状态转换命令，暂停/恢复及其确认等待在此线程执行
+    enum ActionType {
+        ACTION_PAUSE,         // 转换到 LIMITED: 暂停机器人
+        ACTION_RESUME,        // 转换到 NORMAL: 恢复机器人
+        ACTION_LIMIT_SPEED,   // 限速区域受限: 把速度倍率降到 speed_percent
+        ACTION_RESTORE_SPEED  // 限速区域解除: 恢复限速前的速度倍率
+    };
+    struct ActionCommand {
+        ActionType type;
+        bool announce;  // 是否发送系统级状态转换通知 (监测线程检测到的转换为 true，resetSpeed 为 false)
+        std::chrono::steady_clock::time_point observed_at;  // 观察到 IO 边沿 (快照读取完成) 的时刻
+        std::chrono::steady_clock::time_point decided_at;   // 决定状态转换 (投递命令) 的时刻
+        int cause_io;   // 引起本次转换的 IO 索引 (-1 表示非 IO 边沿触发，如 resetSpeed)
+        uint32_t robot_mask; // 动作涉及的机器人 (按区域确定的子集)
+        int speed_percent;   // ACTION_LIMIT_SPEED 的目标速度倍率 (%)，其他动作为 -1
+    };
+    std::mutex action_mutex;                    // 保护 action_queue
+    std::condition_variable action_cv;
+    // 待执行的动作命令. 受 action_mutex 保护. 合并后通常只有几条，启动时预留容量，投递/取出不分配.
+    std::vector<ActionCommand> action_queue;
+    const size_t ACTION_QUEUE_RESERVE = 16;
+    std::thread* action_thread = nullptr;       // 动作执行线程指针
+    std::atomic<bool> action_thread_running{false};
+
+    // 控制器调用扇出 - 动作执行线程把一批相互独立的控制器调用 (各机器人的暂停/恢复命令、确认查询) 交给工作线程
+    // 与自身并发执行，一批的耗时约为一次调用的耗时，不随机器人数量增加 (后端须线程安全，见 RasterSafetyBackend).
+    // 各任务的参数与结果放在调用者的定长数组中，扇出不分配堆内存. 工作线程未运行时在调用线程中依次执行.
+    const int CONTROLLER_FANOUT_THREADS = 7; // 工作线程数，加上动作执行线程自身共 8 路并发
+    struct ControllerFanout {
+        std::mutex mutex;                  // 保护以下字段 (叶子锁)
+        std::condition_variable work_cv;   // 工作线程等待任务
+        std::condition_variable done_cv;   // 动作执行线程等待本批完成
+        bool running = false;
+        void (*task)(void* context, int index) = nullptr;
+        void* context = nullptr;
+        int count = 0;                     // 本批任务数
+        int next = 0;                      // 下一个待领取的任务
+        int completed = 0;                 // 已完成的任务数
+        std::thread* threads[CONTROLLER_FANOUT_THREADS] = {};
+    };
+    ControllerFanout controller_fanout;
+
+    // 通知消息缓冲区 - 动作执行线程把消息格式化到定长缓冲区，再写入预留容量的 report_message
+    // 交给 NRC_TriggerErrorReport 与日志，转换期间拼接消息不分配堆内存. 仅动作执行线程访问.
+    const size_t REPORT_MESSAGE_MAX = 512; // 字节，超长消息被截断
+    char report_text[REPORT_MESSAGE_MAX];
+    std::string report_message;
+
+    // 延迟统计 - 固定桶直方图 (微秒)，桶 i 覆盖 [2^i, 2^(i+1)) 微秒，桶 0 覆盖 [0, 2).
+    // 记录只做原子加法，无锁无分配，可在任意线程的热路径中常开.
+    struct LatencyHistogram {
+        static const int BUCKET_COUNT = 32;
+        std::atomic<uint64_t> buckets[BUCKET_COUNT];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum_us;
+        std::atomic<uint64_t> max_us;
+    };
+    struct SafetyMetrics {
+        LatencyHistogram trip_to_decision;     // IO 边沿 -> 决定转换到 LIMITED
+        LatencyHistogram trip_queue_delay;     // 决定转换 -> 动作执行线程开始暂停
+        LatencyHistogram trip_to_pause_call;   // IO 边沿 -> 每个 NRC_Rbt_PauseRunJobfile 返回
+        LatencyHistogram trip_to_paused;       // IO 边沿 -> 暂停确认完成
+        LatencyHistogram trip_to_speed_limited; // IO 边沿 -> 每个限速调用返回
+        LatencyHistogram reset_to_decision;    // 复位边沿 -> 决定转换到 NORMAL
+        LatencyHistogram reset_to_resume_call; // 复位边沿 -> 每个 NRC_StartRunJobfile 返回
+        LatencyHistogram reset_to_resumed;     // 复位边沿 -> 恢复确认完成
+        LatencyHistogram cycle_duration;       // 监测周期处理耗时 (不含等待)
+        LatencyHistogram cycle_jitter;         // 监测周期实际唤醒时刻相对截止时刻的延迟
+        std::atomic<uint64_t> filtered_trips;  // 去抖滤除的触发毛刺 (触发条件在被接受前消失)
+        std::atomic<uint64_t> filtered_resets; // 复位保持期内复位条件消失的次数
+        std::atomic<uint32_t> io_glitches[2049]; // 按 IO 号的触发毛刺计数
+    };
+    SafetyMetrics safety_metrics; // 静态存储，所有计数零初始化
+
+    // io_mutex 剖析统计 (按调用点)，仅在 lock_profiling_enabled 时记录. 获取次数即 wait.count.
+    struct LockSiteStats {
+        LatencyHistogram wait;                 // 请求加锁 -> 获得
+        LatencyHistogram hold;                 // 获得 -> 释放
+        std::atomic<uint64_t> contended;       // 需要等待 (try_lock 失败) 的次数
+        std::atomic<uint64_t> blocked_by[LOCK_SITE_COUNT]; // 等待开始时锁的持有者
+        std::atomic<int64_t> max_hold_at;      // 最长持有结束的时刻 (Unix 毫秒)
+    };
+    LockSiteStats lock_site_stats[LOCK_SITE_COUNT]; // 静态存储，零初始化
+    const int LOCK_PROFILE_LOG_INTERVAL_DEFAULT_MS = 10000;
+    const int LOCK_PROFILE_LOG_INTERVAL_MIN_MS = 1000;
+    const int LOCK_PROFILE_LOG_INTERVAL_MAX_MS = 3600000;
+    std::atomic<bool> lock_profiling_enabled{false};
+    std::atomic<int> lock_profile_log_interval_ms{LOCK_PROFILE_LOG_INTERVAL_DEFAULT_MS}; // 配置写入线程按此周期记录日志
+    std::atomic<unsigned> lock_profile_settings_version{0}; // 剖析开关/周期修改时递增，唤醒配置写入线程重新计时
+
+    // 安全事件日志 - raster_config/ 下固定大小的内存映射环形文件，记录紧凑的二进制事件.
+    // 追加只写映射内存 (无系统调用)，写入进程崩溃后数据仍保留在页缓存中，由内核回写文件.
+    const std::string EVENT_JOURNAL_FILE_NAME = "raster_events.bin";
+    const uint32_t EVENT_JOURNAL_MAGIC = 0x52534A31; // "RSJ1"
+    const uint32_t EVENT_JOURNAL_VERSION = 1;
+    const uint32_t EVENT_JOURNAL_CAPACITY = 16384;   // 记录条数 (约 640KB)
+    const int EVENT_QUERY_DEFAULT_LIMIT = 100;
+    const int EVENT_QUERY_MAX_LIMIT = 1000;
+
+    enum EventType : uint8_t {
+        EVENT_IO_TRIGGERED = 1, // IO 满足触发条件
+        EVENT_IO_RESET = 2,     // IO 复位条件满足
+        EVENT_STATE_CHANGE = 3, // 系统状态转换
+        EVENT_ROBOT_PAUSE = 4,  // 机器人暂停动作结果
+        EVENT_ROBOT_RESUME = 5, // 机器人恢复动作结果
+        EVENT_MANUAL_RESET = 6, // 外部 resetSpeed 命令结果
+        EVENT_ROBOT_SPEED = 7   // 机器人限速/恢复倍率结果 (status_after 为目标倍率，-1 表示恢复)
+    };
+
+    struct EventJournalHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t record_size;
+        uint64_t next_seq;     // 下一条记录的序号 (多写者通过原子加法分配)
+        uint64_t reserved[5];
+    };
+
+    struct EventRecord {
+        uint64_t commit;       // 提交标记: 写入完成后为 序号+1，0 表示空槽或正在写入
+        int64_t time_us;       // 墙钟时间 (微秒，Unix 纪元)
+        int32_t io_index;      // 相关 IO 索引，-1 表示无
+        int32_t call_ret;      // NRC 调用返回值
+        int32_t status_after;  // 动作后机器人运行状态 / IO 当前值
+        int32_t confirm_ms;    // 状态确认耗时 (毫秒)
+        int16_t robot_id;      // 机器人 ID，-1 表示无
+        uint8_t type;          // EventType
+        uint8_t from_state;    // SystemState
+        uint8_t to_state;      // SystemState
+        uint8_t reserved[3];
+    };
+    static_assert(sizeof(EventJournalHeader) == 64, "event journal header layout");
+    static_assert(sizeof(EventRecord) == 40, "event record layout");
+
+    struct EventJournal {
+        EventJournalHeader* header = nullptr;
+        EventRecord* records = nullptr;
+        std::atomic<bool> ready{false};
+    };
+    EventJournal event_journal; // 映射在进程生命周期内保持，不随服务停止而解除
+
+    // 双缓冲配置切换 - updateIOConfig 在锁外构建完整的新配置表并通过原子指针发布，
+    // 监测线程在下一周期开始时取出并与当前表交换 (仅 O(配置条目数) 的状态继承)，不等待验证/构建/磁盘写入.
+    struct PendingIOConfig {
+        IOTable table;
+        int limited_speed = 30;
+        bool keep_trigger_state = false; // 增量修改: 同号条目即使触发/复位条件变化也继承触发状态
+        bool replace_zones = false;      // 单元 IO 修改: zones 与配置表一起安装，IO 与其单元归属同时切换
+        std::vector<SafetyZone> zones;
+        bool installed = false; // 由 config_install_mutex 保护
+    };
+    std::shared_ptr<PendingIOConfig> pending_io_config; // 通过 std::atomic_load/store/exchange 访问
+    std::mutex config_update_mutex;   // 串行化配置修改请求 (锁顺序: config_update_mutex -> io_mutex)
+    std::mutex config_install_mutex;  // 保护 installed 标志 (锁顺序: io_mutex -> config_install_mutex)
+    std::condition_variable config_install_cv;
+    const int IO_CONFIG_INSTALL_WAIT_MS = 200; // 等待监测线程接管的最长时间，超时后由请求线程直接安装
+    std::mutex config_file_mutex;     // 串行化配置文件写入 (可在持有 io_mutex 时获取，反之不可)
+
+    // 人工复位请求 (resetSpeed / resetSafetyZone). 交由监测线程在下一周期读取 IO 后基于同一快照执行，
+    // 完成后经 config_install_cv 通知.
+    struct PendingReset {
+        std::string zone;             // 非空时只复位该安全区域 (单元)，其他区域的触发状态不受影响
+        bool zone_found = true;       // 执行时按名称查找区域的结果
+        bool done = false;            // 由 config_install_mutex 保护
+        bool success = false;         // 复位后没有 IO 仍满足触发条件 (done 之后有效)
+        int still_triggered_io = -1;  // 复位被拒绝时仍在触发的 IO
+    };
+    std::shared_ptr<PendingReset> pending_reset; // 通过 std::atomic_load/store/exchange 访问
+    std::mutex reset_request_mutex;   // 串行化复位请求 (锁顺序: reset_request_mutex -> io_mutex)
+
+    // 后台配置写入 - 调用者只递增请求代数并立即返回，写入线程合并一段时间内的多次请求后
+    // 只写入一次最新快照. 写入结果以代数和状态形式异步报告 (get_config 的 config_sync).
+    const int CONFIG_SAVE_COALESCE_MS = 100;
+    // 仅二进制快照 (触发状态变化) 的写入最小间隔: 抖动的光栅不会持续写闪存. 期间的请求合并，停止时写出最后一次.
+    const int SNAPSHOT_SAVE_MIN_INTERVAL_MS = 5000;
+    struct ConfigSaveState {
+        uint64_t requested_gen = 0;   // 已请求的保存代数 (JSON + 二进制快照)
+        uint64_t completed_gen = 0;   // 已完成 (成功或失败) 的最新代数
+        uint64_t snapshot_requested_gen = 0; // 仅二进制快照 (触发状态变化) 的请求代数
+        uint64_t snapshot_completed_gen = 0;
+        bool last_ok = true;          // 最近一次写入是否成功
+        std::time_t last_saved_at = 0;// 最近一次成功写入的时间
+        int failure_count = 0;        // 连续失败次数
+    };
+    ConfigSaveState config_save_state;   // 由 config_save_mutex 保护
+
+    // 二进制配置快照 - JSON 配置与最近触发状态的紧凑编译结果，启动时一次读取即可装载.
+    // 记录生成时主 JSON 配置文件的修改时间与大小及各单元配置文件的指纹，与当前文件一致时才直接使用; JSON 仍是可手工编辑的唯一来源.
+    const std::string CONFIG_SNAPSHOT_FILE_NAME = "raster_safety_config.bin";
+    const uint32_t CONFIG_SNAPSHOT_MAGIC = 0x52534331; // "RSC1"
+    const uint32_t CONFIG_SNAPSHOT_VERSION = 6;
+    // 最近一次写出的快照内容指纹. 内容未变 (如触发后又复位) 时跳过写入. 仅由写入线程 (或启动前的同步保存) 访问.
+    struct SnapshotFingerprint {
+        bool valid = false;
+        uint32_t crc = 0;
+        size_t size = 0;
+    };
+    SnapshotFingerprint last_snapshot_written;
+    struct ConfigSnapshotHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t header_size;
+        uint32_t entry_count;
+        int64_t json_mtime_ns;      // 生成时主 JSON 配置文件的修改时间
+        int64_t json_size;          // 生成时主 JSON 配置文件的大小
+        int32_t limited_speed;
+        int32_t state_confirm_timeout_ms;
+        int32_t period_ms;
+        int32_t fast_period_ms;
+        int32_t event_watchdog_ms;
+        int32_t rt_priority;
+        int32_t cpu_core;
+        uint8_t lock_memory;
+        uint8_t io_event_mode;
+        uint16_t zone_count;        // 条目区之后的区域记录数
+        uint32_t payload_size;
+        uint32_t payload_crc;       // 条目区 CRC32
+        uint32_t robot_mask;        // 受控机器人集合
+        uint16_t debounce_count;    // 区域记录之后的去抖记录数
+        uint16_t debounce_max_delay_ms;
+        uint32_t cell_files_crc;    // 生成时各单元配置文件 (路径、修改时间、大小) 的 CRC32
+        uint32_t header_crc;        // 本字段之前头部字节的 CRC32
+    };
+    struct ConfigSnapshotEntry {    // 后接 description_len 字节的描述
+        int16_t io_index;
+        int16_t reset_io_index;
+        uint8_t trigger_value;
+        uint8_t already_triggered;
+        uint16_t description_len;
+        int64_t trigger_time;
+    };
+    struct ConfigSnapshotZone {     // 后接 io_count 个 int16_t IO 号与 name_len 字节的名称
+        uint32_t robot_mask;
+        uint16_t io_count;
+        uint16_t name_len;
+        uint8_t action;             // ZoneAction
+        uint8_t reserved[3];
+    };
+    struct ConfigSnapshotDebounce {
+        int16_t io_index;
+        uint16_t trigger_samples;
+        uint16_t trigger_min_ms;
+        uint16_t reset_holdoff_ms;
+    };
+    static_assert(sizeof(ConfigSnapshotHeader) == 88, "config snapshot header layout");
+    static_assert(sizeof(ConfigSnapshotEntry) == 16, "config snapshot entry layout");
+    static_assert(sizeof(ConfigSnapshotZone) == 12, "config snapshot zone layout");
+    static_assert(sizeof(ConfigSnapshotDebounce) == 8, "config snapshot debounce layout");
+    struct ConfigSnapshotImage {
+        ConfigSnapshotHeader header;
+        std::vector<IOConfig> entries;
+        std::vector<SafetyZone> zones;
+        IODebounceList debounce; // (IO 号, 去抖参数)
+    };
+    std::mutex config_save_mutex;
+    std::condition_variable config_save_cv;
+    std::thread* config_writer_thread = nullptr;
+    bool config_writer_running = false;  // 由 config_save_mutex 保护
+
+    // 状态推送 - HMI 通过 subscribe 操作订阅后，由推送线程在 0x927b 上发送与上次推送相比的增量
+    // (安全状态、触发/复位的 IO、受限机器人集合、配置是否变化). 相邻推送至少间隔 min_interval_ms，
+    // 期间的多次快照发布合并为一次增量. 初始同步仍使用 get_config. 监测线程发布快照后只做一次通知.
+    const int STATUS_PUSH_INTERVAL_DEFAULT_MS = 100;
+    const int STATUS_PUSH_INTERVAL_MIN_MS = 10;
+    const int STATUS_PUSH_INTERVAL_MAX_MS = 10000;
+    struct StatusPushState {
+        bool running = false;         // 推送线程运行中
+        bool subscribed = false;
+        int min_interval_ms = STATUS_PUSH_INTERVAL_DEFAULT_MS;
+        uint64_t published_version = 0;  // 最近发布的快照序号
+        uint64_t generation = 0;      // 订阅/退订时递增，推送线程据此丢弃基于旧订阅的增量
+        std::shared_ptr<const SafetyStatusSnapshot> last_sent; // 增量的基准 (上次推送或订阅时的快照)
+        std::chrono::steady_clock::time_point last_sent_at;
+    };
+    StatusPushState status_push;      // 由 status_push_mutex 保护
+    // 紧凑 JSON 文本写入器. 直接向复用的输出缓冲追加，不构建 Json::Value 树;
+    // 用于 get_config 这类随 IO 数量增长的响应. 键按写入顺序输出，调用方负责括号配对.
+    class JsonTextWriter {
+    public:
+        void reset() { out_.clear(); first_ = true; }
+        const std::string& text() const { return out_; }
+
+        void begin_object(const char* key = nullptr) { open(key, '{'); }
+        void end_object() { close('}'); }
+        void begin_array(const char* key = nullptr) { open(key, '['); }
+        void end_array() { close(']'); }
+
+        void field_int(const char* key, long long value) { separator(key); append_int(value); }
+        void field_uint(const char* key, unsigned long long value) {
+            separator(key);
+            char buf[24];
+            out_.append(buf, std::snprintf(buf, sizeof(buf), "%llu", value));
+        }
+        void field_bool(const char* key, bool value) { separator(key); out_ += value ? "true" : "false"; }
+        void field_str(const char* key, const std::string& value) { separator(key); quote(value.data(), value.size()); }
+        void field_str(const char* key, const char* value) { separator(key); quote(value, std::strlen(value)); }
+        void value_int(long long value) { field_int(nullptr, value); }
+        void end_document() { out_ += '\n'; } // 与 FastWriter 输出一致，以换行结尾
+
+    private:
+        void separator(const char* key) {
+            if (!first_) out_ += ',';
+            first_ = false;
+            if (key) {
+                quote(key, std::strlen(key));
+                out_ += ':';
+            }
+        }
+        void open(const char* key, char bracket) {
+            separator(key);
+            out_ += bracket;
+            first_ = true;
+        }
+        void close(char bracket) {
+            out_ += bracket;
+            first_ = false;
+        }
+        void append_int(long long value) {
+            char buf[24];
+            out_.append(buf, std::snprintf(buf, sizeof(buf), "%lld", value));
+        }
+        // 仅转义引号、反斜杠与控制字符; 其余字节 (含 UTF-8 多字节序列) 原样输出
+        void quote(const char* str, size_t len) {
+            out_ += '"';
+            for (size_t i = 0; i < len; ++i) {
+                unsigned char c = static_cast<unsigned char>(str[i]);
+                if (c == '"' || c == '\\') {
+                    out_ += '\\';
+                    out_ += static_cast<char>(c);
+                } else if (c < 0x20) {
+                    char buf[8];
+                    out_.append(buf, std::snprintf(buf, sizeof(buf), "\\u%04x", c));
+                } else {
+                    out_ += static_cast<char>(c);
+                }
+            }
+            out_ += '"';
+        }
+
+        std::string out_;
+        bool first_ = true;
+    };
+
+    Json::FastWriter control_writer;  // 0x927b 消息的序列化器 (复用输出缓冲). 由 control_writer_mutex 保护.
+    JsonTextWriter control_text;      // get_config 响应的文本缓冲 (容量在请求间保留). 由 control_writer_mutex 保护.
+    std::mutex control_writer_mutex;  // 可在持有时获取 config_save_mutex，反之不可
+    std::mutex status_push_mutex;     // 可在持有 io_mutex 时获取，反之不可
+    std::condition_variable status_push_cv;
+    std::thread* status_push_thread = nullptr;
+    std::atomic<bool> status_push_subscribed{false}; // status_push.subscribed 的无锁副本，未订阅时发布快照不通知
+
+    // 增量 IO 配置修改 (add_io / remove_io / patch_io). patch 仅修改 has_* 标记的字段.
+    enum IOConfigEditType {
+        IO_EDIT_ADD,
+        IO_EDIT_REMOVE,
+        IO_EDIT_PATCH
+    };
+    struct IOConfigEdit {
+        IOConfigEditType type;
+        int io_index = -1;
+        bool has_reset_io_index = false;
+        int reset_io_index = 0;
+        bool has_trigger_value = false;
+        int trigger_value = 1;
+        bool has_description = false;
+        std::string description;
+    };
 
 } // 匿名命名空间结束
 
 // --- 内部函数前向声明 ---
 // 放在这里，确保在使用它们的地方之前已经被声明
 
-static bool read_io(int index);
+static void install_io_config(PendingIOConfig& pending);
+static bool install_pending_io_config();
+static bool submit_io_config(const std::shared_ptr<PendingIOConfig>& pending, LockSite site);
+static void apply_manual_reset(const IOSnapshot& snapshot, PendingReset& result);
+static void apply_zone_reset(const IOSnapshot& snapshot, int zone, PendingReset& result);
+static bool submit_manual_reset(const std::shared_ptr<PendingReset>& request);
+static bool run_pending_reset(const IOSnapshot& snapshot);
+static bool apply_io_config_edits(const std::vector<IOConfigEdit>& edits, const std::string& cell, std::string& message);
+static bool parse_io_config_edits(const Json::Value& root, IOConfigEditType type,
+                                  std::vector<IOConfigEdit>& edits, std::string& message);
+static void rebuild_io_read_set(IOTable& table);
+static void rebuild_io_masks(IOTable& table);
+static void sync_triggered_mask();
+static int evaluate_io_triggers(const IOSnapshot& snapshot, IOEvalWords& words, std::chrono::steady_clock::time_point now);
+static void rebuild_io_debounce(IOTable& table);
+static void apply_debounce_word(size_t k, uint64_t meets, uint64_t triggered, uint64_t& accepted, uint64_t& resets,
+                                std::chrono::steady_clock::time_point now, bool& pending);
+static bool validate_debounce(const IODebounceList& entries, int max_delay_ms, std::string& error);
+static void install_debounce(const IODebounceList& entries, int max_delay_ms);
+static IODebounceList debounce_entries();
+static bool update_debounce_config(const Json::Value& root, std::string& message);
+static void publish_status_snapshot();
+static std::shared_ptr<const SafetyStatusSnapshot> load_status_snapshot();
+static const std::string& status_description(const SafetyStatusSnapshot& snap, const IOStatusEntry& io);
+static void read_io_snapshot(const std::vector<int>& indices, IOSnapshot& snapshot);
+static const RasterSafetyBackend& controller();
+static void sim_advance_robot(SimRobot& robot, std::chrono::steady_clock::time_point now);
+static void sim_call_delay();
+static bool sim_read_io(int io_index);
+static int sim_get_run_status(int robot_id);
+static int sim_get_open_job(int robot_id, std::string& job_name);
+static int sim_pause_job(int robot_id);
+static int sim_start_job(const char* job_name);
+static void sim_error_report(int level, const std::string& message);
+static bool sim_command_fails();
 static bool createDirectory(const std::string& path);
 static bool fileExists(const std::string& path);
 static bool setFilePermissions(const std::string& path);
+static bool write_file_atomically(const std::string& filename, const std::string& content);
 static bool save_to_file();
+static bool save_config_snapshot();
+static bool load_config_snapshot(ConfigSnapshotImage& image);
+static bool apply_config_snapshot(const ConfigSnapshotImage& image);
+static void assign_io_entries(IOTable& table, std::vector<IOConfig> entries);
+static uint32_t crc32_update(uint32_t crc, const void* data, size_t len);
+static void request_snapshot_save();
+static uint64_t request_config_save();
+static void config_writer_thread_func();
+static void notify_status_push(uint64_t version);
+static void send_control_message(const Json::Value& message);
+static void write_config_response(const std::string& operation, const std::string& cell, JsonTextWriter& w);
+static bool build_status_delta(const SafetyStatusSnapshot& base, const SafetyStatusSnapshot& snap, Json::Value& delta);
+static void status_push_thread_func();
+static bool update_status_subscription(const Json::Value& root, bool subscribe, uint64_t& base_version, std::string& message);
 static bool load_from_file();
+static bool load_cached_config();
+static void start_safety_threads();
 static void io_monitor_thread();
-static void pause_robots();
-static void resume_robots();
+static void set_handled_robots(uint32_t mask);
+static void sync_robot_table();
+static uint32_t limited_robots_for_triggers(uint32_t& speed_limited);
+static bool validate_safety_zones(std::vector<SafetyZone>& zones, std::string& error);
+static bool check_zone_robots_handled(const std::vector<SafetyZone>& zones, uint32_t handled, std::string& error);
+static void ensure_zone_robots_handled(const char* source);
+static void install_safety_zones(std::vector<SafetyZone> zones);
+static bool update_zone_config(const Json::Value& root, std::string& message);
+static int find_zone(const std::vector<SafetyZone>& zones, const std::string& name);
+static std::string cell_config_path(const std::string& cell);
+static std::shared_ptr<const RasterSafetyInstance> make_cell_instance(const std::string& cell);
+static void bind_cell_instances(std::vector<SafetyZone>& zones);
+static spdlog::logger* cell_logger_for_io(int io_index);
+static bool resolve_request_cell(const Json::Value& root, std::string& cell, std::string& message);
+static bool update_cell_robots(const std::string& cell, const Json::Value& root, std::string& message);
+static bool add_cell(const Json::Value& root, std::string& message);
+static bool remove_cell(const std::string& cell, std::string& message);
+static bool load_cell_zones(const Json::Value& items, std::vector<IOConfig>& entries, std::vector<SafetyZone>& zones,
+                            std::vector<std::string>& failed, std::string& error);
+static bool config_source_fingerprint(const std::vector<SafetyZone>& zones, int64_t& mtime_ns, int64_t& size,
+                                      uint32_t& cell_files_crc);
+static void pause_robots(const ActionCommand& cmd);
+static void resume_robots(const ActionCommand& cmd);
+static void limit_robot_speeds(const ActionCommand& cmd);
+static void restore_robot_speeds(const ActionCommand& cmd);
+static void announce_limited_state(const ActionCommand& cmd);
+static void announce_normal_state(const ActionCommand& cmd);
+static const std::string& format_report(const char* format, ...) __attribute__((format(printf, 1, 2)));
+static void record_latency(LatencyHistogram& hist, std::chrono::steady_clock::duration elapsed);
+static uint64_t histogram_percentile(const LatencyHistogram& hist, double quantile);
+static Json::Value histogram_to_json(const LatencyHistogram& hist);
+static void reset_histogram(LatencyHistogram& hist);
+static Json::Value lock_profile_to_json();
+static void reset_lock_profile();
+static void log_lock_profile();
+static bool update_lock_profiling(const Json::Value& root, std::string& message);
+static bool open_event_journal();
+static EventRecord make_event(EventType type);
+static void append_event(const EventRecord& rec);
+static bool read_event(uint64_t seq, EventRecord& out);
+static const char* event_type_name(uint8_t type);
+static int confirm_run_status(const int* ids, int count, int target_status, int* final_status);
+static int64_t steady_now_ns();
+static void run_controller_fanout(void (*task)(void* context, int index), void* context, int count);
+static void controller_fanout_thread();
+static bool wait_for_next_cycle(bool event_mode, std::chrono::steady_clock::time_point deadline);
+static bool validate_monitor_settings(const MonitorSettings& settings, std::string& error);
+static void apply_monitor_thread_settings(const MonitorSettings& settings);
+static bool update_monitor_settings(const Json::Value& root, std::string& message);
+static bool update_robot_config(const Json::Value& root, std::string& message);
+static int json_int(const Json::Value& obj, const char* key, int fallback);
+static void parse_io_config_items(const Json::Value& items, const char* source, std::vector<IOConfig>& out);
+static void build_io_entries(const std::vector<IOConfig>& config, std::vector<IOConfig>& entries);
+static bool parse_robot_ids(const Json::Value& ids, uint32_t& mask, std::string& error);
+static bool parse_safety_zones(const Json::Value& items, std::vector<SafetyZone>& zones, std::string& error);
+static bool parse_debounce_entries(const Json::Value& obj, IODebounceList& entries, std::string& error);
+static void wake_monitor_thread();
+static void post_action(ActionType type, bool announce,
+                        std::chrono::steady_clock::time_point observed_at,
+                        std::chrono::steady_clock::time_point decided_at, int cause_io, uint32_t robot_mask,
+                        int speed_percent);
+static void execute_action(const ActionCommand& cmd);
+static void refresh_job_names(bool periodic);
+static void kick_run_status_refresh();
+static void run_status_thread_func();
+static void action_executor_thread();
 
 // 声明服务停止函数
 void stopRasterSafetyService();
 // 声明信号处理函数 (现在放在使用它的函数之前)
 static void handle_shutdown_signal(int signal);
 
-// Helper to get/initialize robot state. Access to map needs mutex.
+// 访问机器人状态表条目. 只在动作执行线程中调用. 不调用任何 NRC 接口.
 static RobotState& getRobotState(int robot_id) {
-    // 调用者需确保已持有 io_mutex，如果需要修改 map 或并发访问.
-    // 如果在锁定区域外调用 (例如初始化期间)，并且只有一个线程调用，则是安全的.
-    // 在监测线程和控制函数中，在锁内调用.
-    if (robot_states.find(robot_id) == robot_states.end()) {
-        robot_states[robot_id] = RobotState();
-        // 初始化时获取当前状态和作业名 (如果运行/暂停) - NRC 调用可能需要锁，取决于其线程安全性
-        // 假设 NRC 调用在 io_mutex 持有期间是安全的.
-        robot_states[robot_id].current_run_status = NRC_Rbt_GetProgramRunStatus(robot_id);
-        // NRC_GetCurrentOpenJob 可能在无作业打开/运行/暂停时失败.
-        // std::string initial_job_name;
-        // int get_job_ret = NRC_GetCurrentOpenJob(robot_id, initial_job_name);
-        // if(get_job_ret == 0 && (robot_states[robot_id].current_run_status == 1 || robot_states[robot_id].current_run_status == 2)) {
-             // If already running or paused AND we successfully got a job name, maybe store it?
-             // However, we only need the job name if *we* paused it. Storing it here might be misleading.
-             // Let's stick to only storing job name when *we* pause.
-        // }
-
-        if(file_logger) SPDLOG_INFO("已初始化机器人 {} 的状态结构体.", robot_id);
-    }
-    return robot_states.at(robot_id); // 使用 at() 以在查找/插入后更安全地访问
-}
-
-// 辅助函数: 读取布尔量 IO 状态. 假设 NRC_ReadTcpBoolVar 读取操作是线程安全的.
-static bool read_io(int index) {
-    if (index < 0 || index > 2048) {
-        if(file_logger) SPDLOG_WARN("尝试读取无效 IO 索引: {}", index);
-        return false; // 无效索引
-    }
-    // 假设 NRC_ReadTcpBoolVar 内部处理无效索引或返回默认值如 false
-    return NRC_ReadTcpBoolVar(index);
-}
-
-// 动作: 暂停机器人. 假定调用者已持有 io_mutex.
-static void pause_robots() {
-    SPDLOG_INFO("[动作] 因安全触发启动机器人暂停操作. 系统状态: 安全受限.");
-
-    for (int id : handled_robot_ids) {
-        auto& state = getRobotState(id); // 通过辅助函数访问状态 (调用者持有 mutex)
-
-        // 执行动作前刷新状态
-        state.current_run_status = NRC_Rbt_GetProgramRunStatus(id);
-
-        if (state.current_run_status == 2) { // 只在运行时暂停
-            // 在暂停 *之前* 获取当前作业名，以便知道恢复哪个作业
-            std::string current_job;
-            int get_job_ret = NRC_GetCurrentOpenJob(id, current_job);
-            state.last_job_name = current_job; // 无论 NRC_GetCurrentOpenJob 是否成功，都存储作业名 (可能为空)
-            if(get_job_ret != 0) {
-                 if(file_logger) SPDLOG_WARN("获取机械臂 {} 作业名失败. NRC_GetCurrentOpenJob 返回 {}", id, get_job_ret);
-            } else {
-                 if(file_logger) SPDLOG_INFO("机械臂 {} 当前作业名为: {}", id, state.last_job_name);
-            }
-
-            // 调用暂停接口 (不依赖其返回值判断成功)
-            int ret_pause_call = NRC_Rbt_PauseRunJobfile(id);
-            if(file_logger) SPDLOG_INFO("调用 NRC_Rbt_PauseRunJobfile({}) 返回: {}", id, ret_pause_call);
-
-            // 短暂等待，让状态更新
-            std::this_thread::sleep_for(std::chrono::milliseconds(STATE_CONFIRM_WAIT_MS));
-
-            // 再次查询状态，确认是否进入暂停状态
-            int new_status = NRC_Rbt_GetProgramRunStatus(id);
-             if(file_logger) SPDLOG_INFO("等待 {}ms 后，机械臂 {} 新状态为: {}", STATE_CONFIRM_WAIT_MS, id, new_status);
+    return robot_table[robot_id];
+}
 
-            if (new_status == 1) { // 暂停成功 (达到了暂停状态)
-                if (!state.message_sent_limited) {
-                    std::string msg = "安全触发，机械臂" + std::to_string(id) + "因安全IO动作被暂停";
-                    NRC_TriggerErrorReport(1, msg); // 安全触发的报警级别 1
-                    if(file_logger) SPDLOG_INFO(msg);
-                    state.message_sent_limited = true;
-                    state.message_sent_recovered = false; // 重置恢复标志
-                } else {
-                    if(file_logger) SPDLOG_DEBUG("机械臂 {} 在当前安全受限阶段已发送过暂停消息.", id);
-                }
-            } else { // 暂停失败 (未能达到暂停状态)
-                 std::string msg = "安全触发，尝试暂停机械臂" + std::to_string(id) + "失败！未能达到暂停状态。暂停前状态:" + std::to_string(state.current_run_status) + ", 调用返回:" + std::to_string(ret_pause_call) + ", 暂停后状态:" + std::to_string(new_status);
-                 // 无论 message_sent_limited 标志如何，都会发送此错误报告，因为这是动作失败
-                 NRC_TriggerErrorReport(3, msg); // 失败的更高级别
-                 if(file_logger) SPDLOG_ERROR(msg);
-                 // 如果暂停失败，清除记录的 job name，避免下次尝试恢复一个未能被我们成功暂停的作业
-                 state.last_job_name.clear();
-            }
-        } else { // 机器人已停止 (0) 或暂停 (1)
-             if (!state.message_sent_limited) {
-                std::string msg_status = (state.current_run_status == 1) ? "暂停" : "停止";
-                std::string msg = "安全触发，机械臂" + std::to_string(id) + "已处于" + msg_status + "状态，无需暂停";
-                NRC_TriggerErrorReport(0, msg); // 信息级别通知
-                if(file_logger) SPDLOG_INFO(msg);
-                state.message_sent_limited = true;
-                state.message_sent_recovered = false; // 重置恢复标志
-             } else {
-                 if(file_logger) SPDLOG_DEBUG("机械臂 {} 已停止/暂停，并在当前安全受限阶段发送过暂停消息.", id);
-             }
-             // 如果未运行，清空作业名，因为它不是我们暂停的
-             state.last_job_name.clear();
+// 解析机器人 ID 列表为位掩码. 要求非空、每个 ID 在 1-MAX_ROBOT_ID 范围内且不重复.
+template <typename IdRange>
+static bool robot_mask_from_ids(const IdRange& ids, uint32_t& mask, std::string& error) {
+    mask = 0;
+    for (int id : ids) {
+        if (id < 1 || id > MAX_ROBOT_ID) {
+            error = "机器人 ID " + std::to_string(id) + " 超出 1-" + std::to_string(MAX_ROBOT_ID) + " 范围";
+            return false;
         }
+        if (mask & (1u << id)) {
+            error = "机器人 ID " + std::to_string(id) + " 重复";
+            return false;
+        }
+        mask |= 1u << id;
+    }
+    if (mask == 0) {
+        error = "机器人列表为空";
+        return false;
     }
-    // 调用者释放 mutex
+    return true;
 }
 
-// 动作: 恢复机器人. 假定调用者已持有 io_mutex.
-static void resume_robots() {
-    SPDLOG_INFO("[动作] 安全触发解除后启动机器人恢复操作. 系统状态: 正常.");
-
-    for (int id : handled_robot_ids) {
-        auto& state = getRobotState(id); // 通过辅助函数访问状态 (调用者持有 mutex)
-
-        // 执行动作前刷新状态
-        state.current_run_status = NRC_Rbt_GetProgramRunStatus(id);
-
-        if (state.current_run_status == 1) { // 只在暂停时尝试恢复
-            if (!state.last_job_name.empty()) {
-                // 尝试恢复我们记录时暂停的作业
-                if(file_logger) SPDLOG_INFO("尝试恢复机械臂 {} 作业: {}", id, state.last_job_name);
-
-                // 调用恢复接口 (不依赖其返回值判断成功)
-                int ret_resume_call = NRC_StartRunJobfile(state.last_job_name.c_str()); // NRC_StartRunJobfile 接受 const char*
-                if(file_logger) SPDLOG_INFO("调用 NRC_StartRunJobfile({}) 返回: {}", state.last_job_name, ret_resume_call);
-
-
-                // 短暂等待，让状态更新
-                std::this_thread::sleep_for(std::chrono::milliseconds(STATE_CONFIRM_WAIT_MS));
-
-                // 再次查询状态，确认是否进入运行状态
-                int new_status = NRC_Rbt_GetProgramRunStatus(id);
-                 if(file_logger) SPDLOG_INFO("等待 {}ms 后，机械臂 {} 新状态为: {}", STATE_CONFIRM_WAIT_MS, id, new_status);
+// 更换受控机器人集合. 假定调用者已持有 io_mutex (或处于单线程初始化阶段).
+// 状态表由动作执行线程在下一次循环时按新集合同步 (sync_robot_table)，这里只唤醒它.
+static void set_handled_robots(uint32_t mask) {
+    handled_robot_mask.store(mask);
+    {
+        std::lock_guard<std::mutex> lock(action_mutex); // 与执行线程的等待判定串行，避免丢失唤醒
+    }
+    action_cv.notify_one();
+}
 
+// 按受控机器人集合同步状态表: 新加入的机器人条目重置，移出的机器人提示其未恢复的作业.
+// 只在动作执行线程中调用.
+static void sync_robot_table() {
+    const uint32_t mask = handled_robot_mask.load();
+    if (mask == robot_table_mask) {
+        return;
+    }
+    for (uint32_t bits = mask & ~robot_table_mask; bits != 0; bits &= bits - 1) {
+        robot_table[__builtin_ctz(bits)] = RobotState();
+    }
+    for (uint32_t bits = robot_table_mask & ~mask; bits != 0; bits &= bits - 1) {
+        int id = __builtin_ctz(bits);
+        if (!robot_table[id].last_job_name.empty()) {
+            if(file_logger) SPDLOG_WARN("机械臂 {} 移出受控列表，其由本模块暂停的作业 {} 需手动恢复.", id, robot_table[id].last_job_name);
+        }
+    }
+    robot_table_mask = mask;
+    kick_run_status_refresh(); // 尽快观察新加入机器人的运行状态
+}
 
-                 if (new_status == 2) { // 恢复成功 (达到了运行状态)
-                    if (!state.message_sent_recovered) {
-                        std::string msg = "安全触发解除，机械臂" + std::to_string(id) + "作业已恢复";
-                        NRC_TriggerErrorReport(0, msg); // 恢复的信息级别
-                        if(file_logger) SPDLOG_INFO(msg);
-                        state.message_sent_recovered = true;
-                        state.message_sent_limited = false; // 重置暂停标志
-                    } else {
-                         if(file_logger) SPDLOG_DEBUG("机械臂 {} 在当前正常阶段已发送过恢复消息.", id);
-                    }
-                    state.last_job_name.clear(); // 尝试成功恢复后清除作业名
-                 } else {
-                    // 恢复失败 (未能达到运行状态)
-                    std::string msg = "安全触发解除，尝试恢复机械臂" + std::to_string(id) + "作业失败！未能达到运行状态。暂停前状态:" + std::to_string(state.current_run_status) + ", 调用返回:" + std::to_string(ret_resume_call) + ", 恢复后状态:" + std::to_string(new_status);
-                    // 无论 message_sent_recovered 标志如何，都会发送此错误报告，因为这是动作失败
-                    NRC_TriggerErrorReport(3, msg); // 失败的更高级别
-                    if(file_logger) SPDLOG_ERROR(msg);
-                    // 如果恢复失败，状态仍为暂停 (状态 1)，作业名不清除，以便下次可能再次尝试恢复.
-                 }
+// 由当前已触发的 IO 计算需要暂停的机器人集合 (返回值) 与需要限速的机器人集合 (speed_limited):
+// 区域内 IO 按区域动作限制该区域的机器人，未归属区域的 IO 暂停全部受控机器人.
+// 未注册速度倍率接口时限速区域按暂停处理. 假定调用者已持有 io_mutex.
+static uint32_t limited_robots_for_triggers(uint32_t& speed_limited) {
+    const uint32_t handled = handled_robot_mask.load();
+    const bool speed_available = speed_override_handler.load() != nullptr;
+    uint32_t paused = 0;
+    speed_limited = 0;
+    for (size_t k = 0; k < io_table.triggered_mask.size(); ++k) {
+        for (uint64_t bits = io_table.triggered_mask[k]; bits != 0; bits &= bits - 1) {
+            int zone = zone_by_io[io_table.trigger_io[k * 64 + __builtin_ctzll(bits)]];
+            if (zone < 0) {
+                paused |= handled;
+                continue;
+            }
+            const SafetyZone& z = (*safety_zones)[zone];
+            if (z.action == ZONE_ACTION_LIMIT_SPEED && speed_available) {
+                speed_limited |= z.robot_mask & handled;
             } else {
-                // 暂停，但没有我们记录的作业名. 不是我们暂停的.
-                if (!state.message_sent_recovered) {
-                     std::string msg = "安全触发解除，机械臂" + std::to_string(id) + "处于暂停状态但无记录的作业，需手动恢复";
-                     NRC_TriggerErrorReport(0, msg); // 信息级别通知
-                     if(file_logger) SPDLOG_WARN(msg);
-                     state.message_sent_recovered = true; // 防止重复消息
-                     state.message_sent_limited = false;
-                } else {
-                    if(file_logger) SPDLOG_DEBUG("机械臂 {} 无记录作业而暂停，并在当前正常阶段发送过恢复消息.", id);
-                }
+                paused |= z.robot_mask & handled;
             }
-        } else { // 机器人已停止 (0) 或运行 (2)
-             if (!state.message_sent_recovered) {
-                 std::string msg_status = (state.current_run_status == 2) ? "运行" : "停止";
-                 std::string msg = "安全触发解除，机械臂" + std::to_string(id) + "已处于" + msg_status + "状态，无需恢复";
-                 NRC_TriggerErrorReport(0, msg); // 信息级别通知
-                 if(file_logger) SPDLOG_INFO(msg);
-                 state.message_sent_recovered = true;
-                 state.message_sent_limited = false;
-             } else {
-                 if(file_logger) SPDLOG_DEBUG("机械臂 {} 已停止/运行，并在当前正常阶段发送过恢复消息.", id);
-             }
-             // 如果机器人通过其他方式恢复/停止，则清除作业名
-             state.last_job_name.clear();
         }
     }
-    // 调用者释放 mutex
+    return paused;
 }
 
-
-static bool createDirectory(const std::string& path) {
-    struct stat st;
-    if (stat(path.c_str(), &st) == -1) {
-        if (mkdir(path.c_str(), 0755) == -1) {
-            if (errno != EEXIST) {
-                std::cerr << "[光栅安全控制] 创建目录失败: " + std::string(strerror(errno)) << std::endl;
-                if(file_logger) SPDLOG_ERROR("创建目录失败: {}, 错误: {}", path, strerror(errno));
-                return false;
-            }
-        } else {
-            if(file_logger) SPDLOG_INFO("目录已创建: {}", path);
+// 检查每个区域的机器人都在受控集合 handled 中. 区域 IO 触发时只能暂停/限速受控机器人，
+// 不在集合中的机器人不会被停止. 不满足时 error 指出第一个区域与机器人.
+static bool check_zone_robots_handled(const std::vector<SafetyZone>& zones, uint32_t handled, std::string& error) {
+    for (const auto& zone : zones) {
+        const uint32_t missing = zone.robot_mask & ~handled;
+        if (missing != 0) {
+            error = "区域 " + zone.name + " 的机器人 " + std::to_string(__builtin_ctz(missing)) + " 不在受控机器人列表中";
+            return false;
         }
-    } else {
-         if(file_logger) SPDLOG_INFO("目录已存在: {}", path);
     }
     return true;
 }
 
-static bool fileExists(const std::string& path) {
-    struct stat buffer;
-    return (stat(path.c_str(), &buffer) == 0);
+// 装载配置后调用: 区域 (单元) 中不受控的机器人加入受控集合并告警，与 add_cell 相同，保证区域触发时一定能停止其机器人.
+// 假定调用者已持有 io_mutex.
+static void ensure_zone_robots_handled(const char* source) {
+    const uint32_t handled = handled_robot_mask.load();
+    uint32_t missing = 0;
+    for (const auto& zone : *safety_zones) {
+        const uint32_t zone_missing = zone.robot_mask & ~handled;
+        if (zone_missing == 0) continue;
+        if(file_logger) SPDLOG_WARN("{}中区域 {} 的机器人 (掩码 {:#x}) 不在受控机器人列表 (掩码 {:#x}) 中，已加入受控列表.",
+                                    source, zone.name, zone_missing, handled);
+        missing |= zone_missing;
+    }
+    if (missing != 0) {
+        set_handled_robots(handled | missing);
+    }
 }
 
-static bool setFilePermissions(const std::string& path) {
-    if (chmod(path.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) == -1) { // rw-r--r--
-        std::cerr << "[光栅安全控制] 设置文件权限失败: " + std::string(strerror(errno)) << std::endl;
-        if(file_logger) SPDLOG_ERROR("设置文件权限失败: {}, 错误: {}", path, strerror(errno));
+// 验证区域定义并规范化 (IO 号升序). 要求名称非空且不重复、每个 IO 在 0-2048 范围内且最多归属一个区域、
+// 机器人集合非空. 区域的 IO 列表可以为空 (新建的单元尚未配置 IO). 空列表表示不分区.
+static bool validate_safety_zones(std::vector<SafetyZone>& zones, std::string& error) {
+    if (zones.size() > static_cast<size_t>(MAX_SAFETY_ZONES)) {
+        error = "区域数量超过上限 " + std::to_string(MAX_SAFETY_ZONES);
         return false;
     }
-    if(file_logger) SPDLOG_INFO("文件权限设置成功: {}", path);
+    std::vector<int8_t> owner(2049, -1);
+    for (size_t z = 0; z < zones.size(); ++z) {
+        auto& zone = zones[z];
+        if (zone.name.empty()) {
+            error = "第 " + std::to_string(z) + " 个区域缺少名称";
+            return false;
+        }
+        for (size_t prev = 0; prev < z; ++prev) {
+            if (zones[prev].name == zone.name) {
+                error = "区域名称 " + zone.name + " 重复";
+                return false;
+            }
+        }
+        if (zone.robot_mask == 0 || (zone.robot_mask & 1u) != 0) {
+            error = "区域 " + zone.name + " 的机器人列表无效";
+            return false;
+        }
+        if (zone.action != ZONE_ACTION_PAUSE && zone.action != ZONE_ACTION_LIMIT_SPEED) {
+            error = "区域 " + zone.name + " 的动作无效";
+            return false;
+        }
+        for (int io_index : zone.io_indices) {
+            if (io_index < 0 || io_index > 2048) {
+                error = "区域 " + zone.name + " 的 IO " + std::to_string(io_index) + " 超出 0-2048 范围";
+                return false;
+            }
+            if (owner[io_index] >= 0) {
+                error = "IO " + std::to_string(io_index) + " 同时归属多个区域";
+                return false;
+            }
+            owner[io_index] = static_cast<int8_t>(z);
+        }
+        std::sort(zone.io_indices.begin(), zone.io_indices.end());
+    }
     return true;
 }
 
-// 保存当前配置 (io_list_indexed 和 configured_limited_speed) 到文件
-// 假定调用者已持有 io_mutex. 不再有最外层 try-catch
-static bool save_to_file() {
-    std::string filename = CONFIG_DIR + "/" + CONFIG_FILE_NAME;
-    json j;
+// 安装已验证的区域定义并重建 IO 号到区域的映射. 假定调用者已持有 io_mutex (或处于单线程初始化阶段).
+// 受影响机器人的暂停/恢复由监测线程在下一周期按新的区域归属调和.
+static void install_safety_zones(std::vector<SafetyZone> zones) {
+    std::fill(zone_by_io.begin(), zone_by_io.end(), -1);
+    for (size_t z = 0; z < zones.size(); ++z) {
+        for (int io_index : zones[z].io_indices) {
+            zone_by_io[io_index] = static_cast<int8_t>(z);
+        }
+    }
+    safety_zones = std::make_shared<const std::vector<SafetyZone>>(std::move(zones));
+}
 
-    // 确保目录存在
-    if (!createDirectory(CONFIG_DIR)) {
-        // 错误已在 createDirectory 中记录
-        return false;
+// 按名称查找区域 (单元)，返回下标，不存在时返回 -1.
+static int find_zone(const std::vector<SafetyZone>& zones, const std::string& name) {
+    for (size_t z = 0; z < zones.size(); ++z) {
+        if (zones[z].name == name) return static_cast<int>(z);
     }
+    return -1;
+}
 
-    if(file_logger) SPDLOG_INFO("准备保存配置到文件: {}", filename);
+// 单元配置文件路径: 名称中 [A-Za-z0-9_-] 以外的字节按 %XX 编码，不同名称总是对应不同文件.
+static std::string cell_config_path(const std::string& cell) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string stem;
+    stem.reserve(cell.size());
+    for (unsigned char c : cell) {
+        if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_' || c == '-') {
+            stem += static_cast<char>(c);
+        } else {
+            stem += '%';
+            stem += hex[c >> 4];
+            stem += hex[c & 0xF];
+        }
+    }
+    return CELL_CONFIG_DIR + "/" + stem + ".json";
+}
 
-    j["last_update"] = std::time(nullptr);
-    j["io_config"] = json::array();
+// 创建单元实例: 确定配置文件路径并建立单元日志器. 主日志未初始化或日志文件无法创建时不建立日志器，
+// 单元的消息仍写入主日志. 会创建目录与日志文件，运行中不在持有 io_mutex 时调用.
+static std::shared_ptr<const RasterSafetyInstance> make_cell_instance(const std::string& cell) {
+    std::shared_ptr<RasterSafetyInstance> instance = std::make_shared<RasterSafetyInstance>();
+    instance->cell_id = cell;
+    instance->config_file = cell_config_path(cell);
+    if (!file_logger || !spdlog::thread_pool() || !createDirectory(CELL_CONFIG_DIR)) {
+        return instance;
+    }
+    const std::string log_path = instance->config_file.substr(0, instance->config_file.size() - 5) + ".log";
+    try {
+        auto sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(log_path, CELL_LOG_FILE_SIZE, LOG_FILES_COUNT);
+        instance->logger = std::make_shared<spdlog::async_logger>("raster_safety." + cell, sink, spdlog::thread_pool(),
+                                                                  spdlog::async_overflow_policy::overrun_oldest);
+        instance->logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] %v");
+        instance->logger->flush_on(spdlog::level::info);
+    } catch (const spdlog::spdlog_ex& ex) {
+        if(file_logger) SPDLOG_WARN("单元 {} 的日志文件 {} 创建失败 ({})，单元消息只写入主日志.", cell, log_path, ex.what());
+    }
+    return instance;
+}
 
-    // 遍历索引列表查找已配置的 IO
-    for (int i = 0; i < io_list_indexed.size(); ++i) {
-        const auto& cfg = io_list_indexed[i];
-        if (cfg.is_configured) {
-             json io_item;
-             io_item["io_index"] = cfg.io_index;
-             io_item["reset_io_index"] = cfg.reset_io_index;
-             io_item["trigger_value"] = cfg.trigger_value; // 保存存储的 int 值 (0 或 1)
-             io_item["description"] = cfg.description;
-             j["io_config"].push_back(io_item);
-             if(file_logger) SPDLOG_DEBUG("添加到保存JSON的IO: 索引{}, 复位{}, 触发值{}, 描述='{}'", cfg.io_index, cfg.reset_io_index, cfg.trigger_value, cfg.description);
-        }
+// 为区域定义绑定单元实例: 同名单元沿用当前实例 (配置文件与日志器不变)，新单元创建实例.
+// 假定调用者已持有 config_update_mutex (或处于单线程初始化阶段).
+static void bind_cell_instances(std::vector<SafetyZone>& zones) {
+    const std::vector<SafetyZone>& current = *safety_zones;
+    for (auto& zone : zones) {
+        if (zone.instance && zone.instance->cell_id == zone.name) continue;
+        int z = find_zone(current, zone.name);
+        zone.instance = (z >= 0 && current[z].instance) ? current[z].instance : make_cell_instance(zone.name);
     }
+}
 
-    j["limited_speed"] = configured_limited_speed; // 保存配置的值
+// IO 所属单元的日志器 (IO 未归属单元或单元日志器未建立时为 nullptr). 假定调用者已持有 io_mutex，
+// 返回的指针在释放 io_mutex 前有效.
+static spdlog::logger* cell_logger_for_io(int io_index) {
+    int zone = zone_by_io[io_index];
+    if (zone < 0) return nullptr;
+    const auto& instance = (*safety_zones)[zone].instance;
+    return instance ? instance->logger.get() : nullptr;
+}
 
-    std::ofstream file(filename.c_str());
-    if (!file) {
-        std::cerr << "[光栅安全控制] 无法打开配置文件进行写入: " + filename << std::endl;
-        if(file_logger) SPDLOG_ERROR("无法打开配置文件进行写入: {}", filename);
+// 取请求中的可选 cell 字段: 缺省时 cell 为空 (作用于整个进程); 给出时须为已存在单元的名称
+static bool resolve_request_cell(const Json::Value& root, std::string& cell, std::string& message) {
+    cell.clear();
+    if (!root.isMember("cell")) {
+        return true;
+    }
+    if (!root["cell"].isString() || root["cell"].asString().empty()) {
+        message = "无效参数 cell";
         return false;
     }
-
-    // 写入文件内容，这部分使用 try-catch 捕获 JSON 库可能抛出的异常
-    try {
-        file << j.dump(4); // 漂亮打印，缩进 4 个空格
-        if(file_logger) SPDLOG_DEBUG("JSON内容已写入文件.");
-    } catch (const std::exception& e) {
-        std::cerr << "[光栅安全控制] 写入配置文件内容时发生 JSON 异常: " + std::string(e.what()) << std::endl;
-        if(file_logger) SPDLOG_ERROR("写入配置文件内容时发生 JSON 异常: {}", e.what());
-        file.close(); // 确保文件关闭
+    std::shared_ptr<const SafetyStatusSnapshot> snap = load_status_snapshot();
+    if (!snap || find_zone(*snap->zones, root["cell"].asString()) < 0) {
+        message = "单元 " + root["cell"].asString() + " 不存在";
         return false;
     }
+    cell = root["cell"].asString();
+    return true;
+}
 
-    file.close();
+// 记录一次延迟 (任意线程，无锁)
+static void record_latency(LatencyHistogram& hist, std::chrono::steady_clock::duration elapsed) {
+    long long us_signed = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    uint64_t us = us_signed > 0 ? static_cast<uint64_t>(us_signed) : 0;
+    int bucket = 0;
+    if (us >= 2) {
+        bucket = 63 - __builtin_clzll(us); // floor(log2(us))
+        if (bucket >= LatencyHistogram::BUCKET_COUNT) bucket = LatencyHistogram::BUCKET_COUNT - 1;
+    }
+    hist.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    hist.count.fetch_add(1, std::memory_order_relaxed);
+    hist.sum_us.fetch_add(us, std::memory_order_relaxed);
+    uint64_t prev_max = hist.max_us.load(std::memory_order_relaxed);
+    while (us > prev_max && !hist.max_us.compare_exchange_weak(prev_max, us, std::memory_order_relaxed)) {
+    }
+}
 
-    // 检查文件关闭是否成功 (虽然 file.close() 通常不抛异常，但检查可以发现其他问题)
-    if (file.fail()) {
-         std::cerr << "[光栅安全控制] 写入配置文件后关闭文件失败: " + filename << std::endl;
-         if(file_logger) SPDLOG_ERROR("写入配置文件后关闭文件失败: {}", filename);
-         return false;
+// 估算分位数 (微秒): 返回累计计数达到 quantile 的桶的上界，不超过记录的最大值
+static uint64_t histogram_percentile(const LatencyHistogram& hist, double quantile) {
+    uint64_t total = hist.count.load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(total)));
+    if (target < 1) target = 1;
+    uint64_t cumulative = 0;
+    for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+        cumulative += hist.buckets[i].load(std::memory_order_relaxed);
+        if (cumulative >= target) {
+            uint64_t upper = (uint64_t(2) << i) - 1;
+            return std::min(upper, hist.max_us.load(std::memory_order_relaxed));
+        }
     }
+    return hist.max_us.load(std::memory_order_relaxed);
+}
 
+static Json::Value histogram_to_json(const LatencyHistogram& hist) {
+    Json::Value item(Json::objectValue);
+    uint64_t count = hist.count.load(std::memory_order_relaxed);
+    item["count"] = Json::UInt64(count);
+    item["p50_us"] = Json::UInt64(histogram_percentile(hist, 0.50));
+    item["p99_us"] = Json::UInt64(histogram_percentile(hist, 0.99));
+    item["max_us"] = Json::UInt64(hist.max_us.load(std::memory_order_relaxed));
+    item["mean_us"] = Json::UInt64(count ? hist.sum_us.load(std::memory_order_relaxed) / count : 0);
+    return item;
+}
 
-    if (!setFilePermissions(filename)) {
-        // 错误已在 setFilePermissions 中记录
-        // 文件已保存，但权限设置失败，仍视为保存不完全成功
-        if(file_logger) SPDLOG_WARN("配置文件已写入，但权限设置失败: {}", filename);
-        return false;
+static void reset_histogram(LatencyHistogram& hist) {
+    for (auto& b : hist.buckets) b.store(0, std::memory_order_relaxed);
+    hist.count.store(0, std::memory_order_relaxed);
+    hist.sum_us.store(0, std::memory_order_relaxed);
+    hist.max_us.store(0, std::memory_order_relaxed);
+}
+
+// 剖析关闭时只记录持有者; 开启时先尝试无等待加锁，失败则计入竞争并记下当时的持有者.
+void ProfiledMutex::lock(LockSite site) {
+    if (!lock_profiling_enabled.load(std::memory_order_relaxed)) {
+        mutex_.lock();
+        profiled_ = false;
+        holder_.store(site, std::memory_order_relaxed);
+        return;
     }
+    LockSiteStats& stats = lock_site_stats[site];
+    auto requested = std::chrono::steady_clock::now();
+    if (!mutex_.try_lock()) {
+        stats.contended.fetch_add(1, std::memory_order_relaxed);
+        int holder = holder_.load(std::memory_order_relaxed);
+        if (holder >= 0) stats.blocked_by[holder].fetch_add(1, std::memory_order_relaxed);
+        mutex_.lock();
+    }
+    acquired_at_ = std::chrono::steady_clock::now();
+    profiled_ = true;
+    holder_.store(site, std::memory_order_relaxed);
+    record_latency(stats.wait, acquired_at_ - requested);
+}
 
-    if(file_logger) SPDLOG_INFO("配置文件保存成功: {}", filename);
+// 先释放再记录持有时间，统计本身不延长临界区
+void ProfiledMutex::unlock() {
+    const int site = holder_.load(std::memory_order_relaxed);
+    const bool profiled = profiled_;
+    const auto acquired_at = acquired_at_;
+    holder_.store(-1, std::memory_order_relaxed);
+    mutex_.unlock();
+    if (!profiled || site < 0) {
+        return;
+    }
+    LockSiteStats& stats = lock_site_stats[site];
+    uint64_t prev_max = stats.hold.max_us.load(std::memory_order_relaxed);
+    record_latency(stats.hold, std::chrono::steady_clock::now() - acquired_at);
+    if (stats.hold.max_us.load(std::memory_order_relaxed) > prev_max) {
+        stats.max_hold_at.store(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+    }
+}
+
+// 开启/关闭 io_mutex 剖析. root 字段: enabled (bool, 必需), log_interval_ms (可选), reset (可选，清零已有统计).
+// 剖析状态不持久化，服务重启后关闭.
+static bool update_lock_profiling(const Json::Value& root, std::string& message) {
+    if (!root["enabled"].isBool()) {
+        message = "缺少或无效的 enabled (bool)";
+        return false;
+    }
+    const bool enabled = root["enabled"].asBool();
+    int interval_ms = lock_profile_log_interval_ms.load();
+    if (root.isMember("log_interval_ms")) {
+        if (!root["log_interval_ms"].isInt() || root["log_interval_ms"].asInt() < LOCK_PROFILE_LOG_INTERVAL_MIN_MS ||
+            root["log_interval_ms"].asInt() > LOCK_PROFILE_LOG_INTERVAL_MAX_MS) {
+            message = "log_interval_ms 必须在 " + std::to_string(LOCK_PROFILE_LOG_INTERVAL_MIN_MS) + "-" +
+                      std::to_string(LOCK_PROFILE_LOG_INTERVAL_MAX_MS) + " 范围内";
+            return false;
+        }
+        interval_ms = root["log_interval_ms"].asInt();
+    }
+    if (root["reset"].isBool() && root["reset"].asBool()) {
+        reset_lock_profile();
+    }
+    lock_profile_log_interval_ms.store(interval_ms);
+    lock_profiling_enabled.store(enabled);
+    {
+        // 唤醒配置写入线程，按新的开关与周期重新计时
+        std::lock_guard<std::mutex> lock(config_save_mutex);
+        lock_profile_settings_version.fetch_add(1);
+    }
+    config_save_cv.notify_all();
+    if(file_logger) SPDLOG_INFO("io_mutex 锁剖析已{} (日志周期 {}ms).", enabled ? "开启" : "关闭", interval_ms);
+    message = enabled ? "锁剖析已开启" : "锁剖析已关闭";
     return true;
 }
 
-static bool load_from_file() {
-    std::string filename = CONFIG_DIR + "/" + CONFIG_FILE_NAME;
-    std::ifstream file;
-    json j;
+// get_metrics 的 io_mutex 部分: 各调用点的等待/持有分布、竞争次数与阻塞它的调用点，以及全局最长持有
+static Json::Value lock_profile_to_json() {
+    Json::Value result(Json::objectValue);
+    result["enabled"] = lock_profiling_enabled.load();
+    Json::Value sites(Json::arrayValue);
+    int longest_site = -1;
+    uint64_t longest_us = 0;
+    for (int i = 0; i < LOCK_SITE_COUNT; ++i) {
+        const LockSiteStats& stats = lock_site_stats[i];
+        if (stats.wait.count.load(std::memory_order_relaxed) == 0) continue;
+        Json::Value item(Json::objectValue);
+        item["site"] = LOCK_SITE_NAMES[i];
+        item["wait"] = histogram_to_json(stats.wait);
+        item["hold"] = histogram_to_json(stats.hold);
+        item["contended"] = Json::UInt64(stats.contended.load(std::memory_order_relaxed));
+        Json::Value blocked_by(Json::objectValue);
+        for (int h = 0; h < LOCK_SITE_COUNT; ++h) {
+            uint64_t n = stats.blocked_by[h].load(std::memory_order_relaxed);
+            if (n) blocked_by[LOCK_SITE_NAMES[h]] = Json::UInt64(n);
+        }
+        item["blocked_by"] = blocked_by;
+        item["max_hold_at"] = Json::Int64(stats.max_hold_at.load(std::memory_order_relaxed));
+        sites.append(item);
+        uint64_t max_us = stats.hold.max_us.load(std::memory_order_relaxed);
+        if (max_us > longest_us || longest_site < 0) {
+            longest_us = max_us;
+            longest_site = i;
+        }
+    }
+    result["sites"] = sites;
+    if (longest_site >= 0) {
+        Json::Value longest(Json::objectValue);
+        longest["site"] = LOCK_SITE_NAMES[longest_site];
+        longest["hold_us"] = Json::UInt64(longest_us);
+        longest["at"] = Json::Int64(lock_site_stats[longest_site].max_hold_at.load(std::memory_order_relaxed));
+        result["longest_hold"] = longest;
+    }
+    return result;
+}
 
-    // 确保目录存在
-    if (!createDirectory(CONFIG_DIR)) {
-        if(file_logger) SPDLOG_ERROR("加载配置失败: 创建目录失败.");
-        return false;
+static void reset_lock_profile() {
+    for (auto& stats : lock_site_stats) {
+        reset_histogram(stats.wait);
+        reset_histogram(stats.hold);
+        stats.contended.store(0, std::memory_order_relaxed);
+        for (auto& n : stats.blocked_by) n.store(0, std::memory_order_relaxed);
+        stats.max_hold_at.store(0, std::memory_order_relaxed);
     }
+}
 
-    if (!fileExists(filename)) {
-        // 如果找不到配置文件，则创建一个默认文件
-        if(file_logger) SPDLOG_INFO("配置文件未找到: {}，将尝试创建默认配置.", filename);
-        bool created_default = save_to_file();
-        if (created_default) {
-            if(file_logger) SPDLOG_INFO("默认配置文件已创建.");
-            return true; // 默认配置已创建并加载
-        } else {
-            std::cerr << "[光栅安全控制] 无法创建默认配置文件: " + filename << std::endl;
-            if(file_logger) SPDLOG_ERROR("无法创建默认配置文件: {}", filename);
-            return false; // 无法创建默认文件
+// 周期性记录锁剖析摘要 (每个有记录的调用点一行). 在配置写入线程中调用，不持有任何锁.
+static void log_lock_profile() {
+    if (!file_logger) return;
+    for (int i = 0; i < LOCK_SITE_COUNT; ++i) {
+        const LockSiteStats& stats = lock_site_stats[i];
+        uint64_t count = stats.wait.count.load(std::memory_order_relaxed);
+        if (count == 0) continue;
+        int blocker = -1;
+        uint64_t blocker_count = 0;
+        for (int h = 0; h < LOCK_SITE_COUNT; ++h) {
+            uint64_t n = stats.blocked_by[h].load(std::memory_order_relaxed);
+            if (n > blocker_count) {
+                blocker_count = n;
+                blocker = h;
+            }
         }
+        SPDLOG_INFO("[锁剖析] io_mutex {}: 获取 {} 次, 竞争 {} 次 (主要阻塞者 {}), 等待 p99 {}us / 最大 {}us, 持有 p99 {}us / 最大 {}us",
+                    LOCK_SITE_NAMES[i], count, stats.contended.load(std::memory_order_relaxed),
+                    blocker >= 0 ? LOCK_SITE_NAMES[blocker] : "-",
+                    histogram_percentile(stats.wait, 0.99), stats.wait.max_us.load(std::memory_order_relaxed),
+                    histogram_percentile(stats.hold, 0.99), stats.hold.max_us.load(std::memory_order_relaxed));
     }
+}
 
-    // 文件存在，尝试打开
-    file.open(filename.c_str());
-    if (!file) {
-        std::cerr << "[光栅安全控制] 无法打开配置文件进行读取: " + filename << std::endl;
-        if(file_logger) SPDLOG_ERROR("无法打开配置文件进行读取: {}", filename);
-        return false;
+// 打开 (必要时创建) 事件日志文件并映射到内存. 头部不匹配时重新初始化.
+static bool open_event_journal() {
+    if (event_journal.ready.load(std::memory_order_acquire)) {
+        return true; // 已映射 (服务重启时复用)
     }
+    std::string path = CONFIG_DIR + "/" + EVENT_JOURNAL_FILE_NAME;
+    size_t file_size = sizeof(EventJournalHeader) + size_t(EVENT_JOURNAL_CAPACITY) * sizeof(EventRecord);
 
-    // 解析文件内容
-    try {
-        file >> j;
-        if(file_logger) SPDLOG_DEBUG("配置文件内容已成功解析为 JSON.");
-    } catch(const std::exception& e) {
-        std::cerr << "[光栅安全控制] 配置文件解析失败: " + std::string(e.what()) << std::endl;
-        if(file_logger) SPDLOG_ERROR("配置文件解析失败: {}", e.what());
-        file.close();
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        if(file_logger) SPDLOG_ERROR("打开事件日志文件 {} 失败: {}", path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    bool fresh = (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != file_size);
+    if (fresh && ftruncate(fd, static_cast<off_t>(file_size)) != 0) {
+        if(file_logger) SPDLOG_ERROR("设置事件日志文件 {} 大小失败: {}", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // 映射建立后文件描述符不再需要
+    if (base == MAP_FAILED) {
+        if(file_logger) SPDLOG_ERROR("映射事件日志文件 {} 失败: {}", path, strerror(errno));
         return false;
     }
 
-    file.close(); // 解析成功后关闭文件
+    auto* header = static_cast<EventJournalHeader*>(base);
+    if (fresh || header->magic != EVENT_JOURNAL_MAGIC || header->version != EVENT_JOURNAL_VERSION ||
+        header->capacity != EVENT_JOURNAL_CAPACITY || header->record_size != sizeof(EventRecord)) {
+        if(file_logger) SPDLOG_WARN("事件日志文件 {} 不存在或格式不匹配，重新初始化.", path);
+        std::memset(base, 0, file_size);
+        header->magic = EVENT_JOURNAL_MAGIC;
+        header->version = EVENT_JOURNAL_VERSION;
+        header->capacity = EVENT_JOURNAL_CAPACITY;
+        header->record_size = sizeof(EventRecord);
+    }
+    setFilePermissions(path);
 
-    // 将 io_list_indexed 重置为默认状态
-    io_list_indexed.assign(2049, IOConfig());
-    if(file_logger) SPDLOG_DEBUG("内存中配置已重置为默认状态.");
+    event_journal.header = header;
+    event_journal.records = reinterpret_cast<EventRecord*>(static_cast<char*>(base) + sizeof(EventJournalHeader));
+    event_journal.ready.store(true, std::memory_order_release);
+    if(file_logger) SPDLOG_INFO("事件日志已映射: {} (容量 {} 条，下一序号 {}).", path, EVENT_JOURNAL_CAPACITY,
+                                __atomic_load_n(&header->next_seq, __ATOMIC_RELAXED));
+    return true;
+}
 
-    int loaded_io_count = 0; // <-- 将声明移到此处，使其作用域包含后续的 SPDLOG_INFO
+// 以当前时间和默认字段构造一条事件记录
+static EventRecord make_event(EventType type) {
+    EventRecord rec;
+    std::memset(&rec, 0, sizeof(rec));
+    rec.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::system_clock::now().time_since_epoch()).count();
+    rec.io_index = -1;
+    rec.robot_id = -1;
+    rec.type = type;
+    rec.from_state = rec.to_state = static_cast<uint8_t>(current_system_state.load(std::memory_order_relaxed));
+    return rec;
+}
 
-    if (j.contains("io_config") && j["io_config"].is_array()) { // <-- if 块开始
-        const auto& io_config = j["io_config"];
-        if(file_logger) SPDLOG_DEBUG("配置文件包含 'io_config' 数组，开始加载 IO 配置...");
+// 追加一条事件 (任意线程). 先清除槽位提交标记，写入内容后以 release 语义写入 序号+1.
+static void append_event(const EventRecord& rec) {
+    if (!event_journal.ready.load(std::memory_order_acquire)) return;
+    uint64_t seq = __atomic_fetch_add(&event_journal.header->next_seq, 1, __ATOMIC_RELAXED);
+    EventRecord* slot = &event_journal.records[seq % EVENT_JOURNAL_CAPACITY];
+    __atomic_store_n(&slot->commit, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    std::memcpy(reinterpret_cast<char*>(slot) + sizeof(slot->commit),
+                reinterpret_cast<const char*>(&rec) + sizeof(rec.commit),
+                sizeof(EventRecord) - sizeof(rec.commit));
+    __atomic_store_n(&slot->commit, seq + 1, __ATOMIC_RELEASE);
+}
 
-        for (const auto& item : io_config) {
-            if (item.is_object() && item.contains("io_index") && item["io_index"].is_number_integer()) {
-                int io_index = item["io_index"].get<int>();
-
-                if (io_index >= 0 && io_index <= 2048) {
-                    IOConfig cfg;
-                    cfg.io_index = io_index;
-                    cfg.reset_io_index = item.value("reset_io_index", 0);
-                    cfg.trigger_value = item.value("trigger_value", 1);
-                    cfg.description = item.value("description", "");
-                    cfg.already_triggered = false;
-                    cfg.trigger_time = 0;
-                    cfg.is_configured = true;
-
-                    if (cfg.reset_io_index < 0 || cfg.reset_io_index > 2048) {
-                         if(file_logger) SPDLOG_WARN("配置文件中IO {} 的复位IO索引 {} 无效. 将复位IO索引设为 0.", cfg.io_index, cfg.reset_io_index);
-                         cfg.reset_io_index = 0;
-                    }
-                    if (cfg.trigger_value != 0 && cfg.trigger_value != 1) {
-                        if(file_logger) SPDLOG_WARN("配置文件中IO {} 的触发值 {} 无效. 将设为默认值 1.", cfg.io_index, cfg.trigger_value);
-                        cfg.trigger_value = 1;
-                    }
+// 读取序号为 seq 的事件. 槽位已被覆盖、正在写入或写入未完成 (如崩溃) 时返回 false.
+static bool read_event(uint64_t seq, EventRecord& out) {
+    const EventRecord* slot = &event_journal.records[seq % EVENT_JOURNAL_CAPACITY];
+    uint64_t before = __atomic_load_n(&slot->commit, __ATOMIC_ACQUIRE);
+    if (before != seq + 1) return false;
+    std::memcpy(&out, slot, sizeof(EventRecord));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot->commit, __ATOMIC_RELAXED) == before;
+}
 
-                    io_list_indexed[io_index] = cfg;
-                    loaded_io_count++;
-                    if(file_logger) {
-                         std::string debug_msg = "加载 IO 配置: 索引" + std::to_string(cfg.io_index) + ", 复位=" + std::to_string(cfg.reset_io_index) + ", 触发值=" + std::to_string(cfg.trigger_value) + ", 描述='" + cfg.description + "'";
-                         SPDLOG_DEBUG(debug_msg);
-                    }
-                } else {
-                    if(file_logger) SPDLOG_WARN("配置文件中无效的 IO 索引 {}，应在 0-2048 范围内. 跳过此条目.", io_index);
-                }
-            } // <-- 这里不需要 else
+static const char* event_type_name(uint8_t type) {
+    switch (type) {
+        case EVENT_IO_TRIGGERED: return "io_triggered";
+        case EVENT_IO_RESET:     return "io_reset";
+        case EVENT_STATE_CHANGE: return "state_change";
+        case EVENT_ROBOT_PAUSE:  return "robot_pause";
+        case EVENT_ROBOT_RESUME: return "robot_resume";
+        case EVENT_MANUAL_RESET: return "manual_reset";
+        case EVENT_ROBOT_SPEED:  return "robot_speed";
+        default:                 return "unknown";
+    }
+}
+
+// 并发执行 count 个控制器调用任务 task(context, 0..count-1)，全部完成后返回. 只在动作执行线程中调用.
+static void run_controller_fanout(void (*task)(void* context, int index), void* context, int count) {
+    ControllerFanout& f = controller_fanout;
+    std::unique_lock<std::mutex> lock(f.mutex);
+    if (!f.running || count <= 1) {
+        lock.unlock();
+        for (int i = 0; i < count; ++i) task(context, i);
+        return;
+    }
+    f.task = task;
+    f.context = context;
+    f.count = count;
+    f.next = 0;
+    f.completed = 0;
+    f.work_cv.notify_all();
+    while (f.next < f.count) { // 本线程同样领取任务
+        int i = f.next++;
+        lock.unlock();
+        task(context, i);
+        lock.lock();
+        f.completed++;
+    }
+    f.done_cv.wait(lock, [&f] { return f.completed == f.count; });
+    f.count = 0;
+    f.next = 0;
+}
+
+// 控制器调用扇出工作线程: 领取并执行任务，本批最后一个任务完成时通知动作执行线程
+static void controller_fanout_thread() {
+    ControllerFanout& f = controller_fanout;
+    std::unique_lock<std::mutex> lock(f.mutex);
+    while (true) {
+        f.work_cv.wait(lock, [&f] { return !f.running || f.next < f.count; });
+        if (!f.running) {
+            break;
+        }
+        int i = f.next++;
+        void (*task)(void*, int) = f.task;
+        void* context = f.context;
+        lock.unlock();
+        task(context, i);
+        lock.lock();
+        if (++f.completed == f.count) {
+            f.done_cv.notify_one();
         }
-        if(file_logger) SPDLOG_DEBUG("IO 配置数组加载完成. 加载了 {} 个有效 IO 配置条目.", loaded_io_count);
-    } // <-- 在这里添加 if (j.contains("io_config")...) 的闭合花括号 '}'
-    else { // <-- 这个 else 现在与上面的 if 配对
-         if(file_logger) SPDLOG_WARN("配置文件不包含有效的 'io_config' 数组或数组为空.");
     }
+}
 
+// steady_clock 当前时刻 (纳秒)，用于比较不同线程对同一机器人运行状态查询的先后
+static int64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-    // 加载 configured_limited_speed
-    configured_limited_speed = j.value("limited_speed", configured_limited_speed);
-    if (configured_limited_speed < 0 || configured_limited_speed > 100) {
-         if(file_logger) SPDLOG_WARN("从文件加载的 configured_limited_speed {} 无效. 使用默认值 {}.", configured_limited_speed, 30);
-         configured_limited_speed = 30;
+// 确认机器人运行状态: 每 STATE_CONFIRM_POLL_MS 查询一次尚未确认的机器人，
+// 全部达到 target_status (RUN_STATUS_NOT_RUNNING 表示任一非运行状态) 或超过 state_confirm_timeout_ms 时返回.
+// final_status 返回每个机器人最后一次查询到的状态 (与 ids 一一对应，由调用者提供 count 个元素).
+// 返回值为实际确认耗时 (毫秒).
+static int confirm_run_status(const int* ids, int count, int target_status, int* final_status) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::milliseconds(state_confirm_timeout_ms.load());
+
+    auto reached = [target_status](int status) {
+        return target_status == RUN_STATUS_NOT_RUNNING ? (status == 0 || status == 1) : status == target_status;
+    };
+    std::fill(final_status, final_status + count, -1);
+    // 每轮并发查询尚未确认的机器人 (按机器人上限定长，不分配)
+    struct ConfirmRound {
+        const int* ids;
+        int* final_status;
+        int todo[MAX_ROBOT_ID + 1];
+    } round;
+    round.ids = ids;
+    round.final_status = final_status;
+    int confirmed = 0;
+    while (true) {
+        int todo_count = 0;
+        for (int i = 0; i < count; ++i) {
+            if (!reached(final_status[i])) round.todo[todo_count++] = i; // 已确认的不再查询
+        }
+        run_controller_fanout([](void* context, int index) {
+            ConfirmRound& r = *static_cast<ConfirmRound*>(context);
+            const int i = r.todo[index];
+            r.final_status[i] = controller().get_run_status(r.ids[i]);
+        }, &round, todo_count);
+        for (int k = 0; k < todo_count; ++k) {
+            if (reached(final_status[round.todo[k]])) confirmed++;
+        }
+        if (confirmed == count || std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(STATE_CONFIRM_POLL_MS));
     }
-    if(file_logger) SPDLOG_DEBUG("configured_limited_speed 已加载: {}%", configured_limited_speed);
 
-    // loaded_io_count 现在在此处是可见的
-    if(file_logger) SPDLOG_INFO("成功从文件加载配置. 已加载配置 IO {} 条, 配置的限速: {}%", loaded_io_count, configured_limited_speed);
-    return true;
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count());
 }
 
-// 主状态机循环
-static void io_monitor_thread() {
-    std::cout << "[光栅安全控制] IO监测线程启动!" << std::endl;
-    if(file_logger) SPDLOG_INFO("[光栅安全控制] IO监测线程启动!");
+// IO 配置表操作. 操作全局 io_table 时假定调用者已持有 io_mutex (或处于单线程初始化阶段);
+// 操作调用者私有的表 (如 updateIOConfig 在锁外构建的新表) 时无需加锁.
+
+// 以一组条目整体替换配置表 (排序去重后一次性重建映射、读取集合与掩码). 假定 io_index 已验证.
+static void assign_io_entries(IOTable& table, std::vector<IOConfig> entries) {
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const IOConfig& a, const IOConfig& b) { return a.io_index < b.io_index; });
+    table.slot_by_index.assign(2049, -1);
+    table.entries.clear();
+    table.entries.reserve(entries.size());
+    for (auto& cfg : entries) {
+        if (!table.entries.empty() && table.entries.back().io_index == cfg.io_index) {
+            table.entries.back() = std::move(cfg); // 重复的 io_index 以后者为准
+        } else {
+            table.slot_by_index[cfg.io_index] = static_cast<int>(table.entries.size());
+            table.entries.push_back(std::move(cfg));
+        }
+    }
+    rebuild_io_read_set(table);
+    rebuild_io_masks(table);
+}
 
-    // 如果机器人状态在服务启动时未初始化 (与服务启动中的逻辑重复，但更安全)
-    {
-        std::lock_guard<std::mutex> lock(io_mutex);
-        for(int id : handled_robot_ids) {
-            getRobotState(id); // 确保 map 条目存在
+// 重建每周期需要读取的 IO 号集合 (触发 IO 与大于 0 的复位 IO，升序去重)
+static void rebuild_io_read_set(IOTable& table) {
+    auto& read_set = table.read_set;
+    read_set.clear();
+    for (const auto& io : table.entries) {
+        read_set.push_back(io.io_index);
+        if (io.reset_io_index > 0) {
+            read_set.push_back(io.reset_io_index);
+        }
+    }
+    std::sort(read_set.begin(), read_set.end());
+    read_set.erase(std::unique(read_set.begin(), read_set.end()), read_set.end());
+}
+
+// 重建按槽位打包的 IO 数据与掩码
+static void rebuild_io_masks(IOTable& table) {
+    const size_t count = table.entries.size();
+    const size_t words = (count + 63) / 64;
+
+    table.trigger_io.resize(count);
+    table.reset_io.resize(count);
+    table.valid_mask.assign(words, 0);
+    table.polarity_mask.assign(words, 0);
+    table.reset_io_mask.assign(words, 0);
+    table.triggered_mask.assign(words, 0);
+
+    for (size_t i = 0; i < count; ++i) {
+        const auto& io = table.entries[i];
+        const uint64_t bit = uint64_t(1) << (i % 64);
+        table.trigger_io[i] = static_cast<uint16_t>(io.io_index);
+        table.reset_io[i] = static_cast<uint16_t>(io.reset_io_index > 0 ? io.reset_io_index : 0);
+        table.valid_mask[i / 64] |= bit;
+        if (io.trigger_value == 1) table.polarity_mask[i / 64] |= bit;
+        if (io.reset_io_index > 0) table.reset_io_mask[i / 64] |= bit;
+        if (io.already_triggered) table.triggered_mask[i / 64] |= bit;
+    }
+    table.debounce_version = ~0u; // 槽位变化，下次评估前重建去抖参数
+
+    // 驻留描述字符串: 相同描述只存一份，快照按下标引用
+    auto descriptions = std::make_shared<DescriptionTable>();
+    std::unordered_map<std::string, uint32_t> interned;
+    table.description_id.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const std::string& description = table.entries[i].description;
+        auto it = interned.find(description);
+        if (it == interned.end()) {
+            it = interned.emplace(description, static_cast<uint32_t>(descriptions->size())).first;
+            descriptions->push_back(description);
         }
+        table.description_id[i] = it->second;
     }
+    table.descriptions = std::move(descriptions);
+}
 
+// 按 io_debounce 重建表的按槽位去抖参数与掩码，并清空滤波状态. 假定调用者已持有 io_mutex.
+static void rebuild_io_debounce(IOTable& table) {
+    const size_t count = table.entries.size();
+    table.debounce_mask.assign(table.valid_mask.size(), 0);
+    table.debounce_cfg.resize(count);
+    table.debounce_state.assign(count, IODebounceState());
+    for (size_t i = 0; i < count; ++i) {
+        const IODebounce& d = io_debounce[table.entries[i].io_index];
+        table.debounce_cfg[i] = d;
+        if (d.trigger_samples > 1 || d.trigger_min_ms > 0 || d.reset_holdoff_ms > 0) {
+            table.debounce_mask[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+    table.debounce_version = io_debounce_version;
+}
 
-    while (thread_running) {
-        SystemState required_state = SYSTEM_STATE_NORMAL;
-        bool any_io_currently_meets_trigger = false; // 检查当前物理状态
-        bool any_io_has_already_triggered_flag = false; // 检查内部状态标志
+// 列出非缺省的去抖配置 (按 IO 号升序). 假定调用者已持有 io_mutex.
+static IODebounceList debounce_entries() {
+    IODebounceList entries;
+    for (int io_index = 0; io_index <= 2048; ++io_index) {
+        const IODebounce& d = io_debounce[io_index];
+        if (d.trigger_samples > 1 || d.trigger_min_ms > 0 || d.reset_holdoff_ms > 0) {
+            entries.emplace_back(io_index, d);
+        }
+    }
+    return entries;
+}
 
-        { // --- 状态机逻辑的锁范围 ---
-            std::lock_guard<std::mutex> lock(io_mutex); // 保护 IO 配置、状态和系统状态 (更新时)
-
-            // 步骤 1: 评估物理 IO 状态并更新内部 `already_triggered` 标志
-            for (int i = 0; i < io_list_indexed.size(); ++i) {
-                auto& io = io_list_indexed[i]; // 获取引用以便修改
-
-                if (!io.is_configured) continue; // 跳过未配置的条目
-
-                // IO索引已经验证过在0-2048范围内，可以安全调用read_io
-                bool current_io_value = read_io(io.io_index); // 假定 read_io 在此足够线程安全
-
-                // 如果此 IO 的触发条件当前满足
-                if (current_io_value == (io.trigger_value == 1)) { // 布尔值与 trigger_value (0 或 1) 比较
-                    any_io_currently_meets_trigger = true;
-                    // 如果这对特定 IO 是一个 *新的* 触发事件
-                    if (!io.already_triggered) {
-                        io.already_triggered = true; // 设置标志
-                        io.trigger_time = std::time(nullptr);
-                        if(file_logger) {
-                             std::string log_msg = "安全 IO 已触发: 索引 " + std::to_string(io.io_index) +
-                                                   " (描述: " + io.description + "), 配置触发值是 " + std::to_string(io.trigger_value) +
-                                                   ", 当前值是 " + (current_io_value ? "1" : "0") + ".";
-                             SPDLOG_WARN(log_msg);
-                        }
-                        // 特定 IO 触发的错误报告可以在此处发送，或者等待系统状态转换
-                        // 这里记录特定 IO 触发，通用系统状态转换报告稍后发送.
-                    }
+// 验证去抖配置: IO 号 0-2048 且不重复，trigger_samples 1-DEBOUNCE_MAX_SAMPLES，
+// trigger_min_ms 不超过 max_delay_ms (0-DEBOUNCE_MAX_DELAY_LIMIT_MS)，reset_holdoff_ms 0-DEBOUNCE_RESET_HOLDOFF_LIMIT_MS.
+static bool validate_debounce(const IODebounceList& entries, int max_delay_ms, std::string& error) {
+    if (max_delay_ms < 0 || max_delay_ms > DEBOUNCE_MAX_DELAY_LIMIT_MS) {
+        error = "max_delay_ms 应在 0-" + std::to_string(DEBOUNCE_MAX_DELAY_LIMIT_MS) + " 范围内";
+        return false;
+    }
+    std::bitset<2049> seen;
+    for (const auto& entry : entries) {
+        const int io_index = entry.first;
+        const IODebounce& d = entry.second;
+        if (io_index < 0 || io_index > 2048) {
+            error = "IO " + std::to_string(io_index) + " 超出 0-2048 范围";
+            return false;
+        }
+        if (seen[io_index]) {
+            error = "IO " + std::to_string(io_index) + " 重复";
+            return false;
+        }
+        seen[io_index] = true;
+        if (d.trigger_samples < 1 || d.trigger_samples > DEBOUNCE_MAX_SAMPLES) {
+            error = "IO " + std::to_string(io_index) + " 的 trigger_samples 应在 1-" + std::to_string(DEBOUNCE_MAX_SAMPLES) + " 范围内";
+            return false;
+        }
+        if (d.trigger_min_ms < 0 || d.trigger_min_ms > max_delay_ms) {
+            error = "IO " + std::to_string(io_index) + " 的 trigger_min_ms 应在 0-" + std::to_string(max_delay_ms) + " (max_delay_ms) 范围内";
+            return false;
+        }
+        if (d.reset_holdoff_ms < 0 || d.reset_holdoff_ms > DEBOUNCE_RESET_HOLDOFF_LIMIT_MS) {
+            error = "IO " + std::to_string(io_index) + " 的 reset_holdoff_ms 应在 0-" + std::to_string(DEBOUNCE_RESET_HOLDOFF_LIMIT_MS) + " 范围内";
+            return false;
+        }
+    }
+    return true;
+}
+
+// 安装已验证的去抖配置 (替换全部). 假定调用者已持有 io_mutex (或处于单线程初始化阶段).
+// 监测线程在下一次评估前重建按槽位的参数.
+static void install_debounce(const IODebounceList& entries, int max_delay_ms) {
+    std::fill(io_debounce.begin(), io_debounce.end(), IODebounce());
+    for (const auto& entry : entries) {
+        io_debounce[entry.first] = entry.second;
+    }
+    debounce_max_delay_ms = max_delay_ms;
+    io_debounce_version++;
+    debounce_list = std::make_shared<const IODebounceList>(debounce_entries());
+}
+
+// 对一个字中配置了去抖的槽位滤波. meets 为原始触发条件，accepted 输入为原始条件、输出为接受的触发条件;
+// resets 输入为原始复位、输出为保持期满后的复位. 有槽位仍在滤波中时置 pending.
+// 滤波期间触发条件短暂脱落不重置 assert_since: 只有最近 trigger_samples 个采样全部不满足且已持续
+// trigger_min_ms 未满足时才判为毛刺. 毛刺后不足 debounce_max_delay_ms 又满足的仍属同一次抖动，沿用首次满足时间，
+// 因此占空比再低的抖动 (间隔小于 debounce_max_delay_ms) 也会在首次满足 debounce_max_delay_ms 之后的第一个
+// 满足采样上被强制接受，孤立毛刺则不会. 强制接受的触发被锁存: 复位须保持 max(reset_holdoff_ms, debounce_max_delay_ms)，
+// 抖动中的脱落不会在下一周期复位，无专用复位 IO 时也不会在暂停/恢复之间往复.
+static void apply_debounce_word(size_t k, uint64_t meets, uint64_t triggered, uint64_t& accepted, uint64_t& resets,
+                                std::chrono::steady_clock::time_point now, bool& pending) {
+    const auto max_delay = std::chrono::milliseconds(debounce_max_delay_ms);
+    for (uint64_t bits = io_table.debounce_mask[k]; bits != 0; bits &= bits - 1) {
+        const int b = __builtin_ctzll(bits);
+        const uint64_t bit = uint64_t(1) << b;
+        const size_t slot = k * 64 + b;
+        const IODebounce& cfg = io_table.debounce_cfg[slot];
+        IODebounceState& st = io_table.debounce_state[slot];
+        st.history = (st.history << 1) | ((meets & bit) ? 1 : 0);
+
+        if ((triggered & bit) == 0) {
+            const uint64_t window = cfg.trigger_samples >= DEBOUNCE_MAX_SAMPLES
+                                        ? ~uint64_t(0) : (uint64_t(1) << cfg.trigger_samples) - 1;
+            if (meets & bit) {
+                if (!st.asserting) {
+                    // 距上次满足不足延迟上界的再次满足属于同一次抖动，沿用首次满足的时间
+                    st.asserting = true;
+                    if (now - st.last_assert >= max_delay) st.assert_since = now;
+                }
+                st.last_assert = now;
+                const auto asserted = now - st.assert_since;
+                const bool samples_ok = (st.history & window) == window;
+                const bool time_ok = asserted >= std::chrono::milliseconds(cfg.trigger_min_ms);
+                if (samples_ok && time_ok) {
+                    st.asserting = false; // 接受触发
+                    st.forced = false;
+                } else if (asserted >= max_delay) {
+                    st.asserting = false; // 到达延迟上界，强制接受触发
+                    st.forced = true;
                 } else {
-                    // 此特定 IO 的触发条件不再满足.
-                    // 如果此 IO 先前已触发 (标志已设置)，检查复位条件.
-                    if (io.already_triggered) {
-                        bool meets_reset_condition = false;
-                        if (io.reset_io_index > 0) {
-                            // 已配置复位 IO，检查其状态 (索引已经验证过在0-2048范围内)
-                            bool reset_io_value = read_io(io.reset_io_index); // 假定 read_io 安全
-                            meets_reset_condition = reset_io_value == true; // 假定复位 IO 触发高电平 (True)
-                             if(file_logger) {
-                                 std::string debug_msg = "检查已触发 IO " + std::to_string(io.io_index) + " 的复位 IO " + std::to_string(io.reset_io_index) +
-                                                         ". 复位 IO 值: " + (reset_io_value ? "1" : "0") + ". 满足复位条件: " + (meets_reset_condition ? "true" : "false");
-                                 SPDLOG_DEBUG(debug_msg);
-                             }
-                        } else {
-                            // 没有专用复位 IO，只需清除触发条件就足以允许复位
-                            meets_reset_condition = true;
-                             if(file_logger) {
-                                 std::string debug_msg = "已触发 IO " + std::to_string(io.io_index) + " 没有专用复位 IO. 满足复位条件: " + (meets_reset_condition ? "true" : "false");
-                                 SPDLOG_DEBUG(debug_msg);
-                             }
-                        }
-
-                        if (meets_reset_condition) {
-                            io.already_triggered = false; // 清除标志
-                            io.trigger_time = 0; // 重置触发时间
-                            if(file_logger) {
-                                std::string log_msg = "安全 IO 已复位: 索引 " + std::to_string(io.io_index) +
-                                                      " (描述: " + io.description + "). 复位条件满足 (复位 IO: " + std::to_string(io.reset_io_index) + ").";
-                                SPDLOG_INFO(log_msg);
-                            }
-                            // 系统恢复在 *所有* 标志清除时发生
-                        }
-                        // 如果触发条件为 false 但复位条件也为 false，
-                        // already_triggered 标志保持为 true，等待复位条件.
-                    }
+                    accepted &= ~bit;
+                    pending = true;
+                }
+            } else if (st.asserting) {
+                if ((st.history & window) != 0 ||
+                    now - st.last_assert < std::chrono::milliseconds(cfg.trigger_min_ms)) {
+                    pending = true; // 短暂脱落，继续滤波
+                } else {
+                    // 触发条件在被接受前消失: 毛刺
+                    st.asserting = false;
+                    pending = true; // 延迟上界内再次满足时仍属同一次抖动，保持快速采样
+                    safety_metrics.filtered_trips.fetch_add(1, std::memory_order_relaxed);
+                    safety_metrics.io_glitches[io_table.trigger_io[slot]].fetch_add(1, std::memory_order_relaxed);
                 }
+            } else if (now - st.last_assert < max_delay) {
+                pending = true;
+            }
+            continue;
+        }
 
-                // 评估触发和复位条件后，检查标志是否已设置
-                if (io.already_triggered) {
-                     any_io_has_already_triggered_flag = true;
+        st.asserting = false;
+        if (resets & bit) {
+            const auto holdoff = st.forced ? std::max(std::chrono::milliseconds(cfg.reset_holdoff_ms), max_delay)
+                                           : std::chrono::milliseconds(cfg.reset_holdoff_ms);
+            if (holdoff.count() > 0) {
+                if (!st.resetting) {
+                    st.resetting = true;
+                    st.reset_since = now;
+                }
+                if (now - st.reset_since < holdoff) {
+                    resets &= ~bit; // 保持期内，继续保持已触发
+                    pending = true;
+                } else {
+                    st.resetting = false;
+                    st.forced = false;
                 }
+            } else {
+                st.forced = false;
             }
+        } else if (st.resetting) {
+            // 复位条件在保持期内消失
+            st.resetting = false;
+            safety_metrics.filtered_resets.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
 
-            // 步骤 2: 根据内部 `already_triggered` 标志确定所需的系统状态
-            // 如果 *任何一个* 已配置的 IO 的 `already_triggered` 标志已设置，则系统应为 LIMITED.
-            required_state = any_io_has_already_triggered_flag ? SYSTEM_STATE_LIMITED : SYSTEM_STATE_NORMAL;
+// 在 io_table 之外修改了 already_triggered 后 (例如 resetSpeed)，重新同步 triggered_mask
+static void sync_triggered_mask() {
+    std::fill(io_table.triggered_mask.begin(), io_table.triggered_mask.end(), 0);
+    for (size_t i = 0; i < io_table.entries.size(); ++i) {
+        if (io_table.entries[i].already_triggered) {
+            io_table.triggered_mask[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+}
 
-            // 步骤 3: 如果需要，执行状态转换动作
-            SystemState previous_state = current_system_state.load(std::memory_order_acquire); // 原子读取
+// 位运算评估内核. 先从快照按槽位收集触发 IO 与复位 IO 的值，再按 64 位字计算:
+//   满足触发 = ~(值 ^ 极性) & 有效
+//   新触发   = 满足触发 & ~已触发
+//   复位     = 已触发 & ~满足触发 & (~有专用复位IO | 复位IO值)   (无专用复位 IO 时触发条件解除即可复位)
+//   已触发'  = (已触发 | 满足触发) & ~复位
+// 字循环无分支，编译器可自动向量化; 配置了去抖的槽位 (通常没有) 再经 apply_debounce_word 滤波.
+// 更新 io_table.triggered_mask，words 中返回新触发/复位的槽位，返回值为更新后仍处于已触发的槽位数.
+// 不修改 entries，调用者根据 newly_triggered / newly_reset 同步 already_triggered.
+// now 为快照读取完成的时刻，用于去抖计时. 假定调用者已持有 io_mutex.
+static int evaluate_io_triggers(const IOSnapshot& snapshot, IOEvalWords& words, std::chrono::steady_clock::time_point now) {
+    const size_t count = io_table.entries.size();
+    const size_t word_count = io_table.valid_mask.size();
+    if (io_table.debounce_version != io_debounce_version) {
+        rebuild_io_debounce(io_table);
+    }
+    words.debounce_pending = false;
 
-            // 如果检测到状态变化
-            if (previous_state != required_state) {
-                if(file_logger) {
-                    std::string log_msg = "检测到系统状态变化: ";
-                    log_msg += (previous_state == SYSTEM_STATE_NORMAL ? "正常" : "安全受限");
-                    log_msg += " -> ";
-                    log_msg += (required_state == SYSTEM_STATE_NORMAL ? "正常" : "安全受限");
-                    SPDLOG_INFO(log_msg);
+    words.value.assign(word_count, 0);
+    words.reset_value.assign(word_count, 0);
+    words.newly_triggered.resize(word_count);
+    words.newly_reset.resize(word_count);
+
+    // 收集: 每槽位两次位读取，无条件分支
+    for (size_t i = 0; i < count; ++i) {
+        words.value[i / 64] |= uint64_t(snapshot.values[io_table.trigger_io[i]]) << (i % 64);
+        words.reset_value[i / 64] |= uint64_t(snapshot.values[io_table.reset_io[i]]) << (i % 64);
+    }
+
+    int triggered_count = 0;
+    for (size_t k = 0; k < word_count; ++k) {
+        const uint64_t valid = io_table.valid_mask[k];
+        const uint64_t triggered = io_table.triggered_mask[k];
+        const uint64_t meets = ~(words.value[k] ^ io_table.polarity_mask[k]) & valid;
+        const uint64_t reset_ok = ~io_table.reset_io_mask[k] | words.reset_value[k];
+        uint64_t resets = triggered & ~meets & reset_ok;
+        uint64_t accepted = meets;
+        if (io_table.debounce_mask[k] != 0) {
+            apply_debounce_word(k, meets, triggered, accepted, resets, now, words.debounce_pending);
+        }
+
+        words.newly_triggered[k] = accepted & ~triggered;
+        words.newly_reset[k] = resets;
+        io_table.triggered_mask[k] = (triggered | accepted) & ~resets;
+        triggered_count += __builtin_popcountll(io_table.triggered_mask[k]);
+    }
+    return triggered_count;
+}
+
+// 发布当前安全状态快照. 假定调用者已持有 io_mutex. 仅在状态/触发集合/配置变化后调用.
+static void publish_status_snapshot() {
+    std::shared_ptr<SafetyStatusSnapshot> snap = std::make_shared<SafetyStatusSnapshot>();
+    snap->system_state = current_system_state.load(std::memory_order_acquire);
+    snap->limited_speed = configured_limited_speed;
+    const size_t count = io_table.entries.size();
+    snap->io_states.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const auto& io = io_table.entries[i];
+        snap->io_states[i] = IOStatusEntry{io.io_index, io.reset_io_index, io.trigger_value, io.already_triggered,
+                                           io.trigger_time, io_table.description_id[i]};
+    }
+    snap->descriptions = io_table.descriptions;
+    snap->monitor = monitor_settings;
+    snap->io_event_mode = io_event_mode;
+    snap->robot_mask = handled_robot_mask.load();
+    snap->zones = safety_zones;
+    snap->limited_robots = limited_robot_mask.load();
+    snap->speed_limited_robots = speed_limited_robot_mask.load();
+    snap->debounce = debounce_list;
+    snap->debounce_max_delay_ms = debounce_max_delay_ms;
+    snap->version = ++status_snapshot_version;
+    std::atomic_store(&status_snapshot, std::shared_ptr<const SafetyStatusSnapshot>(std::move(snap)));
+    if (status_push_subscribed.load(std::memory_order_relaxed)) {
+        notify_status_push(status_snapshot_version);
+    }
+}
+
+// 读取最新发布的安全状态快照，不获取 io_mutex. 服务启动前未发布时返回 nullptr.
+static std::shared_ptr<const SafetyStatusSnapshot> load_status_snapshot() {
+    return std::atomic_load(&status_snapshot);
+}
+
+// 快照条目的描述 (驻留在快照共享的描述表中)
+static const std::string& status_description(const SafetyStatusSnapshot& snap, const IOStatusEntry& io) {
+    return (*snap.descriptions)[io.description_id];
+}
+
+// 当前控制器后端 (NRC 接口或替换的后端)
+static const RasterSafetyBackend& controller() {
+    return *controller_backend.load(std::memory_order_acquire);
+}
+
+// 批量读取 indices 中的布尔变量到快照. 假定 indices 已验证在 0-2048 范围内，
+// 且后端的 read_io (NRC_ReadTcpBoolVar) 读取操作是线程安全的.
+// NRC 接口未提供批量读取，这里在评估之前集中连续读取一次，不与判断/日志交错，
+// 并且每个 IO 每周期只读取一次 (复位 IO 与触发 IO 重叠时也只读一次).
+static void read_io_snapshot(const std::vector<int>& indices, IOSnapshot& snapshot) {
+    const RasterSafetyBackend& backend = controller(); // 每周期取一次，整个快照来自同一后端
+    for (int index : indices) {
+        snapshot.values[index] = backend.read_io(index);
+    }
+}
+
+// 动作: 暂停机器人. 在动作执行线程中调用.
+// 触发后的第一件事即连续向命令中的全部受控机器人下发暂停 (每台一次控制器调用，不预先查询状态)，再共享一次确认等待.
+// 总停止延迟不随机器人数量增加. 暂停前的状态取自运行状态刷新线程的观察值，只用于在命令发出后区分
+// "由本模块暂停" 与 "原本已停止/暂停": 只有观察为运行且确认进入暂停的机器人才记录作业名、之后由本模块恢复.
+// 作业名取自后台预取值，暂停确认后再向控制器复核.
+static void pause_robots(const ActionCommand& cmd) {
+    // 命令中的机器人 (按机器人上限定长，不分配)
+    int pending_ids[MAX_ROBOT_ID + 1];
+    int pending_ret[MAX_ROBOT_ID + 1];
+    int pending_count = 0;
+    const uint32_t robot_mask = cmd.robot_mask & handled_robot_mask.load();
+
+    // 阶段 1: 并发下发暂停命令，之前不做任何查询或等待 (已停止/暂停的机器人收到暂停命令不改变状态)
+    for (uint32_t bits = robot_mask; bits != 0; bits &= bits - 1) {
+        pending_ids[pending_count++] = __builtin_ctz(bits);
+    }
+    if (pending_count == 0) {
+        return; // 没有需要暂停的机器人
+    }
+    struct PauseBatch {
+        const ActionCommand* cmd;
+        const int* ids;
+        int* ret;
+    } batch = {&cmd, pending_ids, pending_ret};
+    run_controller_fanout([](void* context, int index) {
+        PauseBatch& b = *static_cast<PauseBatch*>(context);
+        b.ret[index] = controller().pause_job(b.ids[index]); // 不依赖其返回值判断成功
+        record_latency(safety_metrics.trip_to_pause_call, std::chrono::steady_clock::now() - b.cmd->observed_at);
+    }, &batch, pending_count);
+
+    // 阶段 2: 命令发出后确定暂停前的状态并记录调用结果. 取刷新线程观察值与本线程上次查询 (如刚完成的恢复确认)
+    // 中较新的一个 (观察值 0 亦表示尚未观察)
+    SPDLOG_INFO("[动作] 因安全触发暂停机器人 (机器人 {:#x}). 系统状态: 安全受限.", cmd.robot_mask);
+    for (int i = 0; i < pending_count; ++i) {
+        int id = pending_ids[i];
+        auto& state = getRobotState(id); // 只在动作执行线程中访问，状态表不加锁
+        const int64_t observed_ns = observed_run_status_ns[id].load(std::memory_order_acquire);
+        if (observed_ns >= state.status_checked_ns) {
+            state.current_run_status = observed_run_status[id].load(std::memory_order_relaxed);
+        }
+        if (state.current_run_status == 2) {
+            // 先记录预取的作业名 (复用缓冲区容量，可能为空)，暂停确认后复核
+            state.last_job_name.assign(state.cached_job_name);
+        }
+        if(file_logger) SPDLOG_INFO("调用 NRC_Rbt_PauseRunJobfile({}) 返回: {} (暂停前观察状态: {})",
+                                    id, pending_ret[i], state.current_run_status);
+    }
+
+    // 阶段 3: 所有机器人共享一次确认，全部不再运行 (暂停或停止) 即提前结束
+    int confirmed_status[MAX_ROBOT_ID + 1];
+    int confirm_ms = confirm_run_status(pending_ids, pending_count, RUN_STATUS_NOT_RUNNING, confirmed_status);
+    record_latency(safety_metrics.trip_to_paused, std::chrono::steady_clock::now() - cmd.observed_at);
+    const int64_t confirmed_ns = steady_now_ns();
+
+    // 阶段 4: 逐个处理确认结果
+    for (int i = 0; i < pending_count; ++i) {
+        int id = pending_ids[i];
+        auto& state = getRobotState(id);
+
+        int new_status = confirmed_status[i];
+        const bool paused_by_us = state.current_run_status == 2 && new_status == 1;
+        if (new_status != 2 && !paused_by_us) { // 原本已停止 (0) 或暂停 (1)
+             if (!state.message_sent_limited) {
+                const char* msg_status = (new_status == 1) ? "暂停" : "停止";
+                const std::string& msg = format_report("安全触发，机械臂%d已处于%s状态，无需暂停", id, msg_status);
+                controller().error_report(0, msg); // 信息级别通知
+                if(file_logger) SPDLOG_INFO("{}", msg);
+                state.message_sent_limited = true;
+                state.message_sent_recovered = false; // 重置恢复标志
+             } else {
+                 if(file_logger) SPDLOG_DEBUG("机械臂 {} 已停止/暂停，并在当前安全受限阶段发送过暂停消息.", id);
+             }
+             // 不是我们暂停的，清空作业名 (限速失败后由本模块暂停的除外)
+             if (!state.paused_for_speed) {
+                 state.last_job_name.clear();
+             }
+             state.current_run_status = new_status;
+             state.status_checked_ns = confirmed_ns;
+             continue;
+        }
+
+        if(file_logger) SPDLOG_INFO("确认耗时 {}ms (超时 {}ms)，机械臂 {} 新状态为: {}", confirm_ms, state_confirm_timeout_ms.load(), id, new_status);
+        EventRecord ev = make_event(EVENT_ROBOT_PAUSE);
+        ev.io_index = cmd.cause_io;
+        ev.robot_id = static_cast<int16_t>(id);
+        ev.call_ret = pending_ret[i];
+        ev.status_after = new_status;
+        ev.confirm_ms = confirm_ms;
+        append_event(ev);
+
+        if (paused_by_us) { // 暂停成功 (由运行进入暂停状态)
+            // 复核作业名: 暂停后打开的作业即为将要恢复的作业，预取值缺失或已过期时以此为准.
+            // 复核失败时保留预取值 (可能为空)
+            state.job_check.clear();
+            int get_job_ret = controller().get_open_job(id, state.job_check);
+            if (get_job_ret != 0) {
+                if(file_logger) SPDLOG_WARN("获取机械臂 {} 作业名失败. NRC_GetCurrentOpenJob 返回 {}，使用预取的作业名 '{}'",
+                                            id, get_job_ret, state.last_job_name);
+            } else {
+                if (state.job_check != state.last_job_name) {
+                    if(file_logger) SPDLOG_INFO("机械臂 {} 预取的作业名 '{}' 与暂停后复核的不一致，已更正.", id, state.last_job_name);
+                    state.last_job_name.assign(state.job_check);
                 }
+                if(file_logger) SPDLOG_INFO("机械臂 {} 当前作业名为: {}", id, state.last_job_name);
+            }
+            if (!state.message_sent_limited) {
+                const std::string& msg = format_report("安全触发，机械臂%d因安全IO动作被暂停", id);
+                controller().error_report(1, msg); // 安全触发的报警级别 1
+                if(file_logger) SPDLOG_INFO("{}", msg);
+                state.message_sent_limited = true;
+                state.message_sent_recovered = false; // 重置恢复标志
+            } else {
+                if(file_logger) SPDLOG_DEBUG("机械臂 {} 在当前安全受限阶段已发送过暂停消息.", id);
+            }
+        } else { // 暂停失败 (超时后仍在运行)
+             const std::string& msg = format_report("安全触发，尝试暂停机械臂%d失败！未能达到暂停状态。暂停前状态:%d, 调用返回:%d, 暂停后状态:%d",
+                                                    id, state.current_run_status, pending_ret[i], new_status);
+             // 无论 message_sent_limited 标志如何，都会发送此错误报告，因为这是动作失败
+             controller().error_report(3, msg); // 失败的更高级别
+             if(file_logger) SPDLOG_ERROR("{}", msg);
+             // 如果暂停失败，清除记录的 job name，避免下次尝试恢复一个未能被我们成功暂停的作业
+             state.last_job_name.clear();
+        }
+        state.current_run_status = new_status;
+        state.status_checked_ns = confirmed_ns;
+    }
+}
 
-                // 先更新全局状态，以便其他地方读取到最新状态
-                current_system_state.store(required_state, std::memory_order_release);
+// 动作: 恢复机器人. 在动作执行线程中调用.
+// 与暂停相同地分阶段扇出: 先采集状态，再连续向所有由本模块暂停的机器人下发恢复命令，最后共享一次确认等待.
+static void resume_robots(const ActionCommand& cmd) {
+    SPDLOG_INFO("[动作] 安全触发解除后启动机器人恢复操作 (机器人 {:#x}).", cmd.robot_mask);
+
+    // 已下发恢复命令、等待确认的机器人 (按机器人上限定长，不分配)
+    int pending_ids[MAX_ROBOT_ID + 1];
+    int pending_ret[MAX_ROBOT_ID + 1];
+    int pending_count = 0;
+    const uint32_t robot_mask = cmd.robot_mask & handled_robot_mask.load();
+
+    // 阶段 1: 并发刷新状态，收集有记录作业名的暂停机器人，并处理无需恢复的机器人
+    int query_ids[MAX_ROBOT_ID + 1];
+    int query_status[MAX_ROBOT_ID + 1];
+    int query_count = 0;
+    for (uint32_t bits = robot_mask; bits != 0; bits &= bits - 1) {
+        int id = __builtin_ctz(bits);
+        if (getRobotState(id).paused_for_speed) {
+            // 限速失败后改为暂停的机器人由限速解除时恢复，避免在仍需限速时以原速运行
+            if(file_logger) SPDLOG_DEBUG("机械臂 {} 因限速失败而暂停，等待限速解除后恢复.", id);
+            continue;
+        }
+        query_ids[query_count++] = id;
+    }
+    struct StatusBatch {
+        const int* ids;
+        int* status;
+    } query = {query_ids, query_status};
+    const int64_t checked_ns = steady_now_ns();
+    run_controller_fanout([](void* context, int index) {
+        StatusBatch& q = *static_cast<StatusBatch*>(context);
+        q.status[index] = controller().get_run_status(q.ids[index]);
+    }, &query, query_count);
+
+    for (int k = 0; k < query_count; ++k) {
+        int id = query_ids[k];
+        auto& state = getRobotState(id); // 只在动作执行线程中访问，状态表不加锁
+
+        // 执行动作前刷新的状态
+        state.status_checked_ns = checked_ns;
+        state.current_run_status = query_status[k];
 
-                // 根据需要转换到的新状态执行对应动作
-                if (required_state == SYSTEM_STATE_LIMITED) {
-                    // 转换为 LIMITED 的动作和通知
-                    // 发送系统级别的安全触发通知 (首次进入此状态周期时)
-                    if (!limited_state_message_sent_this_cycle.load()) {
-                        std::string msg = "光栅安全：检测到安全区域侵犯，系统进入安全受限状态！";
-                        NRC_TriggerErrorReport(1, msg); // 使用警告级别 1
-                        if(file_logger) SPDLOG_WARN(msg);
-                        limited_state_message_sent_this_cycle.store(true); // 标记已发送
-                        normal_state_message_sent_this_cycle.store(false); // 重置另一状态的标志
-
-                        // 重置所有机器人的恢复消息标志
-                        for(int id : handled_robot_ids) {
-                           getRobotState(id).message_sent_recovered = false;
-                        }
-                    }
-                    // 执行暂停动作
-                    pause_robots(); // 动作: 暂停机器人 (在锁定区域内)
-
-                } else { // required_state == SYSTEM_STATE_NORMAL
-                    // 转换为 NORMAL 的动作和通知
-                    // 发送系统级别的安全解除通知 (首次进入此状态周期时)
-                    if (!normal_state_message_sent_this_cycle.load()) {
-                         std::string msg = "光栅安全：安全条件解除，系统恢复正常状态。";
-                         NRC_TriggerErrorReport(0, msg); // 使用信息级别 0
-                         if(file_logger) SPDLOG_INFO(msg);
-                         normal_state_message_sent_this_cycle.store(true); // 标记已发送
-                         limited_state_message_sent_this_cycle.store(false); // 重置另一状态的标志
-
-                         // 重置所有机器人的暂停消息标志
-                         for(int id : handled_robot_ids) {
-                            getRobotState(id).message_sent_limited = false;
-                         }
-                    }
-                    // 执行恢复动作
-                    resume_robots(); // 动作: 恢复机器人 (在锁定区域内)
+        if (state.current_run_status == 1) { // 只在暂停时尝试恢复
+            if (!state.last_job_name.empty()) {
+                // 尝试恢复我们记录时暂停的作业
+                if(file_logger) SPDLOG_INFO("尝试恢复机械臂 {} 作业: {}", id, state.last_job_name);
+                pending_ids[pending_count++] = id;
+            } else {
+                // 暂停，但没有我们记录的作业名. 不是我们暂停的.
+                if (!state.message_sent_recovered) {
+                     const std::string& msg = format_report("安全触发解除，机械臂%d处于暂停状态但无记录的作业，需手动恢复", id);
+                     controller().error_report(0, msg); // 信息级别通知
+                     if(file_logger) SPDLOG_WARN("{}", msg);
+                     state.message_sent_recovered = true; // 防止重复消息
+                     state.message_sent_limited = false;
+                } else {
+                    if(file_logger) SPDLOG_DEBUG("机械臂 {} 无记录作业而暂停，并在当前正常阶段发送过恢复消息.", id);
                 }
+            }
+        } else { // 机器人已停止 (0) 或运行 (2)
+             if (!state.message_sent_recovered) {
+                 const char* msg_status = (state.current_run_status == 2) ? "运行" : "停止";
+                 const std::string& msg = format_report("安全触发解除，机械臂%d已处于%s状态，无需恢复", id, msg_status);
+                 controller().error_report(0, msg); // 信息级别通知
+                 if(file_logger) SPDLOG_INFO("{}", msg);
+                 state.message_sent_recovered = true;
+                 state.message_sent_limited = false;
+             } else {
+                 if(file_logger) SPDLOG_DEBUG("机械臂 {} 已停止/运行，并在当前正常阶段发送过恢复消息.", id);
+             }
+             // 如果机器人通过其他方式恢复/停止，则清除作业名
+             state.last_job_name.clear();
+        }
+    }
+
+    if (pending_count == 0) {
+        return; // 没有需要恢复的机器人
+    }
+
+    // 阶段 2: 并发向所有待恢复的机器人下发恢复命令，中间不做任何等待
+    struct ResumeBatch {
+        const ActionCommand* cmd;
+        const int* ids;
+        int* ret;
+    } batch = {&cmd, pending_ids, pending_ret};
+    run_controller_fanout([](void* context, int index) {
+        ResumeBatch& b = *static_cast<ResumeBatch*>(context);
+        // 调用恢复接口 (不依赖其返回值判断成功). 作业名在扇出期间不被修改
+        b.ret[index] = controller().start_job(getRobotState(b.ids[index]).last_job_name.c_str()); // start_job 接受 const char*
+        record_latency(safety_metrics.reset_to_resume_call, std::chrono::steady_clock::now() - b.cmd->observed_at);
+    }, &batch, pending_count);
+    for (int i = 0; i < pending_count; ++i) {
+        if(file_logger) SPDLOG_INFO("调用 NRC_StartRunJobfile({}) 返回: {}", getRobotState(pending_ids[i]).last_job_name, pending_ret[i]);
+    }
+
+    // 阶段 3: 所有机器人共享一次确认，全部进入运行状态即提前结束
+    int confirmed_status[MAX_ROBOT_ID + 1];
+    int confirm_ms = confirm_run_status(pending_ids, pending_count, 2, confirmed_status);
+    record_latency(safety_metrics.reset_to_resumed, std::chrono::steady_clock::now() - cmd.observed_at);
+    const int64_t confirmed_ns = steady_now_ns();
+
+    // 阶段 4: 逐个处理确认结果
+    for (int i = 0; i < pending_count; ++i) {
+        int id = pending_ids[i];
+        auto& state = getRobotState(id);
+
+        int new_status = confirmed_status[i];
+        if(file_logger) SPDLOG_INFO("确认耗时 {}ms (超时 {}ms)，机械臂 {} 新状态为: {}", confirm_ms, state_confirm_timeout_ms.load(), id, new_status);
+        EventRecord ev = make_event(EVENT_ROBOT_RESUME);
+        ev.io_index = cmd.cause_io;
+        ev.robot_id = static_cast<int16_t>(id);
+        ev.call_ret = pending_ret[i];
+        ev.status_after = new_status;
+        ev.confirm_ms = confirm_ms;
+        append_event(ev);
+
+        if (new_status == 2) { // 恢复成功 (达到了运行状态)
+            if (!state.message_sent_recovered) {
+                const std::string& msg = format_report("安全触发解除，机械臂%d作业已恢复", id);
+                controller().error_report(0, msg); // 恢复的信息级别
+                if(file_logger) SPDLOG_INFO("{}", msg);
+                state.message_sent_recovered = true;
+                state.message_sent_limited = false; // 重置暂停标志
             } else {
-                 // 如果状态没有变化，检查是否需要发送持续状态消息 (例如，持续受限报警)
-                 // 目前策略是在状态转换时发送一次，这里可以省略或添加周期性消息
-                 // 例如：如果状态一直是 LIMITED 且未发送过持续报警，则发送
-                 // if (required_state == SYSTEM_STATE_LIMITED && !...持续报警标志...) { ... }
-                 // if(file_logger) SPDLOG_DEBUG("系统状态保持: {}", current_system_state.load() == SYSTEM_STATE_NORMAL ? "正常" : "安全受限");
+                 if(file_logger) SPDLOG_DEBUG("机械臂 {} 在当前正常阶段已发送过恢复消息.", id);
             }
+            state.last_job_name.clear(); // 尝试成功恢复后清除作业名
+        } else {
+            // 恢复失败 (未能达到运行状态)
+            const std::string& msg = format_report("安全触发解除，尝试恢复机械臂%d作业失败！未能达到运行状态。暂停前状态:%d, 调用返回:%d, 恢复后状态:%d",
+                                                   id, state.current_run_status, pending_ret[i], new_status);
+            // 无论 message_sent_recovered 标志如何，都会发送此错误报告，因为这是动作失败
+            controller().error_report(3, msg); // 失败的更高级别
+            if(file_logger) SPDLOG_ERROR("{}", msg);
+            // 如果恢复失败，状态仍为暂停 (状态 1)，作业名不清除，以便下次可能再次尝试恢复.
+        }
+        state.current_run_status = new_status;
+        state.status_checked_ns = confirmed_ns;
+    }
+}
+
+// 动作: 机器人限速. 在动作执行线程中调用.
+// 依次调用速度倍率接口，不停止机器人也不重启作业; 倍率无法回读，以接口返回值作为确认结果.
+// 接口未注册或调用失败的机器人改为暂停，保证受限区域内的机器人不会保持原速运行.
+static void limit_robot_speeds(const ActionCommand& cmd) {
+    SPDLOG_INFO("[动作] 因安全触发启动机器人限速操作 (机器人 {:#x}, 限速 {}%).", cmd.robot_mask, cmd.speed_percent);
+    SpeedOverrideHandler handler = speed_override_handler.load();
+    uint32_t fallback = 0;
+
+    for (uint32_t bits = cmd.robot_mask & handled_robot_mask.load(); bits != 0; bits &= bits - 1) {
+        int id = __builtin_ctz(bits);
+
+        int ret = handler ? handler(id, cmd.speed_percent) : -1;
+        record_latency(safety_metrics.trip_to_speed_limited, std::chrono::steady_clock::now() - cmd.observed_at);
+        if(file_logger) SPDLOG_INFO("设置机械臂 {} 速度倍率 {}% 返回: {}", id, cmd.speed_percent, ret);
+        EventRecord ev = make_event(EVENT_ROBOT_SPEED);
+        ev.io_index = cmd.cause_io;
+        ev.robot_id = static_cast<int16_t>(id);
+        ev.call_ret = ret;
+        ev.status_after = cmd.speed_percent;
+        append_event(ev);
+
+        // 限速/恢复倍率每次转换都通知，不占用暂停/恢复的消息标志
+        if (ret == 0) {
+            const std::string& msg = format_report("安全触发，机械臂%d已限速至%d%%", id, cmd.speed_percent);
+            controller().error_report(1, msg); // 安全触发的报警级别 1
+            if(file_logger) SPDLOG_INFO("{}", msg);
+        } else {
+            const std::string& msg = format_report("安全触发，机械臂%d限速失败 (返回:%d)，改为暂停", id, ret);
+            controller().error_report(3, msg); // 失败的更高级别
+            if(file_logger) SPDLOG_ERROR("{}", msg);
+            fallback |= 1u << id;
+        }
+    }
+
+    if (fallback != 0) {
+        ActionCommand pause = cmd;
+        pause.type = ACTION_PAUSE;
+        pause.robot_mask = fallback;
+        pause_robots(pause);
+        for (uint32_t bits = fallback; bits != 0; bits &= bits - 1) {
+            auto& state = getRobotState(__builtin_ctz(bits));
+            state.paused_for_speed = !state.last_job_name.empty(); // 仅记录确实由本模块暂停的机器人
+        }
+    }
+}
 
-            // Step 4: Periodically update robot state in map
-            for(int id : handled_robot_ids) {
-                getRobotState(id).current_run_status = NRC_Rbt_GetProgramRunStatus(id);
+// 动作: 恢复机器人速度倍率. 在动作执行线程中调用.
+// 限速失败后改为暂停的机器人在此恢复作业 (仍被暂停区域限制时留给该区域解除时恢复).
+static void restore_robot_speeds(const ActionCommand& cmd) {
+    SPDLOG_INFO("[动作] 限速解除后启动机器人速度恢复操作 (机器人 {:#x}).", cmd.robot_mask);
+    SpeedOverrideHandler handler = speed_override_handler.load();
+    const uint32_t paused_robots = limited_robot_mask.load();
+    uint32_t to_resume = 0;
+
+    for (uint32_t bits = cmd.robot_mask & handled_robot_mask.load(); bits != 0; bits &= bits - 1) {
+        int id = __builtin_ctz(bits);
+        auto& state = getRobotState(id);
+
+        if (state.paused_for_speed) {
+            state.paused_for_speed = false;
+            if ((paused_robots & (1u << id)) == 0) {
+                to_resume |= 1u << id;
             }
+            continue;
+        }
 
-        }  // --- 锁范围结束 ---
+        int ret = handler ? handler(id, -1) : -1;
+        if(file_logger) SPDLOG_INFO("恢复机械臂 {} 速度倍率返回: {}", id, ret);
+        EventRecord ev = make_event(EVENT_ROBOT_SPEED);
+        ev.io_index = cmd.cause_io;
+        ev.robot_id = static_cast<int16_t>(id);
+        ev.call_ret = ret;
+        ev.status_after = -1;
+        append_event(ev);
+
+        if (ret == 0) {
+            const std::string& msg = format_report("安全触发解除，机械臂%d速度倍率已恢复", id);
+            controller().error_report(0, msg); // 恢复的信息级别
+            if(file_logger) SPDLOG_INFO("{}", msg);
+        } else {
+            const std::string& msg = format_report("安全触发解除，恢复机械臂%d速度倍率失败 (返回:%d)，需手动恢复", id, ret);
+            controller().error_report(3, msg); // 失败的更高级别
+            if(file_logger) SPDLOG_ERROR("{}", msg);
+        }
+    }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(50)); // 监测频率
+    if (to_resume != 0) {
+        ActionCommand resume = cmd;
+        resume.type = ACTION_RESUME;
+        resume.robot_mask = to_resume;
+        resume_robots(resume);
     }
+}
 
-    std::cout << "[光栅安全控制] IO监测线程退出!" << std::endl;
-    if(file_logger) SPDLOG_INFO("[光栅安全控制] IO监测线程退出!");
+
+static bool createDirectory(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) == -1) {
+        if (mkdir(path.c_str(), 0755) == -1) {
+            if (errno != EEXIST) {
+                std::cerr << "[光栅安全控制] 创建目录失败: " + std::string(strerror(errno)) << std::endl;
+                if(file_logger) SPDLOG_ERROR("创建目录失败: {}, 错误: {}", path, strerror(errno));
+                return false;
+            }
+        } else {
+            if(file_logger) SPDLOG_INFO("目录已创建: {}", path);
+        }
+    } else {
+         if(file_logger) SPDLOG_INFO("目录已存在: {}", path);
+    }
+    return true;
 }
 
-// --- 对外接口实现 ---
+static bool fileExists(const std::string& path) {
+    struct stat buffer;
+    return (stat(path.c_str(), &buffer) == 0);
+}
 
-bool updateIOConfig(const std::vector<IOConfig>& config, int limited_speed) {
-    // 整个函数不再被一个大的 try-catch 包围
-    std::lock_guard<std::mutex> lock(io_mutex); // 保护 io_list_indexed 和 configured_limited_speed
+static bool setFilePermissions(const std::string& path) {
+    if (chmod(path.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) == -1) { // rw-r--r--
+        std::cerr << "[光栅安全控制] 设置文件权限失败: " + std::string(strerror(errno)) << std::endl;
+        if(file_logger) SPDLOG_ERROR("设置文件权限失败: {}, 错误: {}", path, strerror(errno));
+        return false;
+    }
+    if(file_logger) SPDLOG_INFO("文件权限设置成功: {}", path);
+    return true;
+}
 
-    if (limited_speed < 0 || limited_speed > 100) {
-        if(file_logger) SPDLOG_WARN("更新时提供的限速值 {} 无效，应在 0-100 范围内.", limited_speed);
+// 保存当前配置 (io_table 和 configured_limited_speed) 到文件
+// 原子地替换文件内容: 写入 path.tmp 并 fsync，设置权限后 rename 覆盖 path，再 fsync 所在目录.
+// 掉电或崩溃时 path 要么是旧内容要么是新内容.
+static bool write_file_atomically(const std::string& filename, const std::string& content) {
+    std::string temp_filename = filename + ".tmp";
+    int fd = open(temp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "[光栅安全控制] 无法打开临时配置文件进行写入: " + temp_filename << std::endl;
+        if(file_logger) SPDLOG_ERROR("无法打开临时配置文件进行写入: {}, 错误: {}", temp_filename, strerror(errno));
+        return false;
+    }
+    size_t written = 0;
+    while (written < content.size()) {
+        ssize_t n = write(fd, content.data() + written, content.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    bool write_ok = (written == content.size()) && fsync(fd) == 0;
+    int write_errno = errno;
+    if (close(fd) != 0) write_ok = false;
+    if (!write_ok) {
+        std::cerr << "[光栅安全控制] 写入临时配置文件失败: " + temp_filename << std::endl;
+        if(file_logger) SPDLOG_ERROR("写入临时配置文件失败: {}, 错误: {}", temp_filename, strerror(write_errno));
+        unlink(temp_filename.c_str());
+        return false;
+    }
+
+    if (!setFilePermissions(temp_filename)) {
+        // 错误已在 setFilePermissions 中记录. 权限设置失败仍视为保存不完全成功，正式文件保持不变
+        if(file_logger) SPDLOG_WARN("临时配置文件已写入，但权限设置失败: {}", temp_filename);
+        unlink(temp_filename.c_str());
+        return false;
+    }
+
+    if (rename(temp_filename.c_str(), filename.c_str()) != 0) {
+        std::cerr << "[光栅安全控制] 替换配置文件失败: " + filename << std::endl;
+        if(file_logger) SPDLOG_ERROR("替换配置文件失败: {} -> {}, 错误: {}", temp_filename, filename, strerror(errno));
+        unlink(temp_filename.c_str());
         return false;
     }
 
-    configured_limited_speed = limited_speed; // 存储配置的值
-    if(file_logger) SPDLOG_INFO("配置的限速已更新到内存: {}%", configured_limited_speed);
+    // 同步目录项，确保 rename 本身也已落盘
+    int dir_fd = open(CONFIG_DIR.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        if (fsync(dir_fd) != 0) {
+            if(file_logger) SPDLOG_WARN("同步配置目录失败: {}, 错误: {}", CONFIG_DIR, strerror(errno));
+        }
+        close(dir_fd);
+    }
+    return true;
+}
 
+// 同步保存配置到文件. 内容取自最新发布的安全状态快照，不读取 io_table，因此调用者无需持有 io_mutex;
+// 并发调用由 config_file_mutex 串行化，后写入者总是写入不旧于先写入者的快照. 不再有最外层 try-catch.
+// 通过 write_file_atomically 写入，掉电时文件要么是旧内容要么是新内容.
+// 每个单元 (安全区域) 的机器人、动作与 IO 配置写入各自的单元配置文件 (先于主文件)，主文件只列出单元名称与单元外的 IO.
+// 运行期间的修改通过 request_config_save() 交由后台写入线程调用本函数.
+static bool save_to_file() {
+    std::string filename = CONFIG_DIR + "/" + CONFIG_FILE_NAME;
+    Json::Value j(Json::objectValue);
 
-    // 清除索引列表中的现有配置
-    io_list_indexed.assign(2049, IOConfig()); // 重置所有为未配置 (-1 io_index, is_configured=false)
-    if(file_logger) SPDLOG_INFO("已清除内存中的现有 IO 配置.");
+    std::lock_guard<std::mutex> file_lock(config_file_mutex);
+    std::shared_ptr<const SafetyStatusSnapshot> snap = load_status_snapshot();
+    if (!snap) {
+        if(file_logger) SPDLOG_ERROR("保存配置失败: 尚未发布安全状态快照.");
+        return false;
+    }
 
+    // 确保目录存在
+    if (!createDirectory(CONFIG_DIR)) {
+        // 错误已在 createDirectory 中记录
+        return false;
+    }
+
+    if(file_logger) SPDLOG_INFO("准备保存配置到文件: {}", filename);
+
+    const std::vector<SafetyZone>& zones = *snap->zones;
+    std::vector<int8_t> owner(2049, -1);
+    for (size_t z = 0; z < zones.size(); ++z) {
+        for (int io_index : zones[z].io_indices) owner[io_index] = static_cast<int8_t>(z);
+    }
+    const Json::Int64 now = Json::Int64(std::time(nullptr));
+    std::vector<Json::Value> cells(zones.size());
+    for (size_t z = 0; z < zones.size(); ++z) {
+        Json::Value& cell = cells[z];
+        cell["cell"] = zones[z].name;
+        cell["last_update"] = now;
+        cell["action"] = zones[z].action == ZONE_ACTION_LIMIT_SPEED ? "limit_speed" : "pause";
+        cell["robot_ids"] = Json::Value(Json::arrayValue);
+        for (uint32_t bits = zones[z].robot_mask; bits != 0; bits &= bits - 1) {
+            cell["robot_ids"].append(__builtin_ctz(bits));
+        }
+        cell["io_indices"] = Json::Value(Json::arrayValue); // 含尚未配置的成员 IO
+        for (int io_index : zones[z].io_indices) {
+            cell["io_indices"].append(io_index);
+        }
+        cell["io_config"] = Json::Value(Json::arrayValue);
+    }
+
+    j["last_update"] = now;
+    j["io_config"] = Json::Value(Json::arrayValue);
+
+    // 遍历已配置的 IO: 单元内的写入单元文件，其余写入主文件
+    for (const auto& cfg : snap->io_states) {
+         const std::string& description = status_description(*snap, cfg);
+         Json::Value io_item;
+         io_item["io_index"] = cfg.io_index;
+         io_item["reset_io_index"] = cfg.reset_io_index;
+         io_item["trigger_value"] = cfg.trigger_value; // 保存存储的 int 值 (0 或 1)
+         io_item["description"] = description;
+         const int z = owner[cfg.io_index];
+         (z >= 0 ? cells[z] : j)["io_config"].append(io_item);
+         if(file_logger) SPDLOG_DEBUG("添加到保存JSON的IO: 索引{}, 复位{}, 触发值{}, 描述='{}'", cfg.io_index, cfg.reset_io_index, cfg.trigger_value, description);
+    }
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "    "; // 漂亮打印，缩进 4 个空格
+    if (!zones.empty() && !createDirectory(CELL_CONFIG_DIR)) {
+        return false;
+    }
+    for (size_t z = 0; z < zones.size(); ++z) {
+        const std::string cell_file = zones[z].instance ? zones[z].instance->config_file : cell_config_path(zones[z].name);
+        if (!write_file_atomically(cell_file, Json::writeString(builder, cells[z]))) {
+            return false; // 主文件保持旧内容，下次保存重试
+        }
+    }
+
+    j["limited_speed"] = snap->limited_speed; // 保存配置的值
+    j["io_event_mode"] = snap->io_event_mode;
+    j["robot_ids"] = Json::Value(Json::arrayValue);
+    for (uint32_t bits = snap->robot_mask; bits != 0; bits &= bits - 1) {
+        j["robot_ids"].append(__builtin_ctz(bits));
+    }
+    j["zones"] = Json::Value(Json::arrayValue);
+    for (const auto& zone : zones) {
+        Json::Value zone_item;
+        zone_item["name"] = zone.name; // 单元内容在单元配置文件中
+        j["zones"].append(zone_item);
+    }
+    Json::Value& debounce = j["debounce"];
+    debounce["max_delay_ms"] = snap->debounce_max_delay_ms;
+    debounce["io"] = Json::Value(Json::arrayValue);
+    for (const auto& entry : *snap->debounce) {
+        Json::Value item;
+        item["io_index"] = entry.first;
+        item["trigger_samples"] = entry.second.trigger_samples;
+        item["trigger_min_ms"] = entry.second.trigger_min_ms;
+        item["reset_holdoff_ms"] = entry.second.reset_holdoff_ms;
+        debounce["io"].append(item);
+    }
+    Json::Value& monitor = j["monitor"];
+    monitor["period_ms"] = snap->monitor.period_ms;
+    monitor["fast_period_ms"] = snap->monitor.fast_period_ms;
+    monitor["event_watchdog_ms"] = snap->monitor.event_watchdog_ms;
+    monitor["rt_priority"] = snap->monitor.rt_priority;
+    monitor["cpu_core"] = snap->monitor.cpu_core;
+    monitor["lock_memory"] = snap->monitor.lock_memory;
+    j["state_confirm_timeout_ms"] = state_confirm_timeout_ms.load();
+
+    const std::string content = Json::writeString(builder, j);
+
+    if (!write_file_atomically(filename, content)) {
+        return false; // 错误已在 write_file_atomically 中记录
+    }
+
+    if(file_logger) SPDLOG_INFO("配置文件保存成功: {}", filename);
+    return true;
+}
+
+// 请求后台保存配置 (JSON 与二进制快照)，立即返回本次请求的代数. 写入线程未运行时 (服务未启动) 同步保存.
+static uint64_t request_config_save() {
+    uint64_t gen = 0;
+    {
+        std::lock_guard<std::mutex> lock(config_save_mutex);
+        gen = ++config_save_state.requested_gen;
+        if (config_writer_running) {
+            config_save_cv.notify_all();
+            return gen;
+        }
+    }
+    bool ok = save_to_file();
+    if (ok) save_config_snapshot();
+    std::lock_guard<std::mutex> lock(config_save_mutex);
+    if (gen > config_save_state.completed_gen) {
+        config_save_state.completed_gen = gen;
+        config_save_state.last_ok = ok;
+        if (ok) {
+            config_save_state.last_saved_at = std::time(nullptr);
+            config_save_state.failure_count = 0;
+        } else {
+            config_save_state.failure_count++;
+        }
+    }
+    return gen;
+}
+
+// 请求后台仅更新二进制快照 (触发状态变化时由监测线程调用，只做计数与通知).
+// 写入线程未运行时只记录请求，待写入线程启动后写入.
+static void request_snapshot_save() {
+    std::lock_guard<std::mutex> lock(config_save_mutex);
+    ++config_save_state.snapshot_requested_gen;
+    if (config_writer_running) {
+        config_save_cv.notify_all();
+    }
+}
+
+// 后台配置写入线程: 等待保存请求，合并 CONFIG_SAVE_COALESCE_MS 内的后续请求后写入一次.
+// 仅快照的请求距上次写入不足 SNAPSHOT_SAVE_MIN_INTERVAL_MS 时推迟到期 (配置保存请求不受限制).
+// 停止时写完尚未完成的请求再退出.
+static void config_writer_thread_func() {
+    std::unique_lock<std::mutex> lock(config_save_mutex);
+    auto has_pending = [] {
+        return config_save_state.requested_gen > config_save_state.completed_gen ||
+               config_save_state.snapshot_requested_gen > config_save_state.snapshot_completed_gen;
+    };
+    // 锁剖析开启时兼做周期日志: 到期仍无请求则记录一次摘要. 剖析设置变化时重新计算等待.
+    unsigned profile_version = lock_profile_settings_version.load();
+    auto wake = [&has_pending, &profile_version] {
+        return !config_writer_running || has_pending() || lock_profile_settings_version.load() != profile_version;
+    };
+    bool profile_timer = false;
+    std::chrono::steady_clock::time_point next_profile_log;
+    auto last_snapshot_write = std::chrono::steady_clock::now() - std::chrono::milliseconds(SNAPSHOT_SAVE_MIN_INTERVAL_MS);
+    while (true) {
+        if (lock_profile_settings_version.load() != profile_version || (!profile_timer && lock_profiling_enabled.load())) {
+            profile_version = lock_profile_settings_version.load();
+            profile_timer = lock_profiling_enabled.load();
+            next_profile_log = std::chrono::steady_clock::now() + std::chrono::milliseconds(lock_profile_log_interval_ms.load());
+        }
+        if (profile_timer && std::chrono::steady_clock::now() >= next_profile_log) {
+            // 先于等待检查，保存请求持续到来时摘要也按时记录
+            lock.unlock();
+            log_lock_profile();
+            lock.lock();
+            next_profile_log = std::chrono::steady_clock::now() + std::chrono::milliseconds(lock_profile_log_interval_ms.load());
+            continue;
+        }
+        if (!profile_timer) {
+            config_save_cv.wait(lock, wake);
+        } else if (!config_save_cv.wait_until(lock, next_profile_log, wake)) {
+            continue; // 到期，下一轮记录摘要
+        }
+        if (!has_pending()) {
+            if (config_writer_running) continue; // 仅剖析设置变化
+            break; // 停止且没有待写入的请求
+        }
+        const bool json_pending = config_save_state.requested_gen > config_save_state.completed_gen;
+        const auto snapshot_due = last_snapshot_write + std::chrono::milliseconds(SNAPSHOT_SAVE_MIN_INTERVAL_MS);
+        if (!json_pending && config_writer_running && std::chrono::steady_clock::now() < snapshot_due) {
+            // 仅快照: 等待到期，期间的配置保存请求或停止请求提前结束等待 (剖析摘要仍按时记录)
+            config_save_cv.wait_until(lock, profile_timer ? std::min(snapshot_due, next_profile_log) : snapshot_due, [] {
+                return !config_writer_running || config_save_state.requested_gen > config_save_state.completed_gen;
+            });
+            continue;
+        }
+        if (config_writer_running) {
+            // 合并窗口: 期间的新请求并入本次写入 (停止请求会提前结束等待)
+            config_save_cv.wait_for(lock, std::chrono::milliseconds(CONFIG_SAVE_COALESCE_MS),
+                                    [] { return !config_writer_running; });
+        }
+        uint64_t gen = config_save_state.requested_gen;
+        uint64_t snapshot_gen = config_save_state.snapshot_requested_gen;
+        bool write_json = gen > config_save_state.completed_gen;
+        lock.unlock();
+        bool ok = write_json ? save_to_file() : true;
+        // JSON 写入失败时不更新二进制快照，避免快照领先于 JSON 来源
+        if (ok) save_config_snapshot();
+        lock.lock();
+        last_snapshot_write = std::chrono::steady_clock::now();
+        config_save_state.snapshot_completed_gen = snapshot_gen;
+        if (!write_json) {
+            continue;
+        }
+        config_save_state.completed_gen = gen;
+        config_save_state.last_ok = ok;
+        if (ok) {
+            config_save_state.last_saved_at = std::time(nullptr);
+            config_save_state.failure_count = 0;
+            if(file_logger) SPDLOG_DEBUG("[配置保存] 已写入保存代数 {}.", gen);
+        } else {
+            config_save_state.failure_count++;
+            if (config_save_state.failure_count == 1) {
+                controller().error_report(2, "光栅安全配置保存到文件失败，当前配置仅在内存中生效");
+            }
+            if(file_logger) SPDLOG_ERROR("[配置保存] 保存代数 {} 写入失败 (连续 {} 次). 配置在内存中已激活.", gen, config_save_state.failure_count);
+        }
+    }
+    if(file_logger) SPDLOG_INFO("[光栅安全控制] 配置写入线程退出!");
+}
+
+// 在 0x927b 上发送响应或推送. 所有消息经同一个 FastWriter 序列化，其输出缓冲在请求间保留容量;
+// socket 回调与推送线程可能并发调用，由 control_writer_mutex 串行化.
+static void send_control_message(const Json::Value& message) {
+    std::lock_guard<std::mutex> lock(control_writer_mutex);
+    NRC_SendSocketCustomProtocal(0x927b, control_writer.write(message));
+}
+
+// 写出 get_config 的完整响应 {"reqRasterSafetyControlCB": {...}}. 速度、IO 配置与触发标记
+// 全部来自同一个已发布快照 (不取 io_mutex). cell 非空时 IO、机器人、区域与去抖只包含该单元的部分，
+// 监测设置与保存状态为整个进程共享. 调用方持有 control_writer_mutex.
+static void write_config_response(const std::string& operation, const std::string& cell, JsonTextWriter& w) {
+    auto snap = load_status_snapshot();
+    const SafetyZone* cell_zone = nullptr;
+    if (!cell.empty() && snap) {
+        int z = find_zone(*snap->zones, cell);
+        if (z >= 0) cell_zone = &(*snap->zones)[z];
+    }
+    // 单元过滤: 未指定单元时全部通过
+    auto in_cell = [cell_zone](int io_index) {
+        return !cell_zone || std::binary_search(cell_zone->io_indices.begin(), cell_zone->io_indices.end(), io_index);
+    };
+    const uint32_t robot_filter = cell_zone ? cell_zone->robot_mask : ~0u;
+    w.reset();
+    w.begin_object();
+    w.begin_object("reqRasterSafetyControlCB");
+    w.field_str("operation", operation);
+    if (!cell.empty()) {
+        w.field_str("cell", cell);
+        if (!cell_zone) {
+            w.field_bool("status", false);
+            w.field_str("message", "单元 " + cell + " 不存在");
+            w.end_object();
+            w.end_object();
+            w.end_document();
+            return;
+        }
+        if (cell_zone->instance) w.field_str("config_file", cell_zone->instance->config_file);
+    }
+    w.field_bool("status", true);
+    w.field_int("limited_speed", snap ? snap->limited_speed : getCurrentLimitedSpeed());
+
+    if(file_logger) SPDLOG_DEBUG("准备构建 get_config 响应的 config_data 数组...");
+    w.begin_array("config_data");
+    static const std::vector<IOStatusEntry> no_io_states;
+    for (const auto& io : snap ? snap->io_states : no_io_states) {
+        if (!in_cell(io.io_index)) continue;
+        w.begin_object();
+        w.field_int("io_index", io.io_index);
+        w.field_int("trigger_value", io.trigger_value); // 存储的 int 值 (0 或 1)
+        w.field_int("reset_io_index", io.reset_io_index);
+        w.field_str("description", status_description(*snap, io));
+        w.field_bool("is_triggered", io.already_triggered);
+        w.end_object();
+    }
+    w.end_array();
+    if(file_logger) SPDLOG_DEBUG("config_data 数组构建完成. 添加了 {} 个已配置 IO.", snap ? snap->io_states.size() : 0);
+
+    if (snap) {
+        w.field_uint("version", snap->version); // 与状态推送的 version 对齐
+        w.begin_object("monitor");
+        w.field_int("period_ms", snap->monitor.period_ms);
+        w.field_int("fast_period_ms", snap->monitor.fast_period_ms);
+        w.field_int("event_watchdog_ms", snap->monitor.event_watchdog_ms);
+        w.field_int("rt_priority", snap->monitor.rt_priority);
+        w.field_int("cpu_core", snap->monitor.cpu_core);
+        w.field_bool("lock_memory", snap->monitor.lock_memory);
+        w.field_bool("io_event_mode", snap->io_event_mode);
+        w.end_object();
+
+        w.begin_array("robot_ids");
+        for (uint32_t bits = snap->robot_mask & robot_filter; bits != 0; bits &= bits - 1) w.value_int(__builtin_ctz(bits));
+        w.end_array();
+
+        w.begin_array("zones");
+        for (const auto& zone : *snap->zones) {
+            if (cell_zone && &zone != cell_zone) continue;
+            w.begin_object();
+            w.field_str("name", zone.name);
+            w.field_str("action", zone.action == ZONE_ACTION_LIMIT_SPEED ? "limit_speed" : "pause");
+            w.begin_array("io_indices");
+            for (int io_index : zone.io_indices) w.value_int(io_index);
+            w.end_array();
+            w.begin_array("robot_ids");
+            for (uint32_t bits = zone.robot_mask; bits != 0; bits &= bits - 1) w.value_int(__builtin_ctz(bits));
+            w.end_array();
+            // 区域内任一已配置 IO 处于已触发即为受限 (io_states 按 io_index 升序，二分查找)
+            bool limited = false;
+            for (int io_index : zone.io_indices) {
+                auto it = std::lower_bound(snap->io_states.begin(), snap->io_states.end(), io_index,
+                                           [](const IOStatusEntry& io, int index) { return io.io_index < index; });
+                if (it != snap->io_states.end() && it->io_index == io_index && it->already_triggered) {
+                    limited = true;
+                    break;
+                }
+            }
+            w.field_bool("is_limited", limited);
+            w.end_object();
+        }
+        w.end_array();
+
+        w.begin_array("limited_robot_ids");
+        for (uint32_t bits = snap->limited_robots & robot_filter; bits != 0; bits &= bits - 1) w.value_int(__builtin_ctz(bits));
+        w.end_array();
+        w.begin_array("speed_limited_robot_ids");
+        for (uint32_t bits = snap->speed_limited_robots & robot_filter; bits != 0; bits &= bits - 1) w.value_int(__builtin_ctz(bits));
+        w.end_array();
+        w.field_bool("speed_override_available", speed_override_handler.load() != nullptr);
+
+        w.begin_object("debounce");
+        w.field_int("max_delay_ms", snap->debounce_max_delay_ms);
+        w.begin_array("io");
+        for (const auto& entry : *snap->debounce) {
+            if (!in_cell(entry.first)) continue;
+            w.begin_object();
+            w.field_int("io_index", entry.first);
+            w.field_int("trigger_samples", entry.second.trigger_samples);
+            w.field_int("trigger_min_ms", entry.second.trigger_min_ms);
+            w.field_int("reset_holdoff_ms", entry.second.reset_holdoff_ms);
+            w.end_object();
+        }
+        w.end_array();
+        w.end_object();
+    }
+
+    // 后台配置写入线程的保存状态
+    {
+        std::lock_guard<std::mutex> lock(config_save_mutex);
+        w.begin_object("config_sync");
+        w.field_bool("pending", config_save_state.requested_gen > config_save_state.completed_gen);
+        w.field_uint("requested_gen", config_save_state.requested_gen);
+        w.field_uint("completed_gen", config_save_state.completed_gen);
+        w.field_bool("last_ok", config_save_state.last_ok);
+        w.field_int("last_saved_at", config_save_state.last_saved_at);
+        w.end_object();
+    }
+    w.end_object();
+    w.end_object();
+    w.end_document();
+}
+
+// 通知推送线程有新的状态快照发布. 由持有 io_mutex 的发布方调用，只短暂获取 status_push_mutex.
+static void notify_status_push(uint64_t version) {
+    {
+        std::lock_guard<std::mutex> lock(status_push_mutex);
+        if (!status_push.subscribed) {
+            return;
+        }
+        status_push.published_version = version;
+    }
+    status_push_cv.notify_one();
+}
+
+// 计算 snap 相对 base 的增量. 两个快照的 io_states 均按 io_index 升序，归并比较触发集合.
+// 触发集合、系统状态、受限机器人集合与配置都未变化时返回 false (无需推送).
+static bool build_status_delta(const SafetyStatusSnapshot& base, const SafetyStatusSnapshot& snap, Json::Value& delta) {
+    bool changed = false;
+    Json::Value triggered(Json::arrayValue);
+    Json::Value cleared(Json::arrayValue);
+    size_t i = 0, j = 0;
+    while (i < base.io_states.size() || j < snap.io_states.size()) {
+        const IOStatusEntry* before = i < base.io_states.size() ? &base.io_states[i] : nullptr;
+        const IOStatusEntry* after = j < snap.io_states.size() ? &snap.io_states[j] : nullptr;
+        if (after && (!before || after->io_index < before->io_index)) {
+            before = nullptr; // 新配置的 IO
+            ++j;
+        } else if (before && (!after || before->io_index < after->io_index)) {
+            after = nullptr;  // 已删除的 IO
+            ++i;
+        } else {
+            ++i;
+            ++j;
+        }
+        const bool was_triggered = before && before->already_triggered;
+        const bool is_triggered = after && after->already_triggered;
+        if (is_triggered && (!was_triggered || before->trigger_time != after->trigger_time)) {
+            Json::Value item;
+            item["io_index"] = after->io_index;
+            item["trigger_time"] = Json::Int64(after->trigger_time);
+            triggered.append(item);
+        } else if (was_triggered && !is_triggered) {
+            cleared.append(before->io_index);
+        }
+    }
+    if (!triggered.empty()) {
+        delta["triggered"] = triggered;
+        changed = true;
+    }
+    if (!cleared.empty()) {
+        delta["cleared"] = cleared;
+        changed = true;
+    }
+    if (snap.limited_robots != base.limited_robots) {
+        Json::Value ids(Json::arrayValue);
+        for (uint32_t bits = snap.limited_robots; bits != 0; bits &= bits - 1) ids.append(__builtin_ctz(bits));
+        delta["limited_robot_ids"] = ids;
+        changed = true;
+    }
+    if (snap.speed_limited_robots != base.speed_limited_robots) {
+        Json::Value ids(Json::arrayValue);
+        for (uint32_t bits = snap.speed_limited_robots; bits != 0; bits &= bits - 1) ids.append(__builtin_ctz(bits));
+        delta["speed_limited_robot_ids"] = ids;
+        changed = true;
+    }
+    // 配置部分在快照间共享，指针不同即已重建. 配置变化只给出标记，由 HMI 重新 get_config.
+    const bool config_changed = snap.descriptions != base.descriptions || snap.zones != base.zones ||
+                                snap.debounce != base.debounce || snap.limited_speed != base.limited_speed ||
+                                snap.robot_mask != base.robot_mask || snap.io_event_mode != base.io_event_mode ||
+                                snap.debounce_max_delay_ms != base.debounce_max_delay_ms ||
+                                snap.monitor.period_ms != base.monitor.period_ms ||
+                                snap.monitor.fast_period_ms != base.monitor.fast_period_ms ||
+                                snap.monitor.event_watchdog_ms != base.monitor.event_watchdog_ms ||
+                                snap.monitor.rt_priority != base.monitor.rt_priority ||
+                                snap.monitor.cpu_core != base.monitor.cpu_core ||
+                                snap.monitor.lock_memory != base.monitor.lock_memory;
+    if (config_changed) {
+        delta["config_changed"] = true;
+        changed = true;
+    }
+    changed |= snap.system_state != base.system_state;
+    delta["system_state"] = snap.system_state == SYSTEM_STATE_LIMITED ? "LIMITED" : "NORMAL";
+    return changed;
+}
+
+// 状态推送线程: 订阅期间等待快照发布，距上次推送不足 min_interval_ms 时等待到期 (期间的发布合并)，
+// 然后以最新快照相对基准计算增量并发送. 不获取 io_mutex.
+static void status_push_thread_func() {
+    std::unique_lock<std::mutex> lock(status_push_mutex);
+    while (true) {
+        status_push_cv.wait(lock, [] {
+            return !status_push.running ||
+                   (status_push.subscribed && status_push.last_sent &&
+                    status_push.published_version > status_push.last_sent->version);
+        });
+        if (!status_push.running) {
+            break;
+        }
+        const auto due = status_push.last_sent_at + std::chrono::milliseconds(status_push.min_interval_ms);
+        if (std::chrono::steady_clock::now() < due) {
+            status_push_cv.wait_until(lock, due, [] { return !status_push.running; });
+            continue; // 重新检查订阅状态
+        }
+
+        const uint64_t generation = status_push.generation;
+        std::shared_ptr<const SafetyStatusSnapshot> base = status_push.last_sent;
+        lock.unlock();
+        std::shared_ptr<const SafetyStatusSnapshot> snap = load_status_snapshot();
+        Json::Value delta(Json::objectValue);
+        const bool changed = build_status_delta(*base, *snap, delta);
+        if (changed) {
+            delta["operation"] = "status_push";
+            delta["base_version"] = Json::UInt64(base->version);
+            delta["version"] = Json::UInt64(snap->version);
+            if (event_journal.ready.load(std::memory_order_acquire)) {
+                // 两次推送之间已触发又复位的 IO 不出现在增量中，HMI 可据此用 get_events 补齐
+                delta["latest_event_seq"] = Json::UInt64(__atomic_load_n(&event_journal.header->next_seq, __ATOMIC_ACQUIRE));
+            }
+            Json::Value message;
+            message["reqRasterSafetyControlCB"] = delta;
+            send_control_message(message);
+        }
+        lock.lock();
+        if (status_push.generation == generation) {
+            status_push.last_sent = snap;
+            if (changed) {
+                status_push.last_sent_at = std::chrono::steady_clock::now();
+            }
+        }
+    }
+}
+
+// 订阅 (subscribe 为 true) 或退订状态推送. 订阅时以当前快照为增量基准 (base_version 返回其序号)，
+// 可选 min_interval_ms 设置相邻推送的最小间隔 (STATUS_PUSH_INTERVAL_MIN_MS-STATUS_PUSH_INTERVAL_MAX_MS).
+static bool update_status_subscription(const Json::Value& root, bool subscribe, uint64_t& base_version, std::string& message) {
+    int interval_ms = STATUS_PUSH_INTERVAL_DEFAULT_MS;
+    if (subscribe && root.isMember("min_interval_ms")) {
+        if (!root["min_interval_ms"].isInt() || root["min_interval_ms"].asInt() < STATUS_PUSH_INTERVAL_MIN_MS ||
+            root["min_interval_ms"].asInt() > STATUS_PUSH_INTERVAL_MAX_MS) {
+            message = "min_interval_ms 必须在 " + std::to_string(STATUS_PUSH_INTERVAL_MIN_MS) + "-" +
+                      std::to_string(STATUS_PUSH_INTERVAL_MAX_MS) + " 范围内";
+            return false;
+        }
+        interval_ms = root["min_interval_ms"].asInt();
+    }
+    std::shared_ptr<const SafetyStatusSnapshot> snap = load_status_snapshot();
+    if (subscribe && !snap) {
+        message = "服务尚未启动";
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(status_push_mutex);
+        status_push.generation++;
+        status_push.subscribed = subscribe;
+        status_push.last_sent = subscribe ? snap : nullptr;
+        if (subscribe) {
+            status_push.min_interval_ms = interval_ms;
+            status_push.published_version = snap->version;
+            status_push.last_sent_at = std::chrono::steady_clock::time_point();
+            base_version = snap->version;
+        }
+        status_push_subscribed.store(subscribe);
+    }
+    status_push_cv.notify_one();
+    if(file_logger) SPDLOG_INFO("状态推送已{} (最小间隔 {}ms).", subscribe ? "订阅" : "退订", interval_ms);
+    message = subscribe ? "已订阅状态推送" : "已退订状态推送";
+    return true;
+}
+
+// CRC32 (IEEE 802.3，反射多项式 0xEDB88320)
+static uint32_t crc32_update(uint32_t crc, const void* data, size_t len) {
+    // 首次调用时构建查找表 (函数内静态变量的初始化是线程安全的)
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t;
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            t[i] = c;
+        }
+        return t;
+    }();
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// JSON 配置来源的指纹: 主配置文件的修改时间与大小，以及按区域顺序对各单元配置文件的路径、修改时间与大小
+// 计算的 CRC32 (不存在的单元文件以 -1 计入). 任一文件被编辑、替换、出现或消失都会改变指纹. 主配置文件无法访问时返回 false.
+static bool config_source_fingerprint(const std::vector<SafetyZone>& zones, int64_t& mtime_ns, int64_t& size,
+                                      uint32_t& cell_files_crc) {
+    struct stat st;
+    if (stat((CONFIG_DIR + "/" + CONFIG_FILE_NAME).c_str(), &st) != 0) {
+        return false;
+    }
+    mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    size = st.st_size;
+    uint32_t crc = 0;
+    for (const auto& zone : zones) {
+        const std::string path = cell_config_path(zone.name);
+        int64_t stamp[2] = {-1, -1}; // 修改时间, 大小
+        if (stat(path.c_str(), &st) == 0) {
+            stamp[0] = int64_t(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+            stamp[1] = st.st_size;
+        }
+        crc = crc32_update(crc, path.c_str(), path.size() + 1); // 含结尾的 '\0'，分隔相邻路径
+        crc = crc32_update(crc, stamp, sizeof(stamp));
+    }
+    cell_files_crc = crc;
+    return true;
+}
+
+// 将最新发布的快照 (配置与触发状态) 编译为二进制快照文件. 仅由写入线程或启动前的同步保存调用.
+static bool save_config_snapshot() {
+    std::shared_ptr<const SafetyStatusSnapshot> snap = load_status_snapshot();
+    if (!snap) return false;
+    std::string json_path = CONFIG_DIR + "/" + CONFIG_FILE_NAME;
+    std::string path = CONFIG_DIR + "/" + CONFIG_SNAPSHOT_FILE_NAME;
+
+    ConfigSnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = CONFIG_SNAPSHOT_MAGIC;
+    header.version = CONFIG_SNAPSHOT_VERSION;
+    header.header_size = sizeof(ConfigSnapshotHeader);
+    header.entry_count = static_cast<uint32_t>(snap->io_states.size());
+    {
+        std::lock_guard<std::mutex> file_lock(config_file_mutex); // JSON 不在写入中时取其指纹
+        if (!config_source_fingerprint(*snap->zones, header.json_mtime_ns, header.json_size, header.cell_files_crc)) {
+            if(file_logger) SPDLOG_WARN("生成二进制配置快照失败: 无法获取 {} 的状态.", json_path);
+            return false;
+        }
+    }
+    header.limited_speed = snap->limited_speed;
+    header.state_confirm_timeout_ms = state_confirm_timeout_ms.load();
+    header.period_ms = snap->monitor.period_ms;
+    header.fast_period_ms = snap->monitor.fast_period_ms;
+    header.event_watchdog_ms = snap->monitor.event_watchdog_ms;
+    header.rt_priority = snap->monitor.rt_priority;
+    header.cpu_core = snap->monitor.cpu_core;
+    header.lock_memory = snap->monitor.lock_memory ? 1 : 0;
+    header.robot_mask = snap->robot_mask;
+    header.io_event_mode = snap->io_event_mode ? 1 : 0;
+
+    std::string payload;
+    payload.reserve(snap->io_states.size() * (sizeof(ConfigSnapshotEntry) + 16));
+    for (const auto& io : snap->io_states) {
+        const std::string& description = status_description(*snap, io);
+        ConfigSnapshotEntry entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.io_index = static_cast<int16_t>(io.io_index);
+        entry.reset_io_index = static_cast<int16_t>(io.reset_io_index);
+        entry.trigger_value = static_cast<uint8_t>(io.trigger_value);
+        entry.already_triggered = io.already_triggered ? 1 : 0;
+        entry.description_len = static_cast<uint16_t>(std::min<size_t>(description.size(), 0xFFFF));
+        entry.trigger_time = static_cast<int64_t>(io.trigger_time);
+        payload.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        payload.append(description.data(), entry.description_len);
+    }
+    header.zone_count = static_cast<uint16_t>(snap->zones->size());
+    for (const auto& zone : *snap->zones) {
+        ConfigSnapshotZone record;
+        std::memset(&record, 0, sizeof(record));
+        record.robot_mask = zone.robot_mask;
+        record.action = zone.action;
+        record.io_count = static_cast<uint16_t>(zone.io_indices.size());
+        record.name_len = static_cast<uint16_t>(std::min<size_t>(zone.name.size(), 0xFFFF));
+        payload.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        for (int io_index : zone.io_indices) {
+            int16_t value = static_cast<int16_t>(io_index);
+            payload.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        payload.append(zone.name.data(), record.name_len);
+    }
+    header.debounce_count = static_cast<uint16_t>(snap->debounce->size());
+    header.debounce_max_delay_ms = static_cast<uint16_t>(snap->debounce_max_delay_ms);
+    for (const auto& entry : *snap->debounce) {
+        ConfigSnapshotDebounce record;
+        record.io_index = static_cast<int16_t>(entry.first);
+        record.trigger_samples = static_cast<uint16_t>(entry.second.trigger_samples);
+        record.trigger_min_ms = static_cast<uint16_t>(entry.second.trigger_min_ms);
+        record.reset_holdoff_ms = static_cast<uint16_t>(entry.second.reset_holdoff_ms);
+        payload.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    header.payload_size = static_cast<uint32_t>(payload.size());
+    header.payload_crc = crc32_update(0, payload.data(), payload.size());
+    header.header_crc = crc32_update(0, &header, offsetof(ConfigSnapshotHeader, header_crc));
+
+    std::string content(reinterpret_cast<const char*>(&header), sizeof(header));
+    content += payload;
+    const uint32_t content_crc = crc32_update(0, content.data(), content.size());
+    if (last_snapshot_written.valid && last_snapshot_written.crc == content_crc && last_snapshot_written.size == content.size()) {
+        if(file_logger) SPDLOG_DEBUG("二进制配置快照内容未变化，跳过写入.");
+        return true;
+    }
+    if (!write_file_atomically(path, content)) {
+        return false;
+    }
+    last_snapshot_written.valid = true;
+    last_snapshot_written.crc = content_crc;
+    last_snapshot_written.size = content.size();
+    if(file_logger) SPDLOG_DEBUG("二进制配置快照已更新: {} ({} 条, {} 字节).", path, header.entry_count, content.size());
+    return true;
+}
+
+// 一次读取并校验二进制快照 (魔数、版本、长度、CRC、各字段范围). 不修改全局状态.
+static bool load_config_snapshot(ConfigSnapshotImage& image) {
+    std::string path = CONFIG_DIR + "/" + CONFIG_SNAPSHOT_FILE_NAME;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false; // 尚未生成
+    }
+    struct stat st;
+    std::vector<char> buffer;
+    if (fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(ConfigSnapshotHeader))) {
+        buffer.resize(static_cast<size_t>(st.st_size));
+        size_t got = 0;
+        while (got < buffer.size()) {
+            ssize_t n = read(fd, buffer.data() + got, buffer.size() - got);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            got += static_cast<size_t>(n);
+        }
+        buffer.resize(got);
+    }
+    close(fd);
+
+    if (buffer.size() < sizeof(ConfigSnapshotHeader)) {
+        if(file_logger) SPDLOG_WARN("二进制配置快照 {} 长度不足，忽略.", path);
+        return false;
+    }
+    ConfigSnapshotHeader& header = image.header;
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    if (header.magic != CONFIG_SNAPSHOT_MAGIC || header.version != CONFIG_SNAPSHOT_VERSION ||
+        header.header_size != sizeof(ConfigSnapshotHeader) ||
+        header.header_crc != crc32_update(0, &header, offsetof(ConfigSnapshotHeader, header_crc)) ||
+        buffer.size() != sizeof(ConfigSnapshotHeader) + header.payload_size ||
+        header.payload_crc != crc32_update(0, buffer.data() + sizeof(header), header.payload_size)) {
+        if(file_logger) SPDLOG_WARN("二进制配置快照 {} 格式或校验和不匹配，忽略.", path);
+        return false;
+    }
+
+    image.entries.clear();
+    image.entries.reserve(header.entry_count);
+    size_t offset = sizeof(ConfigSnapshotHeader);
+    int last_index = -1;
+    for (uint32_t n = 0; n < header.entry_count; ++n) {
+        ConfigSnapshotEntry entry;
+        if (offset + sizeof(entry) > buffer.size()) return false;
+        std::memcpy(&entry, buffer.data() + offset, sizeof(entry));
+        offset += sizeof(entry);
+        if (offset + entry.description_len > buffer.size() ||
+            entry.io_index <= last_index || entry.io_index > 2048 ||
+            entry.reset_io_index < 0 || entry.reset_io_index > 2048 || entry.trigger_value > 1) {
+            if(file_logger) SPDLOG_WARN("二进制配置快照 {} 第 {} 个条目无效，忽略整个快照.", path, n);
+            return false;
+        }
+        IOConfig cfg(entry.io_index, entry.reset_io_index, entry.trigger_value,
+                     std::string(buffer.data() + offset, entry.description_len));
+        offset += entry.description_len;
+        cfg.is_configured = true;
+        cfg.already_triggered = entry.already_triggered != 0;
+        cfg.trigger_time = static_cast<std::time_t>(entry.trigger_time);
+        image.entries.push_back(cfg);
+        last_index = entry.io_index;
+    }
+
+    image.zones.clear();
+    image.zones.reserve(header.zone_count);
+    for (uint32_t n = 0; n < header.zone_count; ++n) {
+        ConfigSnapshotZone record;
+        if (offset + sizeof(record) > buffer.size()) return false;
+        std::memcpy(&record, buffer.data() + offset, sizeof(record));
+        offset += sizeof(record);
+        if (offset + record.io_count * sizeof(int16_t) + record.name_len > buffer.size()) return false;
+        SafetyZone zone;
+        zone.robot_mask = record.robot_mask;
+        zone.action = static_cast<ZoneAction>(record.action); // 由 validate_safety_zones 检查范围
+        zone.io_indices.resize(record.io_count);
+        for (uint16_t k = 0; k < record.io_count; ++k) {
+            int16_t value;
+            std::memcpy(&value, buffer.data() + offset, sizeof(value));
+            offset += sizeof(value);
+            zone.io_indices[k] = value;
+        }
+        zone.name.assign(buffer.data() + offset, record.name_len);
+        offset += record.name_len;
+        image.zones.push_back(std::move(zone));
+    }
+
+    image.debounce.clear();
+    image.debounce.reserve(header.debounce_count);
+    for (uint32_t n = 0; n < header.debounce_count; ++n) {
+        ConfigSnapshotDebounce record;
+        if (offset + sizeof(record) > buffer.size()) return false;
+        std::memcpy(&record, buffer.data() + offset, sizeof(record));
+        offset += sizeof(record);
+        IODebounce cfg;
+        cfg.trigger_samples = record.trigger_samples;
+        cfg.trigger_min_ms = record.trigger_min_ms;
+        cfg.reset_holdoff_ms = record.reset_holdoff_ms;
+        image.debounce.emplace_back(record.io_index, cfg); // 由 validate_debounce 检查范围
+    }
+    return offset == buffer.size();
+}
+
+// 以二进制快照装载配置与触发状态. 假定调用者已持有 io_mutex. 设置无效时返回 false 且不修改任何状态.
+static bool apply_config_snapshot(const ConfigSnapshotImage& image) {
+    const ConfigSnapshotHeader& h = image.header;
+    MonitorSettings loaded = {h.period_ms, h.fast_period_ms, h.event_watchdog_ms, h.rt_priority, h.cpu_core, h.lock_memory != 0};
+    std::string error;
+    std::vector<SafetyZone> zones = image.zones;
+    if (h.limited_speed < 0 || h.limited_speed > 100 || !validate_safety_zones(zones, error) ||
+        !validate_debounce(image.debounce, h.debounce_max_delay_ms, error) ||
+        h.robot_mask == 0 || (h.robot_mask & ~(((2u << MAX_ROBOT_ID) - 1) & ~1u)) != 0 ||
+        h.state_confirm_timeout_ms < STATE_CONFIRM_POLL_MS || h.state_confirm_timeout_ms > 5000 ||
+        !validate_monitor_settings(loaded, error)) {
+        if(file_logger) SPDLOG_WARN("二进制配置快照中的设置无效，改为解析 JSON.");
+        return false;
+    }
+    bind_cell_instances(zones);
+    assign_io_entries(io_table, image.entries);
+    configured_limited_speed = h.limited_speed;
+    io_event_mode = h.io_event_mode != 0;
+    set_handled_robots(h.robot_mask);
+    install_safety_zones(std::move(zones));
+    ensure_zone_robots_handled("二进制配置快照");
+    install_debounce(image.debounce, h.debounce_max_delay_ms);
+    monitor_settings = loaded;
+    monitor_settings_version++;
+    state_confirm_timeout_ms.store(h.state_confirm_timeout_ms);
+    return true;
+}
+
+// 仅尝试从二进制快照装载配置: 快照有效且由当前 JSON 生成时装载并返回 true，否则不修改任何状态.
+// 假定调用者已持有 io_mutex. 启动时用于在解析 JSON 之前尽早启动监测.
+static bool load_cached_config() {
+    ConfigSnapshotImage image;
+    if (!load_config_snapshot(image)) {
+        return false;
+    }
+    int64_t json_mtime_ns = 0;
+    int64_t json_size = 0;
+    uint32_t cell_files_crc = 0;
+    if (!config_source_fingerprint(image.zones, json_mtime_ns, json_size, cell_files_crc) ||
+        image.header.json_mtime_ns != json_mtime_ns || image.header.json_size != json_size ||
+        image.header.cell_files_crc != cell_files_crc || !apply_config_snapshot(image)) {
+        return false;
+    }
+    int restored_triggered = 0;
+    for (const auto& io : io_table.entries) {
+        if (io.already_triggered) restored_triggered++;
+    }
+    if(file_logger) SPDLOG_INFO("已从二进制快照加载配置. 已加载配置 IO {} 条 (其中 {} 条恢复为已触发), 配置的限速: {}%",
+                                io_table.entries.size(), restored_triggered, configured_limited_speed);
+    return true;
+}
+
+static bool load_from_file() {
+    std::string filename = CONFIG_DIR + "/" + CONFIG_FILE_NAME;
+    std::ifstream file;
+    Json::Value j;
+
+    // 确保目录存在
+    if (!createDirectory(CONFIG_DIR)) {
+        if(file_logger) SPDLOG_ERROR("加载配置失败: 创建目录失败.");
+        return false;
+    }
+
+    if (!fileExists(filename)) {
+        // 如果找不到配置文件，则创建一个默认文件
+        if(file_logger) SPDLOG_INFO("配置文件未找到: {}，将尝试创建默认配置.", filename);
+        publish_status_snapshot(); // save_to_file 从快照取得默认配置
+        bool created_default = save_to_file();
+        if (created_default) {
+            save_config_snapshot();
+            if(file_logger) SPDLOG_INFO("默认配置文件已创建.");
+            return true; // 默认配置已创建并加载
+        } else {
+            std::cerr << "[光栅安全控制] 无法创建默认配置文件: " + filename << std::endl;
+            if(file_logger) SPDLOG_ERROR("无法创建默认配置文件: {}", filename);
+            return false; // 无法创建默认文件
+        }
+    }
+
+    // 快速路径: 二进制快照有效且由当前 JSON 生成时直接装载 (含最近的触发状态)，跳过 JSON 解析
+    if (load_cached_config()) {
+        return true;
+    }
+    ConfigSnapshotImage image; // 快照与 JSON 不一致时仍用于继承触发状态
+    bool have_image = load_config_snapshot(image);
+    if (have_image) {
+        if(file_logger) SPDLOG_INFO("二进制配置快照与当前 JSON 不一致，解析 JSON 并重新生成快照.");
+    }
+
+    // 文件存在，尝试打开
+    file.open(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!file) {
+        std::cerr << "[光栅安全控制] 无法打开配置文件进行读取: " + filename << std::endl;
+        if(file_logger) SPDLOG_ERROR("无法打开配置文件进行读取: {}", filename);
+        return false;
+    }
+
+    // 一次读入整个文件后解析 (避免逐字符的流式解析)
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    {
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        std::string errors;
+        if (!reader->parse(content.data(), content.data() + content.size(), &j, &errors) || !j.isObject()) {
+            std::cerr << "[光栅安全控制] 配置文件解析失败: " + errors << std::endl;
+            if(file_logger) SPDLOG_ERROR("配置文件解析失败: {}", errors.empty() ? "顶层不是对象" : errors);
+            return false;
+        }
+        if(file_logger) SPDLOG_DEBUG("配置文件内容已成功解析为 JSON.");
+    }
+
+    // 以文件中的条目整体替换 io_table (无效条目跳过，重复的 io_index 以后者为准)
+    std::vector<IOConfig> entries;
+    if (j["io_config"].isArray()) {
+        if(file_logger) SPDLOG_DEBUG("配置文件包含 'io_config' 数组，开始加载 IO 配置...");
+        parse_io_config_items(j["io_config"], "配置文件", entries);
+    } else {
+         if(file_logger) SPDLOG_WARN("配置文件不包含有效的 'io_config' 数组或数组为空.");
+    }
+
+    // 加载安全区域 (单元) 及各单元配置文件中的 IO (缺失时不分区; 列表无效时整体忽略，所有 IO 保护全部机器人).
+    // 单元文件损坏时从二进制快照恢复该单元，快照也不可用时报警
+    std::vector<SafetyZone> zones;
+    if (j.isMember("zones")) {
+        std::string error;
+        std::vector<std::string> failed;
+        if (!load_cell_zones(j["zones"], entries, zones, failed, error)) {
+            if(file_logger) SPDLOG_WARN("配置文件中的 zones 无效 ({})，不分区，所有 IO 保护全部机器人.", error);
+            zones.clear();
+        }
+        for (const auto& name : failed) {
+            int z = have_image ? find_zone(image.zones, name) : -1;
+            if (z >= 0) {
+                const SafetyZone& cached = image.zones[z];
+                for (const auto& cfg : image.entries) {
+                    if (std::binary_search(cached.io_indices.begin(), cached.io_indices.end(), cfg.io_index)) entries.push_back(cfg);
+                }
+                zones.push_back(cached);
+                if(file_logger) SPDLOG_WARN("单元 {} 已从二进制快照恢复: {} 个成员 IO.", name, cached.io_indices.size());
+            } else {
+                const std::string msg = "光栅安全: 单元 " + name + " 的配置文件无法装载，该单元的光栅未受监测";
+                if(file_logger) SPDLOG_ERROR("{}", msg);
+                controller().error_report(3, msg);
+            }
+        }
+        if (!validate_safety_zones(zones, error)) {
+            if(file_logger) SPDLOG_WARN("配置文件中的单元无效 ({})，不分区，所有 IO 保护全部机器人.", error);
+            zones.clear();
+        }
+    }
+    bind_cell_instances(zones);
+
+    const size_t loaded_io_count = entries.size();
+    assign_io_entries(io_table, std::move(entries));
+    if(file_logger) SPDLOG_DEBUG("IO 配置数组加载完成. 加载了 {} 个有效 IO 配置条目.", loaded_io_count);
+    install_safety_zones(std::move(zones));
+    if(file_logger) SPDLOG_DEBUG("安全区域已加载: {} 个", safety_zones->size());
+
+    // 加载 configured_limited_speed
+    configured_limited_speed = json_int(j, "limited_speed", configured_limited_speed);
+    if (configured_limited_speed < 0 || configured_limited_speed > 100) {
+         if(file_logger) SPDLOG_WARN("从文件加载的 configured_limited_speed {} 无效. 使用默认值 {}.", configured_limited_speed, 30);
+         configured_limited_speed = 30;
+    }
+    if(file_logger) SPDLOG_DEBUG("configured_limited_speed 已加载: {}%", configured_limited_speed);
+
+    // 加载 IO 变化检测模式 (缺省为轮询模式)
+    io_event_mode = j["io_event_mode"].isBool() && j["io_event_mode"].asBool();
+    if(file_logger) SPDLOG_DEBUG("io_event_mode 已加载: {}", io_event_mode ? "事件驱动" : "自适应轮询");
+
+    // 加载受控机器人列表 (缺失或无效时使用缺省的 1 和 2)
+    uint32_t robot_mask = DEFAULT_ROBOT_MASK;
+    if (j.isMember("robot_ids")) {
+        std::string error;
+        uint32_t loaded_mask = 0;
+        if (parse_robot_ids(j["robot_ids"], loaded_mask, error)) {
+            robot_mask = loaded_mask;
+        } else {
+            if(file_logger) SPDLOG_WARN("配置文件中的 robot_ids 无效 ({})，使用缺省机器人 1 和 2.", error);
+        }
+    }
+    set_handled_robots(robot_mask);
+    ensure_zone_robots_handled("配置文件");
+    if(file_logger) SPDLOG_DEBUG("受控机器人掩码已加载: {:#x}", handled_robot_mask.load());
+
+    // 加载 IO 去抖配置 (缺失时不滤波; 无效时整体忽略，所有 IO 首个满足条件的采样即触发)
+    IODebounceList debounce;
+    int max_delay_ms = DEBOUNCE_MAX_DELAY_DEFAULT_MS;
+    if (j.isMember("debounce")) {
+        std::string error = "格式错误";
+        const Json::Value& d = j["debounce"];
+        bool valid = d.isObject() && (!d.isMember("max_delay_ms") || d["max_delay_ms"].isInt());
+        if (valid) {
+            max_delay_ms = json_int(d, "max_delay_ms", max_delay_ms);
+            valid = !d.isMember("io") || parse_debounce_entries(d, debounce, error);
+        }
+        if (valid) valid = validate_debounce(debounce, max_delay_ms, error);
+        if (!valid) {
+            if(file_logger) SPDLOG_WARN("配置文件中的 debounce 无效 ({})，不启用去抖.", error);
+            debounce.clear();
+            max_delay_ms = DEBOUNCE_MAX_DELAY_DEFAULT_MS;
+        }
+    }
+    install_debounce(debounce, max_delay_ms);
+    if(file_logger) SPDLOG_DEBUG("IO 去抖配置已加载: {} 个 IO, 触发延迟上界 {}ms", debounce.size(), max_delay_ms);
+
+    // 加载监测线程周期与调度设置 (缺失字段使用当前值)
+    if (j["monitor"].isObject()) {
+        const Json::Value& m = j["monitor"];
+        MonitorSettings loaded = monitor_settings;
+        loaded.period_ms = json_int(m, "period_ms", loaded.period_ms);
+        loaded.fast_period_ms = json_int(m, "fast_period_ms", loaded.fast_period_ms);
+        loaded.event_watchdog_ms = json_int(m, "event_watchdog_ms", loaded.event_watchdog_ms);
+        loaded.rt_priority = json_int(m, "rt_priority", loaded.rt_priority);
+        loaded.cpu_core = json_int(m, "cpu_core", loaded.cpu_core);
+        if (m["lock_memory"].isBool()) loaded.lock_memory = m["lock_memory"].asBool();
+
+        std::string error;
+        if (validate_monitor_settings(loaded, error)) {
+            monitor_settings = loaded;
+            monitor_settings_version++;
+            if(file_logger) SPDLOG_DEBUG("监测设置已加载: 周期 {}ms, 快速周期 {}ms, 兜底周期 {}ms, 实时优先级 {}, CPU {}, 锁定内存 {}",
+                                         loaded.period_ms, loaded.fast_period_ms, loaded.event_watchdog_ms,
+                                         loaded.rt_priority, loaded.cpu_core, loaded.lock_memory);
+        } else {
+            if(file_logger) SPDLOG_WARN("配置文件中的监测设置无效: {}. 使用默认值.", error);
+        }
+    }
+
+    // 加载状态确认超时
+    int confirm_timeout = json_int(j, "state_confirm_timeout_ms", STATE_CONFIRM_WAIT_MS);
+    if (confirm_timeout < STATE_CONFIRM_POLL_MS || confirm_timeout > 5000) {
+         if(file_logger) SPDLOG_WARN("从文件加载的 state_confirm_timeout_ms {} 无效，应在 {}-5000 范围内. 使用默认值 {}.", confirm_timeout, STATE_CONFIRM_POLL_MS, STATE_CONFIRM_WAIT_MS);
+         confirm_timeout = STATE_CONFIRM_WAIT_MS;
+    }
+    state_confirm_timeout_ms.store(confirm_timeout);
+    if(file_logger) SPDLOG_DEBUG("state_confirm_timeout_ms 已加载: {}ms", confirm_timeout);
+
+    // JSON 已被编辑: 条件未变化的条目仍继承快照中的最近触发状态
+    if (have_image) {
+        for (const auto& old : image.entries) {
+            int slot = io_table.slot_by_index[old.io_index];
+            if (slot < 0) continue;
+            IOConfig& cfg = io_table.entries[slot];
+            if (cfg.reset_io_index == old.reset_io_index && cfg.trigger_value == old.trigger_value) {
+                cfg.already_triggered = old.already_triggered;
+                cfg.trigger_time = old.trigger_time;
+            }
+        }
+        sync_triggered_mask();
+    }
+    request_snapshot_save(); // JSON 为来源，重新编译二进制快照 (写入线程启动后执行)
+
+    // loaded_io_count 现在在此处是可见的
+    if(file_logger) SPDLOG_INFO("成功从文件加载配置. 已加载配置 IO {} 条, 配置的限速: {}%", loaded_io_count, configured_limited_speed);
+    return true;
+}
+
+// 主状态机循环
+static void io_monitor_thread() {
+    std::cout << "[光栅安全控制] IO监测线程启动!" << std::endl;
+    if(file_logger) SPDLOG_INFO("[光栅安全控制] IO监测线程启动!");
+
+    // 机器人运行状态由运行状态刷新线程查询，评估周期内不调用 NRC 状态接口
+
+
+    // 本周期与上一周期的 IO 快照，比较两者以检测 IO 变化并调整轮询周期. 仅本线程访问.
+    IOSnapshot snapshot;
+    std::bitset<2049> last_io_values;
+    IOEvalWords eval_words; // 位运算评估内核的工作字，跨周期复用
+
+    // 周期与调度设置的本线程副本，版本变化时在锁内刷新并重新应用
+    MonitorSettings settings;
+    unsigned applied_settings_version = 0;
+    {
+        ProfiledLock lock(io_mutex, LOCK_SITE_MONITOR);
+        settings = monitor_settings;
+        applied_settings_version = monitor_settings_version.load();
+    }
+    apply_monitor_thread_settings(settings);
+
+    int poll_ms = settings.fast_period_ms;
+    // 下一周期的绝对截止时刻. 按截止时刻而非相对时长等待，周期不会因处理耗时而漂移.
+    auto next_deadline = std::chrono::steady_clock::now();
+
+    while (thread_running) {
+        const auto cycle_start = std::chrono::steady_clock::now();
+        SystemState required_state = SYSTEM_STATE_NORMAL;
+        bool any_io_has_already_triggered_flag = false; // 检查内部状态标志
+        bool io_activity = false; // 本周期是否观察到任何 IO 值变化
+        bool debounce_pending = false; // 有 IO 正在去抖滤波中，需按快速周期继续采样
+        bool event_mode = false;
+        bool settings_changed = false;
+
+        { // --- 状态机逻辑的锁范围 ---
+            ProfiledLock lock(io_mutex, LOCK_SITE_MONITOR); // 保护 IO 配置、状态和系统状态 (更新时)
+
+            // 周期开始时接管已构建好的新配置表 (若有)
+            if (install_pending_io_config()) {
+                if(file_logger) SPDLOG_DEBUG("监测线程已切换到新的 IO 配置表，共 {} 个条目.", io_table.entries.size());
+            }
+
+            // 步骤 0: 一次性读取本周期需要的所有 IO (IO索引已经验证过在0-2048范围内)
+            read_io_snapshot(io_table.read_set, snapshot);
+            const auto observed_at = std::chrono::steady_clock::now(); // 本周期观察到 IO 状态的时刻
+            io_activity = (snapshot.values != last_io_values);
+            last_io_values = snapshot.values;
+
+            // 人工复位请求基于本周期的同一快照执行，随后的评估即反映复位结果
+            run_pending_reset(snapshot);
+
+            // 步骤 1: 基于快照用位运算内核评估所有 IO，并同步发生变化的 `already_triggered` 标志
+            int triggered_io_count = evaluate_io_triggers(snapshot, eval_words, observed_at);
+            any_io_has_already_triggered_flag = (triggered_io_count > 0);
+            debounce_pending = eval_words.debounce_pending;
+
+            bool trigger_set_changed = false;
+            int cause_io = -1; // 本周期第一个发生边沿的 IO，记录为状态转换原因
+            for (size_t k = 0; k < eval_words.newly_triggered.size(); ++k) {
+                trigger_set_changed |= (eval_words.newly_triggered[k] | eval_words.newly_reset[k]) != 0;
+                // 新触发: 触发条件满足且此前未触发
+                for (uint64_t bits = eval_words.newly_triggered[k]; bits != 0; bits &= bits - 1) {
+                    auto& io = io_table.entries[k * 64 + __builtin_ctzll(bits)];
+                    io.already_triggered = true; // 设置标志
+                    io.trigger_time = std::time(nullptr);
+                    if (cause_io < 0) cause_io = io.io_index;
+                    EventRecord ev = make_event(EVENT_IO_TRIGGERED);
+                    ev.io_index = io.io_index;
+                    ev.status_after = snapshot.values[io.io_index] ? 1 : 0;
+                    append_event(ev);
+                    if(file_logger) SPDLOG_WARN("安全 IO 已触发: 索引 {} (描述: {}), 配置触发值是 {}, 当前值是 {}.",
+                                                io.io_index, io.description, io.trigger_value, snapshot.values[io.io_index] ? 1 : 0);
+                    if (spdlog::logger* cell_log = cell_logger_for_io(io.io_index)) {
+                        cell_log->warn("安全 IO 已触发: 索引 {} (描述: {}).", io.io_index, io.description);
+                    }
+                    // 这里记录特定 IO 触发，通用系统状态转换报告稍后发送.
+                }
+                // 复位: 触发条件已解除且满足复位条件 (无专用复位 IO，或复位 IO 为高电平)
+                for (uint64_t bits = eval_words.newly_reset[k]; bits != 0; bits &= bits - 1) {
+                    auto& io = io_table.entries[k * 64 + __builtin_ctzll(bits)];
+                    io.already_triggered = false; // 清除标志
+                    io.trigger_time = 0; // 重置触发时间
+                    if (cause_io < 0) cause_io = io.io_index;
+                    EventRecord ev = make_event(EVENT_IO_RESET);
+                    ev.io_index = io.io_index;
+                    ev.status_after = snapshot.values[io.io_index] ? 1 : 0;
+                    append_event(ev);
+                    if(file_logger) SPDLOG_INFO("安全 IO 已复位: 索引 {} (描述: {}). 复位条件满足 (复位 IO: {}).",
+                                                io.io_index, io.description, io.reset_io_index);
+                    if (spdlog::logger* cell_log = cell_logger_for_io(io.io_index)) {
+                        cell_log->info("安全 IO 已复位: 索引 {} (描述: {}).", io.io_index, io.description);
+                    }
+                    // 系统恢复在 *所有* 标志清除时发生
+                }
+            }
+            // 触发条件解除但复位条件不满足的 IO 保持已触发，等待复位条件.
+
+            // 步骤 2: 根据内部 `already_triggered` 标志确定所需的系统状态与需要限制的机器人集合
+            // 如果 *任何一个* 已配置的 IO 的 `already_triggered` 标志已设置，则系统应为 LIMITED;
+            // 只有已触发 IO 所属区域的机器人 (未归属区域的 IO 为全部机器人) 需要暂停或限速.
+            required_state = any_io_has_already_triggered_flag ? SYSTEM_STATE_LIMITED : SYSTEM_STATE_NORMAL;
+            uint32_t required_speed_robots = 0;
+            const uint32_t required_robots = any_io_has_already_triggered_flag ? limited_robots_for_triggers(required_speed_robots) : 0;
+
+            // 步骤 3: 如果需要，执行状态转换动作
+            SystemState previous_state = current_system_state.load(std::memory_order_acquire); // 原子读取
+            const bool state_changed = (previous_state != required_state);
+
+            // 如果检测到状态变化
+            if (state_changed) {
+                if(file_logger) SPDLOG_INFO("检测到系统状态变化: {} -> {}",
+                                            previous_state == SYSTEM_STATE_NORMAL ? "正常" : "安全受限",
+                                            required_state == SYSTEM_STATE_NORMAL ? "正常" : "安全受限");
+
+                // 先更新全局状态，以便其他地方读取到最新状态
+                current_system_state.store(required_state, std::memory_order_release);
+                EventRecord ev = make_event(EVENT_STATE_CHANGE);
+                ev.io_index = cause_io;
+                ev.from_state = static_cast<uint8_t>(previous_state);
+                ev.to_state = static_cast<uint8_t>(required_state);
+                append_event(ev);
+                trigger_set_changed = true; // 状态变化同样需要发布快照
+            }
+
+            // 按区域调和被限制的机器人: 新需要限制的暂停，不再需要限制的恢复. 每周期比较，
+            // 配置/区域/受控机器人变化后同样在此收敛. 暂停先于恢复投递.
+            const uint32_t applied_robots = limited_robot_mask.load();
+            if (required_robots != applied_robots) {
+                const uint32_t to_pause = required_robots & ~applied_robots;
+                const uint32_t to_resume = applied_robots & ~required_robots;
+                limited_robot_mask.store(required_robots);
+                if(file_logger) SPDLOG_INFO("受限机器人集合变化: {:#x} -> {:#x} (暂停 {:#x}, 恢复 {:#x})",
+                                            applied_robots, required_robots, to_pause, to_resume);
+
+                // 投递动作命令，由动作执行线程完成通知与暂停/恢复，不在锁定区域内等待
+                const auto decided_at = std::chrono::steady_clock::now();
+                if (to_pause != 0) {
+                    record_latency(safety_metrics.trip_to_decision, decided_at - observed_at);
+                    post_action(ACTION_PAUSE, true, observed_at, decided_at, cause_io, to_pause, -1);
+                }
+                if (to_resume != 0) {
+                    record_latency(safety_metrics.reset_to_decision, decided_at - observed_at);
+                    post_action(ACTION_RESUME, true, observed_at, decided_at, cause_io, to_resume, -1);
+                }
+                trigger_set_changed = true;
+            }
+
+            // 限速层与暂停层独立调和: 同时被暂停与限速的机器人解除暂停后仍保持限速.
+            // 限速值变化时对仍在限速的机器人重新下发.
+            const uint32_t applied_speed_robots = speed_limited_robot_mask.load();
+            const bool speed_value_changed = required_speed_robots != 0 && applied_limited_speed != configured_limited_speed;
+            if (required_speed_robots != applied_speed_robots || speed_value_changed) {
+                const uint32_t to_limit = speed_value_changed ? required_speed_robots : (required_speed_robots & ~applied_speed_robots);
+                const uint32_t to_restore = applied_speed_robots & ~required_speed_robots;
+                speed_limited_robot_mask.store(required_speed_robots);
+                applied_limited_speed = required_speed_robots != 0 ? configured_limited_speed : -1;
+                if(file_logger) SPDLOG_INFO("限速机器人集合变化: {:#x} -> {:#x} (限速 {:#x} 至 {}%, 恢复 {:#x})",
+                                            applied_speed_robots, required_speed_robots, to_limit, configured_limited_speed, to_restore);
+
+                const auto decided_at = std::chrono::steady_clock::now();
+                if (to_limit != 0) {
+                    record_latency(safety_metrics.trip_to_decision, decided_at - observed_at);
+                    post_action(ACTION_LIMIT_SPEED, true, observed_at, decided_at, cause_io, to_limit, configured_limited_speed);
+                }
+                if (to_restore != 0) {
+                    record_latency(safety_metrics.reset_to_decision, decided_at - observed_at);
+                    post_action(ACTION_RESTORE_SPEED, true, observed_at, decided_at, cause_io, to_restore, -1);
+                }
+                trigger_set_changed = true;
+            }
+
+            // 步骤 5: 状态或触发集合变化时发布新的安全状态快照，供查询接口无锁读取
+            if (trigger_set_changed) {
+                publish_status_snapshot();
+                request_snapshot_save(); // 最近触发状态由写入线程异步写入二进制快照
+            }
+
+            event_mode = io_event_mode;
+            settings_changed = (monitor_settings_version.load() != applied_settings_version);
+            if (settings_changed) {
+                settings = monitor_settings;
+                applied_settings_version = monitor_settings_version.load();
+            }
+        }  // --- 锁范围结束 ---
+
+        if (monitor_armed_ns.load(std::memory_order_relaxed) == 0) {
+            monitor_armed_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        if (settings_changed) {
+            apply_monitor_thread_settings(settings); // 在锁外应用，系统调用不占用 io_mutex
+        }
+
+        // 等待下一周期: 事件模式下等待变化通知 (兜底周期轮询);
+        // 轮询模式下检测到 IO 变化后快速轮询，空闲时周期逐步加倍直至 settings.period_ms.
+        // 有 IO 在去抖滤波中时两种模式均按快速周期采样.
+        if (io_activity || debounce_pending || poll_ms < settings.fast_period_ms) {
+            poll_ms = settings.fast_period_ms;
+        } else if (poll_ms < settings.period_ms) {
+            poll_ms = std::min(poll_ms * 2, settings.period_ms);
+        } else {
+            poll_ms = settings.period_ms;
+        }
+        auto now = std::chrono::steady_clock::now();
+        record_latency(safety_metrics.cycle_duration, now - cycle_start);
+        next_deadline += std::chrono::milliseconds(event_mode && !debounce_pending ? settings.event_watchdog_ms : poll_ms);
+        if (next_deadline < now) {
+            next_deadline = now; // 本周期超时，不补偿错过的周期，直接开始下一周期
+        }
+        bool notified = wait_for_next_cycle(event_mode, next_deadline);
+        auto woke_at = std::chrono::steady_clock::now();
+        if (notified) {
+            next_deadline = woke_at; // 被通知提前唤醒，以唤醒时刻作为新的周期起点
+        } else {
+            record_latency(safety_metrics.cycle_jitter, woke_at - next_deadline);
+        }
+    }
+
+    std::cout << "[光栅安全控制] IO监测线程退出!" << std::endl;
+    if(file_logger) SPDLOG_INFO("[光栅安全控制] IO监测线程退出!");
+}
+
+// 等待下一监测周期，直至绝对截止时刻 deadline.
+// 事件模式: 在条件变量上等待，收到 IO 变化通知或服务停止时提前返回 true.
+// 轮询模式: 使用 clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME) 按绝对时刻休眠，返回 false.
+// (Linux 上 std::chrono::steady_clock 基于 CLOCK_MONOTONIC，两者时间基准一致.)
+static bool wait_for_next_cycle(bool event_mode, std::chrono::steady_clock::time_point deadline) {
+    if (event_mode) {
+        std::unique_lock<std::mutex> lock(monitor_wait_mutex);
+        bool woken = monitor_cv.wait_until(lock, deadline, [] { return io_change_pending || !thread_running; });
+        io_change_pending = false;
+        return woken;
+    }
+
+    auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(since_epoch / 1000000000LL);
+    ts.tv_nsec = static_cast<long>(since_epoch % 1000000000LL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        if (!thread_running) break; // 被信号中断且已请求停止
+    }
+    {
+        std::lock_guard<std::mutex> lock(monitor_wait_mutex);
+        io_change_pending = false; // 轮询模式下通知无意义，丢弃以免切换到事件模式时误唤醒
+    }
+    return false;
+}
+
+// 验证监测设置. 无效时返回 false 并在 error 中给出原因.
+static bool validate_monitor_settings(const MonitorSettings& settings, std::string& error) {
+    if (settings.period_ms < 1 || settings.period_ms > 1000) {
+        error = "period_ms 应在 1-1000 范围内";
+        return false;
+    }
+    if (settings.fast_period_ms < 1 || settings.fast_period_ms > settings.period_ms) {
+        error = "fast_period_ms 应在 1-period_ms 范围内";
+        return false;
+    }
+    if (settings.event_watchdog_ms < settings.period_ms || settings.event_watchdog_ms > 1000) {
+        error = "event_watchdog_ms 应在 period_ms-1000 范围内";
+        return false;
+    }
+    if (settings.rt_priority < 0 || settings.rt_priority > sched_get_priority_max(SCHED_FIFO)) {
+        error = "rt_priority 应在 0-" + std::to_string(sched_get_priority_max(SCHED_FIFO)) + " 范围内";
+        return false;
+    }
+    long cpu_count = sysconf(_SC_NPROCESSORS_CONF);
+    if (settings.cpu_core < -1 || (cpu_count > 0 && settings.cpu_core >= cpu_count)) {
+        error = "cpu_core 应为 -1 或 0-" + std::to_string(cpu_count - 1);
+        return false;
+    }
+    return true;
+}
+
+// 按请求中给出的字段 (其余保持不变) 更新监测设置，验证后生效并保存到文件.
+// 监测线程在下一周期应用新的周期与调度设置.
+static bool update_monitor_settings(const Json::Value& root, std::string& message) {
+    ProfiledLock lock(io_mutex, LOCK_SITE_MONITOR_SETTINGS); // 保护 monitor_settings 和 io_event_mode
+
+    MonitorSettings requested = monitor_settings;
+    bool event_mode = io_event_mode;
+    struct { const char* key; int* field; } int_fields[] = {
+        {"period_ms", &requested.period_ms},
+        {"fast_period_ms", &requested.fast_period_ms},
+        {"event_watchdog_ms", &requested.event_watchdog_ms},
+        {"rt_priority", &requested.rt_priority},
+        {"cpu_core", &requested.cpu_core},
+    };
+    for (const auto& f : int_fields) {
+        if (!root.isMember(f.key)) continue;
+        if (!root[f.key].isInt()) {
+            message = std::string(f.key) + " 类型错误";
+            return false;
+        }
+        *f.field = root[f.key].asInt();
+    }
+    if (root.isMember("lock_memory")) {
+        if (!root["lock_memory"].isBool()) {
+            message = "lock_memory 类型错误";
+            return false;
+        }
+        requested.lock_memory = root["lock_memory"].asBool();
+    }
+    if (root.isMember("io_event_mode")) {
+        if (!root["io_event_mode"].isBool()) {
+            message = "io_event_mode 类型错误";
+            return false;
+        }
+        event_mode = root["io_event_mode"].asBool();
+    }
+
+    std::string error;
+    if (!validate_monitor_settings(requested, error)) {
+        if(file_logger) SPDLOG_WARN("更新监测设置: 参数无效: {}", error);
+        message = "参数无效: " + error;
+        return false;
+    }
+
+    monitor_settings = requested;
+    io_event_mode = event_mode;
+    monitor_settings_version++;
+    publish_status_snapshot();
+    if(file_logger) SPDLOG_INFO("监测设置已更新: 周期 {}ms, 快速周期 {}ms, 兜底周期 {}ms, 实时优先级 {}, CPU {}, 锁定内存 {}, 事件模式 {}",
+                                requested.period_ms, requested.fast_period_ms, requested.event_watchdog_ms,
+                                requested.rt_priority, requested.cpu_core, requested.lock_memory, event_mode);
+    lock.unlock();
+
+    request_config_save();
+    message = "监测设置已更新";
+    return true;
+}
+
+// --- 配置解析 (配置文件与 socket 操作共用同一套 JsonCpp 解析) ---
+
+// 读取对象中的整数字段. 缺失或类型不符时返回 fallback.
+static int json_int(const Json::Value& obj, const char* key, int fallback) {
+    const Json::Value& v = obj[key];
+    return v.isInt() ? v.asInt() : fallback;
+}
+
+// 解析 IO 配置条目数组 (update_config 的 config_data 与配置文件的 io_config). 无效条目记录警告后跳过，
+// 超出范围的 reset_io_index 改为 0，无效的 trigger_value 改为 1. source 为日志前缀. 有效条目追加到 out.
+static void parse_io_config_items(const Json::Value& items, const char* source, std::vector<IOConfig>& out) {
+    out.reserve(out.size() + items.size());
+    for (const auto& item : items) {
+        if (!item.isObject() || !item["io_index"].isInt()) {
+            if(file_logger) SPDLOG_WARN("{}: IO 配置中无效条目 (不是对象或缺少整数 io_index). 跳过.", source);
+            continue;
+        }
+        int io_index = item["io_index"].asInt();
+        if (io_index < 0 || io_index > 2048) {
+            if(file_logger) SPDLOG_WARN("{}: 无效的 io_index {}，应在 0-2048 范围内. 跳过.", source, io_index);
+            continue;
+        }
+        int reset_io_index = json_int(item, "reset_io_index", 0);
+        int trigger_value = json_int(item, "trigger_value", 1);
+        if (reset_io_index < 0 || reset_io_index > 2048) {
+            if(file_logger) SPDLOG_WARN("{}: IO {} 的复位 io_index {} 无效，应在 0-2048 范围内. 设为 0.", source, io_index, reset_io_index);
+            reset_io_index = 0;
+        }
+        if (trigger_value != 0 && trigger_value != 1) {
+            if(file_logger) SPDLOG_WARN("{}: IO {} 的 trigger_value {} 无效，应为 0 或 1. 使用默认值 1.", source, io_index, trigger_value);
+            trigger_value = 1;
+        }
+        const Json::Value& description = item["description"];
+        out.emplace_back(io_index, reset_io_index, trigger_value, description.isString() ? description.asString() : std::string());
+        if(file_logger) SPDLOG_DEBUG("{}: 已解析 IO {} (复位={}, 触发值={})", source, io_index, reset_io_index, trigger_value);
+    }
+}
+
+// 解析机器人 ID 数组为位掩码 (见 robot_mask_from_ids)
+static bool parse_robot_ids(const Json::Value& ids, uint32_t& mask, std::string& error) {
+    if (!ids.isArray()) {
+        error = "robot_ids 应为整数数组";
+        return false;
+    }
+    std::vector<int> list;
+    list.reserve(ids.size());
+    for (const auto& id : ids) {
+        if (!id.isInt()) {
+            error = "robot_ids 应为整数数组";
+            return false;
+        }
+        list.push_back(id.asInt());
+    }
+    return robot_mask_from_ids(list, mask, error);
+}
+
+// 解析并验证区域定义数组 ({name, io_indices, robot_ids, action?}).
+static bool parse_safety_zones(const Json::Value& items, std::vector<SafetyZone>& zones, std::string& error) {
+    if (!items.isArray()) {
+        error = "zones 应为数组";
+        return false;
+    }
+    zones.clear();
+    zones.reserve(items.size());
+    for (const auto& item : items) {
+        if (!item.isObject() || !item["name"].isString() || !item["io_indices"].isArray() || !item.isMember("robot_ids")) {
+            error = "区域条目应包含 name、io_indices 与 robot_ids";
+            return false;
+        }
+        SafetyZone zone;
+        zone.name = item["name"].asString();
+        if (item.isMember("action")) {
+            const Json::Value& action = item["action"];
+            if (!action.isString() || (action.asString() != "pause" && action.asString() != "limit_speed")) {
+                error = "区域 " + zone.name + " 的 action 应为 pause 或 limit_speed";
+                return false;
+            }
+            zone.action = action.asString() == "limit_speed" ? ZONE_ACTION_LIMIT_SPEED : ZONE_ACTION_PAUSE;
+        }
+        zone.io_indices.reserve(item["io_indices"].size());
+        for (const auto& io : item["io_indices"]) {
+            if (!io.isInt()) {
+                error = "io_indices 应为整数数组";
+                return false;
+            }
+            zone.io_indices.push_back(io.asInt());
+        }
+        if (!parse_robot_ids(item["robot_ids"], zone.robot_mask, error)) {
+            error = "区域 " + zone.name + " 参数无效: " + error;
+            return false;
+        }
+        zones.push_back(std::move(zone));
+    }
+    return validate_safety_zones(zones, error);
+}
+
+// 按主配置文件的 zones 列表装载单元: 每个单元优先读取其单元配置文件 (动作、机器人、成员 IO 与 IO 配置)，
+// 单元文件不存在时按旧格式使用列表条目中的 io_indices 与 robot_ids. 单元文件中的 IO 条目追加到 entries.
+// 单元文件无法读取或内容无效的单元名称记入 failed，由调用方另行恢复. 列表本身格式错误时返回 false.
+// 各单元之间的归属冲突由调用方以 validate_safety_zones 检查.
+static bool load_cell_zones(const Json::Value& items, std::vector<IOConfig>& entries, std::vector<SafetyZone>& zones,
+                            std::vector<std::string>& failed, std::string& error) {
+    if (!items.isArray()) {
+        error = "zones 应为数组";
+        return false;
+    }
+    zones.clear();
+    zones.reserve(items.size());
+    for (const auto& item : items) {
+        if (!item.isObject() || !item["name"].isString()) {
+            error = "区域条目应包含 name";
+            return false;
+        }
+        const std::string name = item["name"].asString();
+        const std::string path = cell_config_path(name);
+        const bool from_cell_file = fileExists(path);
+        Json::Value zone_item = item;
+        std::vector<IOConfig> cell_entries;
+        if (from_cell_file) {
+            std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+            std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            Json::CharReaderBuilder builder;
+            std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+            Json::Value cell;
+            std::string errors;
+            if (!file || !reader->parse(content.data(), content.data() + content.size(), &cell, &errors) ||
+                !cell.isObject() || !cell["cell"].isString() || cell["cell"].asString() != name || !cell["io_config"].isArray()) {
+                if(file_logger) SPDLOG_ERROR("单元 {} 的配置文件 {} 无法读取或格式错误: {}", name, path, errors.empty() ? "缺少 cell 或 io_config" : errors);
+                failed.push_back(name);
+                continue;
+            }
+            parse_io_config_items(cell["io_config"], "单元配置文件", cell_entries);
+            std::vector<int> members;
+            for (const auto& io : cell["io_indices"]) {
+                if (io.isInt()) members.push_back(io.asInt());
+            }
+            for (const auto& cfg : cell_entries) members.push_back(cfg.io_index);
+            std::sort(members.begin(), members.end());
+            members.erase(std::unique(members.begin(), members.end()), members.end());
+            zone_item = Json::Value(Json::objectValue);
+            zone_item["name"] = name;
+            if (cell.isMember("action")) zone_item["action"] = cell["action"];
+            zone_item["robot_ids"] = cell["robot_ids"];
+            zone_item["io_indices"] = Json::Value(Json::arrayValue);
+            for (int io_index : members) zone_item["io_indices"].append(io_index);
+        }
+        Json::Value one(Json::arrayValue);
+        one.append(zone_item);
+        std::vector<SafetyZone> parsed;
+        if (!parse_safety_zones(one, parsed, error)) {
+            if (!from_cell_file) {
+                return false;
+            }
+            if(file_logger) SPDLOG_ERROR("单元 {} 的配置文件 {} 内容无效: {}", name, path, error);
+            failed.push_back(name);
+            continue;
+        }
+        zones.push_back(std::move(parsed.front()));
+        entries.insert(entries.end(), std::make_move_iterator(cell_entries.begin()), std::make_move_iterator(cell_entries.end()));
+    }
+    return true;
+}
+
+// 解析去抖配置对象中的 io 数组 ({io_index, trigger_samples?, trigger_min_ms?, reset_holdoff_ms?}). 只检查类型，
+// 取值范围由 validate_debounce 检查.
+static bool parse_debounce_entries(const Json::Value& obj, IODebounceList& entries, std::string& error) {
+    const Json::Value& items = obj["io"];
+    if (!items.isArray()) {
+        error = "缺少 io 或类型错误";
+        return false;
+    }
+    entries.clear();
+    entries.reserve(items.size());
+    for (const auto& item : items) {
+        if (!item.isObject() || !item["io_index"].isInt()) {
+            error = "io 条目应包含整数 io_index";
+            return false;
+        }
+        IODebounce cfg;
+        struct { const char* key; int* field; } fields[] = {
+            {"trigger_samples", &cfg.trigger_samples},
+            {"trigger_min_ms", &cfg.trigger_min_ms},
+            {"reset_holdoff_ms", &cfg.reset_holdoff_ms},
+        };
+        for (const auto& f : fields) {
+            if (!item.isMember(f.key)) continue;
+            if (!item[f.key].isInt()) {
+                error = std::string(f.key) + " 类型错误";
+                return false;
+            }
+            *f.field = item[f.key].asInt();
+        }
+        entries.emplace_back(item["io_index"].asInt(), cfg);
+    }
+    return true;
+}
+
+// 更换受控机器人列表 (robot_ids: 1-MAX_ROBOT_ID 的整数数组)，验证后生效并保存到文件.
+// 新列表须包含全部区域 (单元) 的机器人，否则这些区域触发时停不下其机器人，拒绝请求.
+// 动作执行线程在下一次循环时按新列表同步状态表，新加入的机器人从下一动作起受控.
+static bool update_robot_config(const Json::Value& root, std::string& message) {
+    if (!root.isMember("robot_ids")) {
+        message = "缺少 robot_ids 或类型错误";
+        return false;
+    }
+    uint32_t mask = 0;
+    std::string error;
+    if (!parse_robot_ids(root["robot_ids"], mask, error)) {
+        if(file_logger) SPDLOG_WARN("更新受控机器人: 参数无效: {}", error);
+        message = "参数无效: " + error;
+        return false;
+    }
+
+    ProfiledLock lock(io_mutex, LOCK_SITE_ROBOT_CONFIG);
+    if (!check_zone_robots_handled(*safety_zones, mask, error)) {
+        lock.unlock();
+        if(file_logger) SPDLOG_WARN("更新受控机器人: 参数无效: {}", error);
+        message = "参数无效: " + error + "，请先修改该区域的机器人或移除该单元";
+        return false;
+    }
+    set_handled_robots(mask);
+    publish_status_snapshot();
+    if(file_logger) SPDLOG_INFO("受控机器人已更新: 掩码 {:#x}, 共 {} 台", mask, __builtin_popcount(mask));
+    lock.unlock();
+
+    wake_monitor_thread(); // 立即按新的机器人集合调和受限机器人
+    request_config_save();
+    message = "受控机器人已更新";
+    return true;
+}
+
+// 替换全部安全区域 (单元) 定义 (zones: [{name, io_indices, robot_ids, action}]，空数组表示不分区)，验证后生效并保存到文件.
+// action 可选 "pause" (缺省) 或 "limit_speed". 同名单元沿用原实例，IO 条目本身不变，保存时按新归属写入各单元配置文件.
+// 区域的机器人须都在受控机器人列表中 (否则区域触发时停不下这些机器人)，不满足时拒绝.
+// 已触发 IO 的区域归属变化时，监测线程在下一周期按新归属暂停/恢复受影响的机器人.
+static bool update_zone_config(const Json::Value& root, std::string& message) {
+    if (!root.isMember("zones") || !root["zones"].isArray()) {
+        message = "缺少 zones 或类型错误";
+        return false;
+    }
+    std::vector<SafetyZone> zones;
+    std::string error;
+    if (!parse_safety_zones(root["zones"], zones, error)) {
+        if(file_logger) SPDLOG_WARN("更新安全区域: 参数无效: {}", error);
+        message = "参数无效: " + error;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> update_lock(config_update_mutex);
+    bind_cell_instances(zones);
+    ProfiledLock lock(io_mutex, LOCK_SITE_ZONE_CONFIG);
+    if (!check_zone_robots_handled(zones, handled_robot_mask.load(), error)) {
+        lock.unlock();
+        if(file_logger) SPDLOG_WARN("更新安全区域: 参数无效: {}", error);
+        message = "参数无效: " + error + "，请先用 set_robot_config 加入";
+        return false;
+    }
+    size_t zone_count = zones.size();
+    install_safety_zones(std::move(zones));
+    publish_status_snapshot();
+    if(file_logger) SPDLOG_INFO("安全区域已更新: 共 {} 个", zone_count);
+    lock.unlock();
+
+    wake_monitor_thread(); // 立即按新归属调和受限机器人
+    request_config_save();
+    message = "安全区域已更新";
+    return true;
+}
+
+// 更换单元 cell 的受控机器人 (robot_ids)，其他单元不变. 单元的机器人同时加入进程的受控列表，
+// 保证单元 IO 触发时其机器人一定受控. 验证后生效并保存到文件.
+static bool update_cell_robots(const std::string& cell, const Json::Value& root, std::string& message) {
+    if (!root.isMember("robot_ids")) {
+        message = "缺少 robot_ids 或类型错误";
+        return false;
+    }
+    uint32_t mask = 0;
+    std::string error;
+    if (!parse_robot_ids(root["robot_ids"], mask, error)) {
+        message = "参数无效: " + error;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> update_lock(config_update_mutex);
+    std::vector<SafetyZone> zones = *safety_zones;
+    int z = find_zone(zones, cell);
+    if (z < 0) {
+        message = "单元 " + cell + " 不存在";
+        return false;
+    }
+    zones[z].robot_mask = mask;
+    const std::shared_ptr<const RasterSafetyInstance> instance = zones[z].instance;
+
+    ProfiledLock lock(io_mutex, LOCK_SITE_CELL_CONFIG);
+    const uint32_t handled = handled_robot_mask.load();
+    if ((handled & mask) != mask) {
+        set_handled_robots(handled | mask);
+    }
+    install_safety_zones(std::move(zones));
+    publish_status_snapshot();
+    lock.unlock();
+
+    if(file_logger) SPDLOG_INFO("单元 {} 的机器人已更新: 掩码 {:#x}", cell, mask);
+    if (instance && instance->logger) instance->logger->info("单元机器人已更新: 掩码 {:#x}", mask);
+    wake_monitor_thread(); // 立即按新的机器人集合调和受限机器人
+    request_config_save();
+    message = "单元 " + cell + " 的机器人已更新";
+    return true;
+}
+
+// 新建单元 (cell, robot_ids, action 可选)，IO 列表为空，随后以带 cell 的 update_config / add_io 配置其 IO.
+// 其他单元不变. 单元的机器人同时加入进程的受控列表.
+static bool add_cell(const Json::Value& root, std::string& message) {
+    if (!root["cell"].isString() || root["cell"].asString().empty() || !root.isMember("robot_ids")) {
+        message = "缺少 cell 或 robot_ids";
+        return false;
+    }
+    SafetyZone zone;
+    zone.name = root["cell"].asString();
+    std::string error;
+    if (!parse_robot_ids(root["robot_ids"], zone.robot_mask, error)) {
+        message = "参数无效: " + error;
+        return false;
+    }
+    if (root.isMember("action")) {
+        const Json::Value& action = root["action"];
+        if (!action.isString() || (action.asString() != "pause" && action.asString() != "limit_speed")) {
+            message = "action 应为 pause 或 limit_speed";
+            return false;
+        }
+        zone.action = action.asString() == "limit_speed" ? ZONE_ACTION_LIMIT_SPEED : ZONE_ACTION_PAUSE;
+    }
+
+    std::lock_guard<std::mutex> update_lock(config_update_mutex);
+    std::vector<SafetyZone> zones = *safety_zones;
+    if (find_zone(zones, zone.name) >= 0) {
+        message = "单元 " + zone.name + " 已存在";
+        return false;
+    }
+    const uint32_t mask = zone.robot_mask;
+    zones.push_back(std::move(zone));
+    if (!validate_safety_zones(zones, error)) {
+        message = "参数无效: " + error;
+        return false;
+    }
+    bind_cell_instances(zones);
+    const std::shared_ptr<const RasterSafetyInstance> instance = zones.back().instance;
+
+    ProfiledLock lock(io_mutex, LOCK_SITE_CELL_CONFIG);
+    const uint32_t handled = handled_robot_mask.load();
+    if ((handled & mask) != mask) {
+        set_handled_robots(handled | mask);
+    }
+    install_safety_zones(std::move(zones));
+    publish_status_snapshot();
+    lock.unlock();
+
+    if(file_logger) SPDLOG_INFO("单元 {} 已创建: 机器人掩码 {:#x}, 配置文件 {}", instance->cell_id, mask, instance->config_file);
+    if (instance->logger) instance->logger->info("单元已创建: 机器人掩码 {:#x}", mask);
+    request_config_save();
+    message = "单元 " + instance->cell_id + " 已创建";
+    return true;
+}
+
+// 移除单元 cell 及其全部 IO 配置，其他单元不变. 与单元 IO 修改一样经配置切换路径同时安装新的 IO 表与区域定义.
+// 单元的机器人仍留在进程的受控列表中. 单元配置文件不再被引用，保留在磁盘上.
+static bool remove_cell(const std::string& cell, std::string& message) {
+    std::lock_guard<std::mutex> update_lock(config_update_mutex);
+    std::shared_ptr<const SafetyStatusSnapshot> snap = load_status_snapshot();
+    if (!snap) {
+        message = "服务未初始化";
+        return false;
+    }
+    std::vector<SafetyZone> zones = *safety_zones;
+    int z = find_zone(zones, cell);
+    if (z < 0) {
+        message = "单元 " + cell + " 不存在";
+        return false;
+    }
+    std::vector<bool> in_cell(2049, false);
+    for (int io_index : zones[z].io_indices) in_cell[io_index] = true;
+    std::vector<IOConfig> entries;
+    entries.reserve(snap->io_states.size());
+    int removed = 0;
+    for (const auto& io : snap->io_states) {
+        if (in_cell[io.io_index]) {
+            if (io.already_triggered) {
+                if(file_logger) SPDLOG_WARN("[单元] 移除的单元 {} 的 IO {} 当前处于已触发状态，其触发标志随配置一同移除.", cell, io.io_index);
+            }
+            removed++;
+            continue;
+        }
+        IOConfig cfg(io.io_index, io.reset_io_index, io.trigger_value, status_description(*snap, io));
+        cfg.is_configured = true;
+        entries.push_back(std::move(cfg));
+    }
+    const std::shared_ptr<const RasterSafetyInstance> instance = zones[z].instance;
+    zones.erase(zones.begin() + z);
+
+    std::shared_ptr<PendingIOConfig> pending = std::make_shared<PendingIOConfig>();
+    pending->limited_speed = snap->limited_speed;
+    pending->replace_zones = true;
+    pending->zones = std::move(zones);
+    assign_io_entries(pending->table, std::move(entries));
+    submit_io_config(pending, LOCK_SITE_CELL_CONFIG);
+
+    if(file_logger) SPDLOG_INFO("单元 {} 已移除 (含 {} 个 IO).", cell, removed);
+    if (instance && instance->logger) instance->logger->info("单元已移除 (含 {} 个 IO).", removed);
+    request_config_save();
+    message = "单元 " + cell + " 已移除";
+    return true;
+}
+
+// 替换全部 IO 去抖配置 (io: [{io_index, trigger_samples, trigger_min_ms, reset_holdoff_ms}]，空数组表示不滤波;
+// max_delay_ms 可选，缺省保持当前值)，验证后生效并保存到文件. 正在滤波中的状态随之清空.
+static bool update_debounce_config(const Json::Value& root, std::string& message) {
+    if (root.isMember("max_delay_ms") && !root["max_delay_ms"].isInt()) {
+        message = "max_delay_ms 类型错误";
+        return false;
+    }
+    IODebounceList entries;
+    if (!parse_debounce_entries(root, entries, message)) {
+        return false;
+    }
+
+    ProfiledLock lock(io_mutex, LOCK_SITE_DEBOUNCE_CONFIG);
+    int max_delay_ms = root.isMember("max_delay_ms") ? root["max_delay_ms"].asInt() : debounce_max_delay_ms;
+    std::string error;
+    if (!validate_debounce(entries, max_delay_ms, error)) {
+        if(file_logger) SPDLOG_WARN("更新 IO 去抖配置: 参数无效: {}", error);
+        message = "参数无效: " + error;
+        return false;
+    }
+    install_debounce(entries, max_delay_ms);
+    publish_status_snapshot();
+    if(file_logger) SPDLOG_INFO("IO 去抖配置已更新: {} 个 IO, 触发延迟上界 {}ms", entries.size(), max_delay_ms);
+    lock.unlock();
+
+    request_config_save();
+    message = "IO 去抖配置已更新";
+    return true;
+}
+
+// 将调度设置应用到调用线程 (监测线程). 失败 (通常是缺少 CAP_SYS_NICE / CAP_IPC_LOCK 权限) 只记录日志.
+static void apply_monitor_thread_settings(const MonitorSettings& settings) {
+    struct sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    int policy = SCHED_OTHER;
+    if (settings.rt_priority > 0) {
+        policy = SCHED_FIFO;
+        param.sched_priority = settings.rt_priority;
+    }
+    int ret = pthread_setschedparam(pthread_self(), policy, &param);
+    if (ret != 0) {
+        if(file_logger) SPDLOG_WARN("设置监测线程调度策略失败 (优先级 {}): {}", settings.rt_priority, strerror(ret));
+    } else {
+        if(file_logger) SPDLOG_INFO("监测线程调度策略: {}, 优先级 {}", settings.rt_priority > 0 ? "SCHED_FIFO" : "SCHED_OTHER", settings.rt_priority);
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (settings.cpu_core >= 0) {
+        CPU_SET(settings.cpu_core, &cpus);
+    } else {
+        long cpu_count = sysconf(_SC_NPROCESSORS_CONF);
+        for (long i = 0; i < cpu_count && i < CPU_SETSIZE; ++i) CPU_SET(i, &cpus);
+    }
+    ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (ret != 0) {
+        if(file_logger) SPDLOG_WARN("设置监测线程 CPU 绑定失败 (CPU {}): {}", settings.cpu_core, strerror(ret));
+    } else if (settings.cpu_core >= 0) {
+        if(file_logger) SPDLOG_INFO("监测线程已绑定到 CPU {}", settings.cpu_core);
+    }
+
+    static bool memory_locked = false; // 仅由监测线程访问
+    if (settings.lock_memory && !memory_locked) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            if(file_logger) SPDLOG_WARN("锁定进程内存失败: {}", strerror(errno));
+        } else {
+            memory_locked = true;
+            if(file_logger) SPDLOG_INFO("进程内存已锁定 (mlockall).");
+        }
+    } else if (!settings.lock_memory && memory_locked) {
+        munlockall(); // 只解除由本模块设置的锁定
+        memory_locked = false;
+        if(file_logger) SPDLOG_INFO("进程内存锁定已解除.");
+    }
+}
+
+// 唤醒监测线程立即开始下一周期. 不可在信号处理函数中调用.
+static void wake_monitor_thread() {
+    {
+        std::lock_guard<std::mutex> lock(monitor_wait_mutex);
+        io_change_pending = true;
+    }
+    monitor_cv.notify_one();
+}
+
+// 投递动作命令到动作执行线程. 可在持有 io_mutex 时调用 (只短暂获取 action_mutex).
+// 新的暂停/限速命令会从尚未开始执行的对应解除命令 (恢复/恢复倍率) 中去掉其机器人，并排在所有尚未执行的
+// 解除命令之前 (两者机器人不相交，顺序不影响结果，其他区域的解除不会推迟限制); 相邻的同类型命令合并机器人集合.
+static void post_action(ActionType type, bool announce,
+                        std::chrono::steady_clock::time_point observed_at,
+                        std::chrono::steady_clock::time_point decided_at, int cause_io, uint32_t robot_mask,
+                        int speed_percent) {
+    {
+        std::lock_guard<std::mutex> lock(action_mutex);
+        auto pos = action_queue.end();
+        if (type == ACTION_PAUSE || type == ACTION_LIMIT_SPEED) {
+            const ActionType release = (type == ACTION_PAUSE) ? ACTION_RESUME : ACTION_RESTORE_SPEED;
+            for (auto it = action_queue.begin(); it != action_queue.end();) {
+                if (it->type == release) {
+                    it->robot_mask &= ~robot_mask;
+                    if (it->robot_mask == 0) {
+                        it = action_queue.erase(it);
+                        continue;
+                    }
+                }
+                ++it;
+            }
+            pos = std::find_if(action_queue.begin(), action_queue.end(), [](const ActionCommand& c) {
+                return c.type == ACTION_RESUME || c.type == ACTION_RESTORE_SPEED;
+            });
+        }
+        if (pos != action_queue.begin() && std::prev(pos)->type == type) {
+            std::prev(pos)->robot_mask |= robot_mask;
+            std::prev(pos)->announce |= announce;
+            std::prev(pos)->speed_percent = speed_percent; // 以最新限速值为准
+            return;
+        }
+        action_queue.insert(pos, ActionCommand{type, announce, observed_at, decided_at, cause_io, robot_mask, speed_percent});
+    }
+    action_cv.notify_one();
+}
+
+// 把通知消息格式化到 report_text，并写入复用容量的 report_message 返回 (下一次调用前有效).
+// 在动作执行线程中调用.
+static const std::string& format_report(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int len = std::vsnprintf(report_text, REPORT_MESSAGE_MAX, format, args);
+    va_end(args);
+    report_message.assign(report_text, std::min<size_t>(len < 0 ? 0 : len, REPORT_MESSAGE_MAX - 1));
+    return report_message;
+}
+
+// 发送系统级别的安全触发通知 (首次进入此状态周期时). 在动作执行线程中调用.
+static void announce_limited_state(const ActionCommand& cmd) {
+    if (cmd.announce && !limited_state_message_sent_this_cycle.load()) {
+        const std::string& msg = format_report("光栅安全：检测到安全区域侵犯，系统进入安全受限状态！");
+        controller().error_report(1, msg); // 使用警告级别 1
+        if(file_logger) SPDLOG_WARN("{}", msg);
+        limited_state_message_sent_this_cycle.store(true); // 标记已发送
+        normal_state_message_sent_this_cycle.store(false); // 重置另一状态的标志
+    }
+    // 重置本次涉及机器人的恢复消息标志
+    for (uint32_t bits = cmd.robot_mask; bits != 0; bits &= bits - 1) {
+       getRobotState(__builtin_ctz(bits)).message_sent_recovered = false;
+    }
+}
+
+// 发送系统级别的安全解除通知 (首次进入此状态周期时; 其他区域仍受限时不发送). 在动作执行线程中调用.
+static void announce_normal_state(const ActionCommand& cmd) {
+    if (cmd.announce && current_system_state.load(std::memory_order_acquire) == SYSTEM_STATE_NORMAL &&
+        !normal_state_message_sent_this_cycle.load()) {
+         const std::string& msg = format_report("光栅安全：安全条件解除，系统恢复正常状态。");
+         controller().error_report(0, msg); // 使用信息级别 0
+         if(file_logger) SPDLOG_INFO("{}", msg);
+         normal_state_message_sent_this_cycle.store(true); // 标记已发送
+         limited_state_message_sent_this_cycle.store(false); // 重置另一状态的标志
+    }
+    // 重置本次涉及机器人的暂停消息标志
+    for (uint32_t bits = cmd.robot_mask; bits != 0; bits &= bits - 1) {
+       getRobotState(__builtin_ctz(bits)).message_sent_limited = false;
+    }
+}
+
+// 执行一个动作命令. 在动作执行线程中调用.
+static void execute_action(const ActionCommand& cmd) {
+    if (cmd.type == ACTION_PAUSE || cmd.type == ACTION_LIMIT_SPEED) {
+        // 转换为 LIMITED 的动作和通知
+        announce_limited_state(cmd);
+        record_latency(safety_metrics.trip_queue_delay, std::chrono::steady_clock::now() - cmd.decided_at);
+        if (cmd.type == ACTION_PAUSE) {
+            pause_robots(cmd);
+        } else {
+            limit_robot_speeds(cmd);
+        }
+        return;
+    }
+
+    // ACTION_RESUME / ACTION_RESTORE_SPEED
+    // 命令排队期间这些机器人可能已重新被限制，跳过这部分，随后的暂停/限速命令会处理
+    ActionCommand release = cmd;
+    release.robot_mask &= ~(cmd.type == ACTION_RESUME ? limited_robot_mask.load() : speed_limited_robot_mask.load());
+    if (release.robot_mask == 0) {
+        if(file_logger) SPDLOG_INFO("[动作] 待解除的机器人已重新被安全限制，跳过过期的解除命令.");
+        return;
+    }
+    // 转换为 NORMAL 的动作和通知
+    announce_normal_state(release);
+    if (cmd.type == ACTION_RESUME) {
+        resume_robots(release);
+    } else {
+        restore_robot_speeds(release);
+    }
+}
+
+// 预取运行中机器人的当前打开作业名，供暂停路径直接使用 (触发时省去一次控制器往返).
+// 运行状态变化的机器人立即刷新，periodic 时刷新全部运行中的机器人; 未运行的机器人清空预取值.
+// 只在动作执行线程中调用.
+static void refresh_job_names(bool periodic) {
+    const uint32_t changed = run_status_changed_mask.exchange(0);
+    for (uint32_t bits = robot_table_mask; bits != 0; bits &= bits - 1) {
+        int id = __builtin_ctz(bits);
+        auto& state = robot_table[id];
+        if (observed_run_status[id].load(std::memory_order_relaxed) != 2) {
+            state.cached_job_name.clear();
+            continue;
+        }
+        if (!periodic && (changed & (1u << id)) == 0) {
+            continue;
+        }
+        state.cached_job_name.clear();
+        int get_job_ret = controller().get_open_job(id, state.cached_job_name);
+        if (get_job_ret != 0) {
+            state.cached_job_name.clear();
+            if(file_logger) SPDLOG_DEBUG("预取机械臂 {} 作业名失败. NRC_GetCurrentOpenJob 返回 {}", id, get_job_ret);
+        }
+    }
+}
+
+// 提示运行状态刷新线程立即按快速周期轮询. 不可在持有其他锁时调用.
+static void kick_run_status_refresh() {
+    {
+        std::lock_guard<std::mutex> lock(run_status_mutex);
+        run_status_kicked = true;
+    }
+    run_status_cv.notify_one();
+}
+
+// 运行状态刷新线程: 批量查询受控机器人的运行状态并发布到 observed_run_status，状态变化的机器人交给
+// 动作执行线程重新预取作业名. 查询期间不持有任何锁，不参与 IO 评估.
+static void run_status_thread_func() {
+    struct sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    int ret = pthread_setschedparam(pthread_self(), SCHED_BATCH, &param);
+    if (ret != 0) {
+        if(file_logger) SPDLOG_WARN("设置运行状态刷新线程调度策略失败: {}", strerror(ret));
+    }
+    if(file_logger) SPDLOG_INFO("[光栅安全控制] 运行状态刷新线程启动!");
+
+    int poll_ms = RUN_STATUS_FAST_MS;
+    std::unique_lock<std::mutex> lock(run_status_mutex);
+    while (run_status_running) {
+        if (run_status_kicked) {
+            run_status_kicked = false;
+            poll_ms = RUN_STATUS_FAST_MS;
+        }
+        lock.unlock();
+
+        uint32_t changed = 0;
+        for (uint32_t bits = handled_robot_mask.load(); bits != 0; bits &= bits - 1) {
+            int id = __builtin_ctz(bits);
+            const int64_t issued_ns = steady_now_ns();
+            int status = controller().get_run_status(id);
+            if (observed_run_status[id].exchange(status, std::memory_order_relaxed) != status) {
+                changed |= 1u << id;
+            }
+            observed_run_status_ns[id].store(issued_ns, std::memory_order_release);
+        }
+        if (changed != 0) {
+            run_status_changed_mask.fetch_or(changed);
+            {
+                std::lock_guard<std::mutex> action_lock(action_mutex); // 与执行线程的等待判定串行，避免丢失唤醒
+            }
+            action_cv.notify_one();
+            poll_ms = RUN_STATUS_FAST_MS;
+        } else {
+            poll_ms = std::min(poll_ms * 2, RUN_STATUS_SLOW_MS);
+        }
+
+        lock.lock();
+        run_status_cv.wait_for(lock, std::chrono::milliseconds(poll_ms), [] { return !run_status_running || run_status_kicked; });
+    }
+    if(file_logger) SPDLOG_INFO("[光栅安全控制] 运行状态刷新线程退出!");
+}
+
+// 动作执行线程: 按顺序执行队列中的命令. 停止时先执行完已排队的命令再退出.
+static void action_executor_thread() {
+    if(file_logger) SPDLOG_INFO("[光栅安全控制] 动作执行线程启动!");
+    report_message.reserve(REPORT_MESSAGE_MAX);
+
+    auto next_job_refresh = std::chrono::steady_clock::now();
+    while (true) {
+        ActionCommand cmd;
+        bool have_cmd = false;
+        bool periodic_refresh = false;
+        {
+            std::unique_lock<std::mutex> lock(action_mutex);
+            periodic_refresh = !action_cv.wait_until(lock, next_job_refresh, [] {
+                return !action_queue.empty() || !action_thread_running || handled_robot_mask.load() != robot_table_mask ||
+                       run_status_changed_mask.load() != 0;
+            });
+            if (!action_queue.empty()) {
+                cmd = action_queue.front();
+                action_queue.erase(action_queue.begin());
+                have_cmd = true;
+            } else if (!action_thread_running) {
+                break; // 已请求停止且队列已清空
+            }
+        }
+
+        // 状态表只在本线程访问，执行动作不持有任何锁，不阻塞 IO 评估与配置修改
+        sync_robot_table();
+        if (have_cmd) {
+            execute_action(cmd);
+            kick_run_status_refresh(); // 暂停/恢复后机器人状态正在转换
+        } else {
+            // 作业名预取只在空闲时进行，不推迟排队中的动作
+            refresh_job_names(periodic_refresh);
+            if (periodic_refresh) {
+                next_job_refresh = std::chrono::steady_clock::now() + std::chrono::milliseconds(JOB_NAME_REFRESH_MS);
+            }
+        }
+    }
+
+    if(file_logger) SPDLOG_INFO("[光栅安全控制] 动作执行线程退出!");
+}
+
+// --- 对外接口实现 ---
+
+// 对外函数: IO 变化通知. 控制器支持 TCP 布尔变量变化回调时，在回调中调用此函数，
+// 监测线程会立即重新评估所有已配置 IO. 需在配置中启用 io_event_mode 才能避免空闲轮询.
+void rasterSafetyNotifyIOChange() {
+    wake_monitor_thread();
+}
+
+// 对外函数: 注册速度倍率接口. 注册后限速区域受限时调用 handler(机器人ID, 倍率%) 限速，
+// 解除时调用 handler(机器人ID, -1) 恢复限速前的倍率; 返回 0 表示成功. 监测线程在下一周期按新的可用性调和.
+void rasterSafetySetSpeedOverrideHandler(int (*handler)(int robot_id, int percent)) {
+    speed_override_handler.store(handler);
+    if(file_logger) SPDLOG_INFO("速度倍率接口已{}.", handler ? "注册" : "取消注册");
+    wake_monitor_thread();
+}
+
+// 对外函数: 替换控制器后端. backend 须在被替换回去之前保持有效; 传入 nullptr 恢复 NRC 缺省后端.
+// 监测线程下一周期起使用新后端读取 IO，已在执行中的动作用完旧后端后切换.
+void rasterSafetySetBackend(const RasterSafetyBackend* backend) {
+    controller_backend.store(backend ? backend : &nrc_backend, std::memory_order_release);
+    if(file_logger) SPDLOG_INFO("控制器后端已切换为{}.", backend ? "外部后端" : "NRC 接口");
+    wake_monitor_thread();
+}
+
+// --- 仿真控制器 ---
+
+// 模拟控制器调用耗时. 不持有仿真锁，多个调用方的耗时可以重叠 (与真实控制器的并发调用一致).
+static void sim_call_delay() {
+    int us = sim_controller.call_latency_us.load(std::memory_order_relaxed);
+    if (us > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+}
+
+// 已到期的状态转换生效. 调用者持有 sim_controller.mutex.
+static void sim_advance_robot(SimRobot& robot, std::chrono::steady_clock::time_point now) {
+    if (robot.pending_status >= 0 && now >= robot.transition_at) {
+        robot.status = robot.pending_status;
+        robot.pending_status = -1;
+    }
+}
+
+// 计数一个暂停/恢复命令，返回是否按 fail_every 注入失败. 调用者持有 sim_controller.mutex.
+static bool sim_command_fails() {
+    sim_controller.commands++;
+    return sim_controller.fail_every > 0 && sim_controller.commands % sim_controller.fail_every == 0;
+}
+
+static bool sim_read_io(int io_index) {
+    if (io_index < 0 || io_index > 2048) {
+        return false;
+    }
+    const SimIOWave& wave = sim_controller.io[io_index];
+    bool level = wave.level.load(std::memory_order_relaxed);
+    int pulse_ms = wave.pulse_ms.load(std::memory_order_relaxed);
+    if (pulse_ms <= 0) {
+        return level;
+    }
+    int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t t_ms = (now_ns - sim_controller.epoch_ns.load(std::memory_order_relaxed)) / 1000000 -
+                   wave.phase_ms.load(std::memory_order_relaxed);
+    if (t_ms < 0) {
+        return level;
+    }
+    int period_ms = wave.period_ms.load(std::memory_order_relaxed);
+    if (period_ms > 0) {
+        t_ms %= period_ms;
+    }
+    return t_ms < pulse_ms ? !level : level;
+}
+
+static int sim_get_run_status(int robot_id) {
+    sim_call_delay();
+    std::lock_guard<std::mutex> lock(sim_controller.mutex);
+    if (robot_id < 0 || robot_id > MAX_ROBOT_ID || !sim_controller.robots[robot_id].present) {
+        return -1;
+    }
+    SimRobot& robot = sim_controller.robots[robot_id];
+    sim_advance_robot(robot, std::chrono::steady_clock::now());
+    return robot.status;
+}
+
+static int sim_get_open_job(int robot_id, std::string& job_name) {
+    sim_call_delay();
+    std::lock_guard<std::mutex> lock(sim_controller.mutex);
+    if (robot_id < 0 || robot_id > MAX_ROBOT_ID || !sim_controller.robots[robot_id].present) {
+        return -1;
+    }
+    if (sim_controller.job_ret != 0) {
+        return sim_controller.job_ret;
+    }
+    job_name.assign(sim_controller.robots[robot_id].job);
+    return 0;
+}
+
+static int sim_pause_job(int robot_id) {
+    sim_call_delay();
+    std::lock_guard<std::mutex> lock(sim_controller.mutex);
+    if (robot_id < 0 || robot_id > MAX_ROBOT_ID || !sim_controller.robots[robot_id].present) {
+        return -1;
+    }
+    if (sim_command_fails()) {
+        return -1;
+    }
+    SimRobot& robot = sim_controller.robots[robot_id];
+    auto now = std::chrono::steady_clock::now();
+    sim_advance_robot(robot, now);
+    if (robot.status == 2 && !sim_controller.pause_ignored) {
+        robot.pending_status = 1;
+        robot.transition_at = now + std::chrono::milliseconds(sim_controller.pause_latency_ms);
+    }
+    return 0;
+}
+
+// 与 NRC_StartRunJobfile 一样按作业名恢复: 作业名匹配且处于暂停的机器人全部恢复运行.
+static int sim_start_job(const char* job_name) {
+    sim_call_delay();
+    std::lock_guard<std::mutex> lock(sim_controller.mutex);
+    if (sim_command_fails()) {
+        return -1;
+    }
+    auto now = std::chrono::steady_clock::now();
+    bool found = false;
+    for (auto& robot : sim_controller.robots) {
+        if (!robot.present || robot.job != job_name) continue;
+        found = true;
+        sim_advance_robot(robot, now);
+        if (robot.status == 1 && !sim_controller.resume_ignored) {
+            robot.pending_status = 2;
+            robot.transition_at = now + std::chrono::milliseconds(sim_controller.resume_latency_ms);
+        }
+    }
+    return found ? 0 : -1;
+}
+
+static void sim_error_report(int level, const std::string& message) {
+    {
+        std::lock_guard<std::mutex> lock(sim_controller.mutex);
+        sim_controller.reports++;
+    }
+    if(file_logger) SPDLOG_INFO("[仿真] 控制器通知 (级别 {}): {}", level, message);
+}
+
+static const RasterSafetyBackend sim_backend = {
+    sim_read_io, sim_get_run_status, sim_get_open_job, sim_pause_job, sim_start_job, sim_error_report
+};
+
+// 对外函数: 安装仿真控制器后端. 可在服务启动前或运行中调用 (重新调用即重置仿真，时间起点归零). config:
+//   io: [{io_index, level (bool), pulse_ms, period_ms, phase_ms}] - 未列出的 IO 恒为 false
+//   robots: [{robot_id, status (0-2), job}] - 缺省为当前受控机器人全部运行，作业名 sim_job_<id>
+//   pause_latency_ms / resume_latency_ms (0-10000, 缺省 30), call_latency_us (0-1000000)
+//   故障模式: fail_every (每第 N 个暂停/恢复命令失败), job_ret, pause_ignored, resume_ignored
+// 任一字段无效时返回 false 并设置 error，不改变当前后端.
+bool rasterSafetyStartSimulation(const Json::Value& config, std::string& error) {
+    if (!config.isObject()) {
+        error = "仿真配置必须是对象";
+        return false;
+    }
+    const int pause_latency_ms = json_int(config, "pause_latency_ms", 30);
+    const int resume_latency_ms = json_int(config, "resume_latency_ms", 30);
+    const int call_latency_us = json_int(config, "call_latency_us", 0);
+    const int fail_every = json_int(config, "fail_every", 0);
+    if (pause_latency_ms < 0 || pause_latency_ms > 10000 || resume_latency_ms < 0 || resume_latency_ms > 10000) {
+        error = "pause_latency_ms / resume_latency_ms 超出 0-10000 范围";
+        return false;
+    }
+    if (call_latency_us < 0 || call_latency_us > 1000000 || fail_every < 0) {
+        error = "call_latency_us 超出 0-1000000 范围或 fail_every 为负";
+        return false;
+    }
+
+    struct WaveSpec { int io_index; bool level; int pulse_ms; int period_ms; int phase_ms; };
+    std::vector<WaveSpec> waves;
+    const Json::Value& io_items = config["io"];
+    if (!io_items.isNull() && !io_items.isArray()) {
+        error = "io 必须是数组";
+        return false;
+    }
+    for (const auto& item : io_items) {
+        WaveSpec w = {json_int(item, "io_index", -1), item["level"].isBool() && item["level"].asBool(),
+                      json_int(item, "pulse_ms", 0), json_int(item, "period_ms", 0), json_int(item, "phase_ms", 0)};
+        if (w.io_index < 0 || w.io_index > 2048 || w.pulse_ms < 0 || w.period_ms < 0 || w.phase_ms < 0) {
+            error = "io 条目无效 (io_index 须在 0-2048，pulse_ms/period_ms/phase_ms 不能为负)";
+            return false;
+        }
+        waves.push_back(w);
+    }
+
+    SimRobot robots[MAX_ROBOT_ID + 1];
+    const Json::Value& robot_items = config["robots"];
+    if (!robot_items.isNull() && !robot_items.isArray()) {
+        error = "robots 必须是数组";
+        return false;
+    }
+    if (robot_items.empty()) {
+        for (uint32_t bits = handled_robot_mask.load(); bits != 0; bits &= bits - 1) {
+            int id = __builtin_ctz(bits);
+            robots[id].present = true;
+            robots[id].status = 2;
+            robots[id].job = "sim_job_" + std::to_string(id);
+        }
+    }
+    for (const auto& item : robot_items) {
+        int id = json_int(item, "robot_id", -1);
+        int status = json_int(item, "status", 2);
+        if (id < 1 || id > MAX_ROBOT_ID || status < 0 || status > 2) {
+            error = "robots 条目无效 (robot_id 须在 1-" + std::to_string(MAX_ROBOT_ID) + "，status 须在 0-2)";
+            return false;
+        }
+        robots[id].present = true;
+        robots[id].status = status;
+        robots[id].job = item["job"].isString() ? item["job"].asString() : "sim_job_" + std::to_string(id);
+    }
+
+    for (auto& wave : sim_controller.io) {
+        wave.pulse_ms.store(0, std::memory_order_relaxed);
+        wave.level.store(false, std::memory_order_relaxed);
+    }
+    for (const auto& w : waves) {
+        SimIOWave& wave = sim_controller.io[w.io_index];
+        wave.level.store(w.level, std::memory_order_relaxed);
+        wave.period_ms.store(w.period_ms, std::memory_order_relaxed);
+        wave.phase_ms.store(w.phase_ms, std::memory_order_relaxed);
+        wave.pulse_ms.store(w.pulse_ms, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(sim_controller.mutex);
+        std::copy(std::begin(robots), std::end(robots), std::begin(sim_controller.robots));
+        sim_controller.pause_latency_ms = pause_latency_ms;
+        sim_controller.resume_latency_ms = resume_latency_ms;
+        sim_controller.fail_every = fail_every;
+        sim_controller.job_ret = json_int(config, "job_ret", 0);
+        sim_controller.pause_ignored = config["pause_ignored"].isBool() && config["pause_ignored"].asBool();
+        sim_controller.resume_ignored = config["resume_ignored"].isBool() && config["resume_ignored"].asBool();
+        sim_controller.commands = 0;
+        sim_controller.reports = 0;
+    }
+    sim_controller.call_latency_us.store(call_latency_us, std::memory_order_relaxed);
+    sim_controller.epoch_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+    sim_controller.active.store(true);
+    if(file_logger) SPDLOG_WARN("[仿真] 已安装仿真控制器: {} 个 IO 波形, 暂停/恢复延迟 {}/{}ms, 调用耗时 {}us, fail_every {}.",
+                                waves.size(), pause_latency_ms, resume_latency_ms, call_latency_us, fail_every);
+    rasterSafetySetBackend(&sim_backend);
+    return true;
+}
+
+// 对外函数: 设置仿真 IO 的静态电平 (脉冲仍叠加在其上)，并像控制器变化回调一样唤醒监测线程.
+void rasterSafetySimSetIO(int io_index, bool level) {
+    if (io_index < 0 || io_index > 2048) {
+        if(file_logger) SPDLOG_WARN("[仿真] 无效的 IO 号 {}", io_index);
+        return;
+    }
+    sim_controller.io[io_index].level.store(level, std::memory_order_relaxed);
+    wake_monitor_thread();
+}
+
+// 对外函数: 卸载仿真控制器，恢复 NRC 缺省后端.
+void rasterSafetyStopSimulation() {
+    if (!sim_controller.active.exchange(false)) {
+        return;
+    }
+    rasterSafetySetBackend(nullptr);
+    std::lock_guard<std::mutex> lock(sim_controller.mutex);
+    if(file_logger) SPDLOG_WARN("[仿真] 仿真控制器已卸载 (共 {} 个暂停/恢复命令, {} 条通知).",
+                                sim_controller.commands, sim_controller.reports);
+}
+
+// 验证输入的 IO 配置并追加到 entries: IO 号或复位 IO 号超出 0-2048 的条目跳过，无效的触发值改为 1.
+// 新条目的触发状态清零，安装时由 install_io_config 继承未变化条目的触发状态.
+static void build_io_entries(const std::vector<IOConfig>& config, std::vector<IOConfig>& entries) {
+    entries.reserve(entries.size() + config.size());
+    for (const auto& cfg_in : config) {
+        // 检查 IO 索引有效性
+        if (cfg_in.io_index >= 0 && cfg_in.io_index <= 2048) {
+            // 确保复位 IO 索引也有效或为 0
+            if (cfg_in.reset_io_index >= 0 && cfg_in.reset_io_index <= 2048) {
+                 // 创建新的 IOConfig 对象基于输入，但状态重置
+                 IOConfig cfg_new;
+                 cfg_new.io_index = cfg_in.io_index;
+                 cfg_new.reset_io_index = cfg_in.reset_io_index;
+                 cfg_new.trigger_value = cfg_in.trigger_value; // 存储 0 或 1
+                 cfg_new.description = cfg_in.description;
+                 cfg_new.is_configured = true; // 标记为已配置
+                 cfg_new.already_triggered = false; // 安装时由 install_io_config 继承未变化条目的触发状态
+                 cfg_new.trigger_time = 0;
+
+                 // 验证 trigger_value 范围
+                 if (cfg_new.trigger_value != 0 && cfg_new.trigger_value != 1) {
+                      if(file_logger) SPDLOG_WARN("更新配置中 IO {} 的触发值 {} 无效，应为 0 或 1. 将设为默认值 1.", cfg_new.io_index, cfg_new.trigger_value);
+                      cfg_new.trigger_value = 1; // 修正无效的触发值
+                 }
+
+                 entries.push_back(std::move(cfg_new));
+                 if(file_logger) SPDLOG_DEBUG("已应用 IO {} 的新配置: 复位={}, 触发值={}, 描述='{}'",
+                                              entries.back().io_index, entries.back().reset_io_index, entries.back().trigger_value, entries.back().description);
+
+            } else {
+                if(file_logger) SPDLOG_WARN("更新配置中 IO {} 的复位 IO 索引 {} 无效，应在 0-2048 范围内. 跳过此配置条目.", cfg_in.io_index, cfg_in.reset_io_index);
+            }
+        } else {
+             if(file_logger) SPDLOG_WARN("更新配置向量中无效的 IO 索引 {}，应在 0-2048 范围内. 跳过条目.", cfg_in.io_index);
+        }
+    }
+}
+
+bool updateIOConfig(const std::vector<IOConfig>& config, int limited_speed) {
+    // 整个函数不再被一个大的 try-catch 包围
+    if (limited_speed < 0 || limited_speed > 100) {
+        if(file_logger) SPDLOG_WARN("更新时提供的限速值 {} 无效，应在 0-100 范围内.", limited_speed);
+        return false;
+    }
+
+    // 同一时间只允许一个配置修改请求，保证待安装配置最多只有一份
+    std::lock_guard<std::mutex> update_lock(config_update_mutex);
+
+    // 在锁外验证并构建完整的新配置表 (排序、索引映射、读取集合与掩码)，不占用 io_mutex
+    std::shared_ptr<PendingIOConfig> pending = std::make_shared<PendingIOConfig>();
+    pending->limited_speed = limited_speed;
+    if(file_logger) SPDLOG_DEBUG("开始构建新的 IO 配置表，共 {} 个条目.", config.size());
+    std::vector<IOConfig> entries;
+    build_io_entries(config, entries);
+    // 一次性排序并重建映射、读取集合与掩码 (重复的 io_index 以后者为准)
+    assign_io_entries(pending->table, std::move(entries));
+    if(file_logger) SPDLOG_DEBUG("新的 IO 配置表构建完成，共 {} 个有效条目.", pending->table.entries.size());
+
+    bool installed_by_monitor = submit_io_config(pending, LOCK_SITE_UPDATE_IO_CONFIG);
+    if(file_logger) SPDLOG_INFO("新的 IO 配置已生效 ({}). 配置的限速: {}%", installed_by_monitor ? "监测线程切换" : "直接安装", limited_speed);
+
+    // 监测线程将在下一循环基于新配置重新评估 already_triggered 标志，
+    // 并在需要时 (即如果当前系统状态为 LIMITED 且物理 IO 安全) 触发恢复.
+
+    // 由后台线程保存到文件，保存结果通过 get_config 的 config_sync 报告. pending 持有换出的旧表，在此线程离开函数时释放
+    uint64_t save_gen = request_config_save();
+    if(file_logger) SPDLOG_INFO("IO 配置已更新到内存，已请求保存 (代数 {}). 配置的限速: {}%", save_gen, limited_speed);
+    return true;
+}
+
+// 对外函数: 替换单元 cell 的全部 IO 配置，其他单元与未归属单元的 IO 及其触发状态不变.
+// 新条目不得属于其他单元，也不得与单元外已配置的 IO 重号 (单元外 IO 保护全部机器人，不会被悄悄收窄为单元内).
+// IO 表与单元归属经同一次切换安装. 限速值为整个进程共享，不随单元修改.
+bool updateCellIOConfig(const std::string& cell, const std::vector<IOConfig>& config, std::string& message) {
+    std::vector<IOConfig> cell_entries;
+    build_io_entries(config, cell_entries);
+
+    std::lock_guard<std::mutex> update_lock(config_update_mutex);
+    std::shared_ptr<const SafetyStatusSnapshot> snap = load_status_snapshot();
+    if (!snap) {
+        message = "服务未初始化";
+        return false;
+    }
+    std::vector<SafetyZone> zones = *safety_zones;
+    int z = find_zone(zones, cell);
+    if (z < 0) {
+        message = "单元 " + cell + " 不存在";
+        return false;
+    }
+    std::vector<int8_t> owner(2049, -1);
+    for (size_t k = 0; k < zones.size(); ++k) {
+        for (int io_index : zones[k].io_indices) owner[io_index] = static_cast<int8_t>(k);
+    }
+    std::vector<bool> configured(2049, false);
+    for (const auto& io : snap->io_states) configured[io.io_index] = true;
+    for (const auto& cfg : cell_entries) {
+        if (owner[cfg.io_index] >= 0 && owner[cfg.io_index] != z) {
+            message = "IO " + std::to_string(cfg.io_index) + " 属于单元 " + zones[owner[cfg.io_index]].name;
+            return false;
+        }
+        if (owner[cfg.io_index] < 0 && configured[cfg.io_index]) {
+            message = "IO " + std::to_string(cfg.io_index) + " 已配置为单元外 IO，请先移除";
+            return false;
+        }
+    }
+
+    std::vector<IOConfig> entries;
+    entries.reserve(snap->io_states.size() + cell_entries.size());
+    for (const auto& io : snap->io_states) {
+        if (owner[io.io_index] == z) continue;
+        IOConfig cfg(io.io_index, io.reset_io_index, io.trigger_value, status_description(*snap, io));
+        cfg.is_configured = true;
+        entries.push_back(std::move(cfg));
+    }
+    std::vector<int>& members = zones[z].io_indices;
+    members.clear();
+    for (const auto& cfg : cell_entries) members.push_back(cfg.io_index);
+    std::sort(members.begin(), members.end());
+    members.erase(std::unique(members.begin(), members.end()), members.end());
+    const std::shared_ptr<const RasterSafetyInstance> instance = zones[z].instance;
+    const size_t cell_io_count = members.size();
+    entries.insert(entries.end(), std::make_move_iterator(cell_entries.begin()), std::make_move_iterator(cell_entries.end()));
+
+    std::shared_ptr<PendingIOConfig> pending = std::make_shared<PendingIOConfig>();
+    pending->limited_speed = snap->limited_speed;
+    pending->replace_zones = true;
+    pending->zones = std::move(zones);
+    assign_io_entries(pending->table, std::move(entries)); // 排序，单元条目与其余条目不重号
+    bool installed_by_monitor = submit_io_config(pending, LOCK_SITE_UPDATE_IO_CONFIG);
+
+    if(file_logger) SPDLOG_INFO("单元 {} 的 IO 配置已生效 ({}): {} 个 IO", cell, installed_by_monitor ? "监测线程切换" : "直接安装", cell_io_count);
+    if (instance && instance->logger) instance->logger->info("单元 IO 配置已更新: {} 个 IO", cell_io_count);
+    request_config_save();
+    message = "单元 " + cell + " 的配置已更新，正在后台保存";
+    return true;
+}
+
+// 发布待安装配置并等待生效. 监测线程在下一周期开始时以一次交换接管；监测线程未运行或未及时接管时由本线程
+// 持 io_mutex 安装. 假定调用者已持有 config_update_mutex. 返回是否由监测线程安装.
+static bool submit_io_config(const std::shared_ptr<PendingIOConfig>& pending, LockSite site) {
+    std::atomic_store(&pending_io_config, pending);
+    bool installed_by_monitor = false;
+    if (thread_running) {
+        wake_monitor_thread();
+        std::unique_lock<std::mutex> install_lock(config_install_mutex);
+        installed_by_monitor = config_install_cv.wait_for(install_lock, std::chrono::milliseconds(IO_CONFIG_INSTALL_WAIT_MS),
+                                                         [&pending] { return pending->installed; });
+    }
+    if (!installed_by_monitor) {
+        ProfiledLock lock(io_mutex, site);
+        install_pending_io_config();
+    }
+    return installed_by_monitor;
+}
 
-    // 应用输入向量中的新配置
-    if(file_logger) SPDLOG_DEBUG("开始应用新的 IO 配置，共 {} 个条目.", config.size());
-    int applied_io_count = 0;
-    for (const auto& cfg_in : config) {
-        // 检查 IO 索引有效性
-        if (cfg_in.io_index >= 0 && cfg_in.io_index <= 2048) {
-            // 确保复位 IO 索引也有效或为 0
-            if (cfg_in.reset_io_index >= 0 && cfg_in.reset_io_index <= 2048) {
-                 // 创建新的 IOConfig 对象基于输入，但状态重置
-                 IOConfig cfg_new;
-                 cfg_new.io_index = cfg_in.io_index;
-                 cfg_new.reset_io_index = cfg_in.reset_io_index;
-                 cfg_new.trigger_value = cfg_in.trigger_value; // 存储 0 或 1
-                 cfg_new.description = cfg_in.description;
-                 cfg_new.is_configured = true; // 标记为已配置
-                 cfg_new.already_triggered = false; // 更新时总是重置
-                 cfg_new.trigger_time = 0;
+// 安装配置表: 继承触发/复位条件未变化条目的触发状态后与当前表交换. 假定调用者已持有 io_mutex.
+// 换出的旧表留在 pending 中，由其持有者在锁外释放.
+static void install_io_config(PendingIOConfig& pending) {
+    for (auto& cfg : pending.table.entries) {
+        int old_slot = io_table.slot_by_index[cfg.io_index];
+        if (old_slot < 0) continue;
+        const IOConfig& old = io_table.entries[old_slot];
+        // 触发/复位条件未变化的条目继承原触发状态，避免更新期间短暂掩盖正在生效的安全触发;
+        // 增量修改 (keep_trigger_state) 的同号条目一律继承，由监测线程按新条件重新评估
+        if (pending.keep_trigger_state ||
+            (old.reset_io_index == cfg.reset_io_index && old.trigger_value == cfg.trigger_value)) {
+            cfg.already_triggered = old.already_triggered;
+            cfg.trigger_time = old.trigger_time;
+        }
+    }
+    std::swap(io_table, pending.table);
+    sync_triggered_mask();
+    if (pending.replace_zones) {
+        install_safety_zones(std::move(pending.zones));
+    }
+    configured_limited_speed = pending.limited_speed;
+    publish_status_snapshot();
+}
 
-                 // 验证 trigger_value 范围
-                 if (cfg_new.trigger_value != 0 && cfg_new.trigger_value != 1) {
-                      if(file_logger) SPDLOG_WARN("更新配置中 IO {} 的触发值 {} 无效，应为 0 或 1. 将设为默认值 1.", cfg_new.io_index, cfg_new.trigger_value);
-                      cfg_new.trigger_value = 1; // 修正无效的触发值
-                 }
+// 若有待安装的配置则取出并安装，通知等待中的更新请求. 假定调用者已持有 io_mutex.
+static bool install_pending_io_config() {
+    std::shared_ptr<PendingIOConfig> pending = std::atomic_exchange(&pending_io_config, std::shared_ptr<PendingIOConfig>());
+    if (!pending) {
+        return false;
+    }
+    install_io_config(*pending);
+    {
+        std::lock_guard<std::mutex> install_lock(config_install_mutex);
+        pending->installed = true;
+    }
+    config_install_cv.notify_all();
+    return true;
+}
 
+// 应用一组增量 IO 配置修改. 全部验证通过才修改 (任一条目无效则整体拒绝).
+// 以最新发布的状态快照为基础在锁外构建完整的新配置表，经与 updateIOConfig 相同的切换路径安装，不占用 io_mutex.
+// 未修改的条目及被 patch 的条目均保留 already_triggered 状态 (keep_trigger_state)，由监测线程下一周期按新条件重新评估.
+// cell 非空时只修改该单元: add 的 IO 加入单元且不得属于其他单元，remove/patch 的 IO 须属于该单元; 单元归属随配置表一起安装.
+static bool apply_io_config_edits(const std::vector<IOConfigEdit>& edits, const std::string& cell, std::string& message) {
+    std::lock_guard<std::mutex> update_lock(config_update_mutex); // 持有期间配置不会被其他请求替换
+    std::shared_ptr<const SafetyStatusSnapshot> snap = load_status_snapshot();
+    if (!snap) {
+        message = "服务未初始化";
+        return false;
+    }
+    std::vector<SafetyZone> zones;
+    std::vector<int8_t> owner;
+    int z = -1;
+    if (!cell.empty()) {
+        zones = *safety_zones;
+        z = find_zone(zones, cell);
+        if (z < 0) {
+            message = "单元 " + cell + " 不存在";
+            return false;
+        }
+        owner.assign(2049, -1);
+        for (size_t k = 0; k < zones.size(); ++k) {
+            for (int io_index : zones[k].io_indices) owner[io_index] = static_cast<int8_t>(k);
+        }
+    }
 
-                 io_list_indexed[cfg_new.io_index] = cfg_new; // 存储到索引列表
-                 applied_io_count++;
-                 if(file_logger) {
-                     std::string debug_msg = "已应用 IO " + std::to_string(cfg_new.io_index) + " 的新配置: 复位=" + std::to_string(cfg_new.reset_io_index) +
-                                             ", 触发值=" + std::to_string(cfg_new.trigger_value) + ", 描述='" + cfg_new.description + "'";
-                     SPDLOG_DEBUG(debug_msg);
-                 }
+    // 验证: add 要求未配置，remove/patch 要求已配置. 同一请求内按顺序模拟配置集合的变化
+    std::vector<bool> configured(2049, false);
+    for (const auto& io : snap->io_states) {
+        configured[io.io_index] = true;
+    }
+    for (const auto& edit : edits) {
+        if (z >= 0 && edit.type == IO_EDIT_ADD && owner[edit.io_index] >= 0 && owner[edit.io_index] != z) {
+            message = "IO " + std::to_string(edit.io_index) + " 属于单元 " + zones[owner[edit.io_index]].name;
+            return false;
+        }
+        if (z >= 0 && edit.type != IO_EDIT_ADD && owner[edit.io_index] != z) {
+            message = "IO " + std::to_string(edit.io_index) + " 不属于单元 " + cell;
+            return false;
+        }
+        if (edit.type == IO_EDIT_ADD) {
+            if (configured[edit.io_index]) {
+                message = "IO " + std::to_string(edit.io_index) + " 已配置";
+                return false;
+            }
+            configured[edit.io_index] = true;
+        } else {
+            if (!configured[edit.io_index]) {
+                message = "IO " + std::to_string(edit.io_index) + " 未配置";
+                return false;
+            }
+            if (edit.type == IO_EDIT_REMOVE) {
+                configured[edit.io_index] = false;
+            }
+        }
+    }
 
-            } else {
-                if(file_logger) SPDLOG_WARN("更新配置中 IO {} 的复位 IO 索引 {} 无效，应在 0-2048 范围内. 跳过此配置条目.", cfg_in.io_index, cfg_in.reset_io_index);
+    // 快照条目按 io_index 升序，修改过程中保持有序
+    std::vector<IOConfig> entries;
+    entries.reserve(snap->io_states.size() + edits.size());
+    for (const auto& io : snap->io_states) {
+        IOConfig cfg(io.io_index, io.reset_io_index, io.trigger_value, status_description(*snap, io));
+        cfg.is_configured = true;
+        entries.push_back(std::move(cfg));
+    }
+    auto find_entry = [&entries](int io_index) {
+        return std::lower_bound(entries.begin(), entries.end(), io_index,
+                                [](const IOConfig& io, int index) { return io.io_index < index; });
+    };
+    for (const auto& edit : edits) {
+        if (edit.type == IO_EDIT_ADD) {
+            IOConfig cfg(edit.io_index, edit.reset_io_index, edit.trigger_value, edit.description);
+            cfg.is_configured = true;
+            cfg.already_triggered = false;
+            cfg.trigger_time = 0;
+            if(file_logger) SPDLOG_INFO("[增量配置] 添加 IO {}: 复位={}, 触发值={}, 描述='{}'",
+                                        cfg.io_index, cfg.reset_io_index, cfg.trigger_value, cfg.description);
+            entries.insert(find_entry(edit.io_index), std::move(cfg));
+        } else if (edit.type == IO_EDIT_REMOVE) {
+            auto it = find_entry(edit.io_index);
+            auto state = std::lower_bound(snap->io_states.begin(), snap->io_states.end(), edit.io_index,
+                                          [](const IOStatusEntry& io, int index) { return io.io_index < index; });
+            if (state != snap->io_states.end() && state->io_index == edit.io_index && state->already_triggered) {
+                if(file_logger) SPDLOG_WARN("[增量配置] 删除的 IO {} 当前处于已触发状态，其触发标志随配置一同移除.", edit.io_index);
             }
+            entries.erase(it);
+            if(file_logger) SPDLOG_INFO("[增量配置] 删除 IO {}.", edit.io_index);
         } else {
-             if(file_logger) SPDLOG_WARN("更新配置向量中无效的 IO 索引 {}，应在 0-2048 范围内. 跳过条目.", cfg_in.io_index);
+            IOConfig& cfg = *find_entry(edit.io_index);
+            if (edit.has_reset_io_index) cfg.reset_io_index = edit.reset_io_index;
+            if (edit.has_trigger_value) cfg.trigger_value = edit.trigger_value;
+            if (edit.has_description) cfg.description = edit.description;
+            if(file_logger) SPDLOG_INFO("[增量配置] 修改 IO {}: 复位={}, 触发值={}, 描述='{}'",
+                                        cfg.io_index, cfg.reset_io_index, cfg.trigger_value, cfg.description);
         }
     }
-    if(file_logger) SPDLOG_DEBUG("新的 IO 配置已应用到内存，共 {} 个有效条目.", applied_io_count);
 
+    std::shared_ptr<PendingIOConfig> pending = std::make_shared<PendingIOConfig>();
+    pending->limited_speed = snap->limited_speed;
+    pending->keep_trigger_state = true;
+    std::shared_ptr<const RasterSafetyInstance> instance;
+    if (z >= 0) {
+        std::vector<int>& members = zones[z].io_indices;
+        for (const auto& edit : edits) {
+            if (edit.type == IO_EDIT_ADD) {
+                members.push_back(edit.io_index);
+            } else if (edit.type == IO_EDIT_REMOVE) {
+                members.erase(std::remove(members.begin(), members.end(), edit.io_index), members.end());
+            }
+        }
+        std::sort(members.begin(), members.end());
+        members.erase(std::unique(members.begin(), members.end()), members.end());
+        instance = zones[z].instance;
+        pending->replace_zones = true;
+        pending->zones = std::move(zones);
+    }
+    assign_io_entries(pending->table, std::move(entries));
+    submit_io_config(pending, LOCK_SITE_IO_EDIT);
 
-    // 保存到文件
-    bool saved = save_to_file(); // save_to_file 内部获取 mutex，此处没问题
+    if (instance && instance->logger) instance->logger->info("单元 IO 增量修改已生效: {} 个条目", edits.size());
+    request_config_save();
+    message = "配置已更新";
+    return true;
+}
 
-    // 监测线程将在下一循环检测到所有 already_triggered 标志已清除，
-    // 并在需要时 (即如果当前系统状态为 LIMITED 且物理 IO 安全) 触发恢复.
+// 从请求解析增量修改. add_io / patch_io 使用 config_data 对象数组，remove_io 使用 io_indices 整数数组.
+// 与 update_config 不同，无效字段不做修正，整个请求被拒绝.
+static bool parse_io_config_edits(const Json::Value& root, IOConfigEditType type,
+                                  std::vector<IOConfigEdit>& edits, std::string& message) {
+    if (type == IO_EDIT_REMOVE) {
+        if (!root.isMember("io_indices") || !root["io_indices"].isArray() || root["io_indices"].empty()) {
+            message = "缺少或无效参数 io_indices";
+            return false;
+        }
+        for (const auto& item : root["io_indices"]) {
+            if (!item.isInt() || item.asInt() < 0 || item.asInt() > 2048) {
+                message = "io_indices 中存在无效的 IO 索引";
+                return false;
+            }
+            IOConfigEdit edit;
+            edit.type = IO_EDIT_REMOVE;
+            edit.io_index = item.asInt();
+            edits.push_back(edit);
+        }
+        return true;
+    }
 
-    if (saved) {
-        if(file_logger) {
-            std::string log_msg = "IO 配置已成功更新到内存和文件. 配置的限速: " + std::to_string(limited_speed) + "%";
-            SPDLOG_INFO(log_msg);
+    if (!root.isMember("config_data") || !root["config_data"].isArray() || root["config_data"].empty()) {
+        message = "缺少或无效参数 config_data";
+        return false;
+    }
+    for (const auto& item : root["config_data"]) {
+        if (!item.isObject() || !item.isMember("io_index") || !item["io_index"].isInt() ||
+            item["io_index"].asInt() < 0 || item["io_index"].asInt() > 2048) {
+            message = "config_data 中存在缺少或无效 io_index 的条目";
+            return false;
         }
-    } else {
-         if(file_logger) {
-             std::string error_msg = "IO 配置已更新到内存，但保存到文件失败: " + CONFIG_DIR + "/" + CONFIG_FILE_NAME + ". 配置在内存中已激活.";
-             SPDLOG_ERROR(error_msg);
-         }
+        IOConfigEdit edit;
+        edit.type = type;
+        edit.io_index = item["io_index"].asInt();
+        if (item.isMember("reset_io_index")) {
+            if (!item["reset_io_index"].isInt() || item["reset_io_index"].asInt() < 0 || item["reset_io_index"].asInt() > 2048) {
+                message = "IO " + std::to_string(edit.io_index) + " 的 reset_io_index 无效";
+                return false;
+            }
+            edit.has_reset_io_index = true;
+            edit.reset_io_index = item["reset_io_index"].asInt();
+        }
+        if (item.isMember("trigger_value")) {
+            if (!item["trigger_value"].isInt() || (item["trigger_value"].asInt() != 0 && item["trigger_value"].asInt() != 1)) {
+                message = "IO " + std::to_string(edit.io_index) + " 的 trigger_value 应为 0 或 1";
+                return false;
+            }
+            edit.has_trigger_value = true;
+            edit.trigger_value = item["trigger_value"].asInt();
+        }
+        if (item.isMember("description")) {
+            if (!item["description"].isString()) {
+                message = "IO " + std::to_string(edit.io_index) + " 的 description 类型错误";
+                return false;
+            }
+            edit.has_description = true;
+            edit.description = item["description"].asString();
+        }
+        edits.push_back(edit);
     }
-    return saved; // 返回保存状态
-    // 返回时释放 Mutex
+    return true;
 }
 
-// 对外函数: 清除内部触发标志并尝试恢复机器人运行
-bool resetSpeed() {
-    std::lock_guard<std::mutex> lock(io_mutex); // 保护 io_list_indexed 和状态
-
-    SPDLOG_INFO("[复位] 收到外部 resetSpeed 命令.");
+// 执行人工复位: 清除所有内部触发标志，再基于 snapshot 检查物理状态，安全时转换为 NORMAL 并投递恢复.
+// 结果写入 result (报警通知由请求线程在锁外发送). 假定调用者已持有 io_mutex.
+static void apply_manual_reset(const IOSnapshot& snapshot, PendingReset& result) {
+    if (!result.zone.empty()) {
+        const auto& zones = *safety_zones;
+        for (size_t z = 0; z < zones.size(); ++z) {
+            if (zones[z].name == result.zone) {
+                apply_zone_reset(snapshot, static_cast<int>(z), result);
+                return;
+            }
+        }
+        result.zone_found = false; // 请求提交后区域定义已被替换
+        result.success = false;
+        return;
+    }
 
     bool was_limited = (current_system_state.load(std::memory_order_acquire) == SYSTEM_STATE_LIMITED);
     bool trigger_flags_cleared = false;
@@ -769,18 +5160,17 @@ bool resetSpeed() {
     // 步骤 1: 清除所有已配置 IO 的内部 `already_triggered` 标志.
     // 这允许状态机评估 *当前* 物理状态.
     if(file_logger) SPDLOG_DEBUG("开始清除所有已配置 IO 的内部触发标志...");
-    for (auto& io : io_list_indexed) {
-        if (io.is_configured && io.already_triggered) {
+    for (auto& io : io_table.entries) {
+        if (io.already_triggered) {
             io.already_triggered = false;
             io.trigger_time = 0; // 重置触发时间
             trigger_flags_cleared = true;
-            if(file_logger) {
-                 std::string log_msg = "[复位] 已清除 IO " + std::to_string(io.io_index) + " (描述: " + io.description + ") 的内部触发标志.";
-                 SPDLOG_INFO(log_msg);
-            }
+            if(file_logger) SPDLOG_INFO("[复位] 已清除 IO {} (描述: {}) 的内部触发标志.", io.io_index, io.description);
         }
     }
 
+    sync_triggered_mask(); // 保持评估内核的已触发掩码与标志一致
+
     if (!trigger_flags_cleared) {
         if(file_logger) SPDLOG_INFO("[复位] 调用 resetSpeed 时没有内部触发标志被设置.");
     } else {
@@ -791,33 +5181,21 @@ bool resetSpeed() {
     // 步骤 2: 立即检查所有已配置 IO 的 *当前* 物理状态.
     // 如果 *没有* IO 当前满足其触发条件，则启动恢复.
     // 这防止了在安全条件仍然物理存在时立即恢复.
+    // 检查与重新设置标志都基于同一快照
     bool any_io_currently_meets_trigger = false;
     int still_triggered_io_index = -1; // 用于记录哪个仍然触发
-    std::string still_triggered_io_desc; // 用于记录描述
-    // bool still_triggered_io_current_value = false; // 未使用
-    // int still_triggered_io_trigger_value = -1; // 未使用
 
     if(file_logger) SPDLOG_DEBUG("检查当前物理 IO 状态，确认是否有 IO 仍在触发...");
-    for (const auto& io : io_list_indexed) {
-        if (io.is_configured) {
-            // IO索引已经验证过在0-2048范围内，可以安全调用read_io
-            bool current_value = read_io(io.io_index);
-            bool meets_trigger_condition = (current_value == (io.trigger_value == 1));
-            if (meets_trigger_condition) {
-                any_io_currently_meets_trigger = true;
-                still_triggered_io_index = io.io_index;
-                still_triggered_io_desc = io.description;
-                // still_triggered_io_current_value = current_value; // 未使用
-                // still_triggered_io_trigger_value = io.trigger_value; // 未使用
-
-                if(file_logger) {
-                    std::string warn_msg = "[复位] IO " + std::to_string(io.io_index) + " (描述: " + io.description +
-                                           ") 仍然满足其触发条件 (当前值 " + (current_value ? "1" : "0") +
-                                           " == 触发值 " + std::to_string(io.trigger_value) + "), 无法恢复.";
-                    SPDLOG_WARN(warn_msg);
-                }
-                break; // 找到一个活动的触发，无需检查其他
-            }
+    for (const auto& io : io_table.entries) {
+        bool current_value = snapshot.values[io.io_index];
+        bool meets_trigger_condition = (current_value == (io.trigger_value == 1));
+        if (meets_trigger_condition) {
+            any_io_currently_meets_trigger = true;
+            still_triggered_io_index = io.io_index;
+
+            if(file_logger) SPDLOG_WARN("[复位] IO {} (描述: {}) 仍然满足其触发条件 (当前值 {} == 触发值 {}), 无法恢复.",
+                                        io.io_index, io.description, current_value ? 1 : 0, io.trigger_value);
+            break; // 找到一个活动的触发，无需检查其他
         }
     }
 
@@ -830,47 +5208,58 @@ bool resetSpeed() {
              if (current_system_state.load(std::memory_order_acquire) == SYSTEM_STATE_LIMITED) { // 在锁下再次检查
                   current_system_state.store(SYSTEM_STATE_NORMAL, std::memory_order_release);
                   if(file_logger) SPDLOG_INFO("[复位] 所有安全条件当前均已解除，启动机器人恢复.");
-                  resume_robots(); // 状态转换动作 (在锁定区域内)
+                  EventRecord ev = make_event(EVENT_MANUAL_RESET);
+                  ev.from_state = SYSTEM_STATE_LIMITED;
+                  ev.to_state = SYSTEM_STATE_NORMAL;
+                  append_event(ev);
+                  const auto now = std::chrono::steady_clock::now();
+                  const uint32_t released = limited_robot_mask.exchange(0);
+                  const uint32_t released_speed = speed_limited_robot_mask.exchange(0);
+                  applied_limited_speed = -1;
+                  // 状态转换动作交由动作执行线程执行
+                  if (released != 0) {
+                      post_action(ACTION_RESUME, false, now, now, -1, released, -1);
+                  }
+                  if (released_speed != 0) {
+                      post_action(ACTION_RESTORE_SPEED, false, now, now, -1, released_speed, -1);
+                  }
              } else {
                   if(file_logger) SPDLOG_INFO("[复位] 系统先前未处于安全受限状态，内部标志已清除.");
              }
         } else {
              if(file_logger) SPDLOG_INFO("[复位] 系统先前已处于正常状态，内部标志已清除.");
         }
+        publish_status_snapshot();
+        request_snapshot_save();
         // 成功: 触发标志已清除，恢复已尝试/无需恢复，因为物理条件安全
-        return true;
+        result.success = true;
     } else {
         // 如果有 IO 仍然物理触发，系统状态保持 LIMITED
         // (或者如果在 already_triggered 被清除后物理触发仍然存在，监测线程会在下一周期将其转回 LIMITED).
-        // 我们不恢复机器人.
-        if(file_logger) {
-             std::string warn_msg = "[复位] 收到外部复位请求，但安全条件仍在 IO " + std::to_string(still_triggered_io_index) + " (描述: " + still_triggered_io_desc + ") 上激活. 无法恢复机器人.";
-             SPDLOG_WARN(warn_msg);
-        }
-        // 向 HMI/用户发送错误报告
-        std::string alert_msg = "外部安全复位命令接收，但安全IO[" + std::to_string(still_triggered_io_index) + "]仍处于触发状态，无法恢复运行.";
-        NRC_TriggerErrorReport(2, alert_msg);
+        // 我们不恢复机器人. 向 HMI/用户的报警由请求线程发送.
+        result.success = false;
+        result.still_triggered_io = still_triggered_io_index;
+        EventRecord ev = make_event(EVENT_MANUAL_RESET);
+        ev.io_index = still_triggered_io_index;
+        ev.from_state = ev.to_state = SYSTEM_STATE_LIMITED; // 复位被拒绝，保持受限
+        ev.call_ret = -1;
+        append_event(ev);
 
         // Re-set already_triggered for the currently active physical triggers
         // This ensures the monitor thread keeps the system in LIMITED based on the current physical state
         {
              // No need to re-lock, we are already in a lock_guard
              if(file_logger) SPDLOG_DEBUG("[复位] 由于物理条件仍在触发，重新设置相关 IO 的 already_triggered 标志...");
-             for (auto& io : io_list_indexed) {
-                 if (io.is_configured) {
-                     // IO索引已经验证过在0-2048范围内，可以安全调用read_io
-                     bool current_value = read_io(io.io_index);
-                     bool meets_trigger_condition = (current_value == (io.trigger_value == 1));
-                     if (meets_trigger_condition && !io.already_triggered) {
-                          io.already_triggered = true;
-                          io.trigger_time = std::time(nullptr);
-                          if(file_logger) {
-                              std::string log_msg = "[复位] IO " + std::to_string(io.io_index) + " 仍然物理触发，重新设置 already_triggered 标志.";
-                              SPDLOG_WARN(log_msg);
-                          }
-                     }
+             for (auto& io : io_table.entries) {
+                 bool current_value = snapshot.values[io.io_index];
+                 bool meets_trigger_condition = (current_value == (io.trigger_value == 1));
+                 if (meets_trigger_condition && !io.already_triggered) {
+                      io.already_triggered = true;
+                      io.trigger_time = std::time(nullptr);
+                      if(file_logger) SPDLOG_WARN("[复位] IO {} 仍然物理触发，重新设置 already_triggered 标志.", io.io_index);
                  }
             }
+            sync_triggered_mask();
             // 如果系统状态不是 LIMITED，确保其反映物理实际
             if (current_system_state.load(std::memory_order_acquire) != SYSTEM_STATE_LIMITED) {
                  current_system_state.store(SYSTEM_STATE_LIMITED, std::memory_order_release);
@@ -882,10 +5271,125 @@ bool resetSpeed() {
             }
         }
 
+        publish_status_snapshot();
+        request_snapshot_save();
         // 失败: 内部触发标志已清除，但安全条件持续存在
+    }
+}
+
+// 执行区域复位: 只处理归属 zone 的 IO. 已解除触发的清除标志，仍满足触发条件的保持/重新设置标志;
+// 其他区域与未归属区域的 IO 不受影响. 受影响机器人的恢复由监测线程按区域调和 (监测线程执行复位时即在本周期).
+// 假定调用者已持有 io_mutex.
+static void apply_zone_reset(const IOSnapshot& snapshot, int zone, PendingReset& result) {
+    int still_triggered_io_index = -1;
+    for (auto& io : io_table.entries) {
+        if (zone_by_io[io.io_index] != zone) continue;
+        bool current_value = snapshot.values[io.io_index];
+        bool meets_trigger_condition = (current_value == (io.trigger_value == 1));
+        if (meets_trigger_condition) {
+            if (still_triggered_io_index < 0) {
+                still_triggered_io_index = io.io_index;
+            }
+            if (!io.already_triggered) {
+                io.already_triggered = true;
+                io.trigger_time = std::time(nullptr);
+            }
+            if(file_logger) SPDLOG_WARN("[复位] 区域 {} 的 IO {} (描述: {}) 仍然满足其触发条件，保持已触发.",
+                                        result.zone, io.io_index, io.description);
+        } else if (io.already_triggered) {
+            io.already_triggered = false;
+            io.trigger_time = 0;
+            if(file_logger) SPDLOG_INFO("[复位] 已清除区域 {} 的 IO {} (描述: {}) 的内部触发标志.",
+                                        result.zone, io.io_index, io.description);
+        }
+    }
+    sync_triggered_mask();
+
+    result.success = (still_triggered_io_index < 0);
+    result.still_triggered_io = still_triggered_io_index;
+    const SystemState state = current_system_state.load(std::memory_order_acquire);
+    EventRecord ev = make_event(EVENT_MANUAL_RESET);
+    ev.io_index = still_triggered_io_index;
+    ev.from_state = ev.to_state = static_cast<uint8_t>(state); // 系统状态由监测线程按剩余触发重新评估
+    ev.call_ret = result.success ? 0 : -1;
+    append_event(ev);
+    if(file_logger) SPDLOG_INFO("[复位] 区域 {} 复位{}.", result.zone, result.success ? "完成" : "被拒绝");
+
+    publish_status_snapshot();
+    request_snapshot_save();
+}
+
+// 若有待处理的人工复位请求则基于 snapshot 执行，并通知等待中的请求线程. 假定调用者已持有 io_mutex.
+static bool run_pending_reset(const IOSnapshot& snapshot) {
+    std::shared_ptr<PendingReset> request = std::atomic_exchange(&pending_reset, std::shared_ptr<PendingReset>());
+    if (!request) {
         return false;
     }
-    // 返回时释放 Mutex
+    apply_manual_reset(snapshot, *request);
+    {
+        std::lock_guard<std::mutex> install_lock(config_install_mutex);
+        request->done = true;
+    }
+    config_install_cv.notify_all();
+    return true;
+}
+
+// 提交人工复位请求并等待完成. 复位交由监测线程在下一周期读取 IO 后执行 (与 IO 评估使用同一快照，
+// 触发状态只由监测线程修改); 监测线程未运行或未及时处理时由本线程持 io_mutex 执行. 复位被拒绝时发送报警.
+static bool submit_manual_reset(const std::shared_ptr<PendingReset>& request) {
+    std::lock_guard<std::mutex> reset_lock(reset_request_mutex); // 同一时间最多一个待处理的复位请求
+
+    std::atomic_store(&pending_reset, request);
+    bool done_by_monitor = false;
+    if (thread_running) {
+        wake_monitor_thread();
+        std::unique_lock<std::mutex> install_lock(config_install_mutex);
+        done_by_monitor = config_install_cv.wait_for(install_lock, std::chrono::milliseconds(IO_CONFIG_INSTALL_WAIT_MS),
+                                                     [&request] { return request->done; });
+    }
+    if (!done_by_monitor) {
+        ProfiledLock lock(io_mutex, LOCK_SITE_RESET_SPEED);
+        if (std::atomic_load(&pending_reset)) { // 仍未被监测线程取走
+            IOSnapshot snapshot;
+            read_io_snapshot(io_table.read_set, snapshot); // IO索引已经验证过在0-2048范围内
+            run_pending_reset(snapshot);
+        }
+    }
+
+    if (!request->success && request->zone_found) {
+        if(file_logger) SPDLOG_WARN("[复位] 收到外部复位请求，但安全条件仍在 IO {} 上激活. 无法恢复机器人.",
+                                    request->still_triggered_io);
+        // 向 HMI/用户发送错误报告
+        std::string alert_msg = "外部安全复位命令接收，但安全IO[" + std::to_string(request->still_triggered_io) + "]仍处于触发状态，无法恢复运行.";
+        if (!request->zone.empty()) {
+            alert_msg = "区域 " + request->zone + " " + alert_msg;
+        }
+        controller().error_report(2, alert_msg);
+    }
+    return request->success;
+}
+
+// 对外函数: 清除内部触发标志并尝试恢复机器人运行
+bool resetSpeed() {
+    SPDLOG_INFO("[复位] 收到外部 resetSpeed 命令.");
+    return submit_manual_reset(std::make_shared<PendingReset>());
+}
+
+// 对外函数: 只复位一个安全区域 (单元). 该区域内已解除的 IO 清除触发标志，区域机器人的恢复由监测线程调和;
+// 其他区域与未归属区域的 IO 保持原触发状态. 区域不存在或仍有 IO 触发时返回 false，原因写入 message.
+bool resetSafetyZone(const std::string& zone, std::string& message) {
+    SPDLOG_INFO("[复位] 收到区域 {} 的复位命令.", zone);
+    std::shared_ptr<PendingReset> request = std::make_shared<PendingReset>();
+    request->zone = zone;
+    bool success = submit_manual_reset(request);
+    if (!request->zone_found) {
+        message = "区域 " + zone + " 不存在";
+    } else if (!success) {
+        message = "区域 " + zone + " 的 IO " + std::to_string(request->still_triggered_io) + " 仍处于触发状态";
+    } else {
+        message = "区域 " + zone + " 触发已重置，已尝试恢复";
+    }
+    return success;
 }
 
 bool getCurrentIOStatus(std::vector<bool>& status) {
@@ -896,8 +5400,16 @@ bool getCurrentIOStatus(std::vector<bool>& status) {
 
         // 如果 NRC_ReadTcpBoolVar 线程安全，则在互斥锁外读取 IO 是安全的，
         // 并且 IO 索引本身在读取过程中不会被重新配置中. 配置更改受互斥锁保护，因此整体读取是安全的.
-        for (int i = 0; i <= 2048; ++i) { // 循环到 2048
-             status[i] = read_io(i); // 读取每个可能 IO 的状态
+        // 先集中读取到快照，再转换输出，保证返回的是一次连续采样的结果.
+        static const std::vector<int> all_io_indices = [] {
+            std::vector<int> indices(2049);
+            for (int i = 0; i <= 2048; ++i) indices[i] = i; // 循环到 2048
+            return indices;
+        }();
+        IOSnapshot snapshot;
+        read_io_snapshot(all_io_indices, snapshot);
+        for (int i = 0; i <= 2048; ++i) {
+             status[i] = snapshot.values[i];
         }
 
         // if(file_logger) SPDLOG_DEBUG("已获取 2049 个 IO 的当前物理状态."); // 太啰嗦?
@@ -912,39 +5424,99 @@ bool getCurrentIOStatus(std::vector<bool>& status) {
 int getCurrentLimitedSpeed() {
     // 此函数返回 *配置的* 限速值.
     // 实际动作总是暂停 (速度 0).
-    std::lock_guard<std::mutex> lock(io_mutex); // 保护 configured_limited_speed
-    if(file_logger) SPDLOG_DEBUG("已获取当前配置的限速: {}%", configured_limited_speed);
-    return configured_limited_speed;
+    // 从最新发布的状态快照读取，不获取 io_mutex
+    auto snap = load_status_snapshot();
+    if (!snap) {
+        // 服务启动前尚未发布快照，回退到加锁读取
+        ProfiledLock lock(io_mutex, LOCK_SITE_LIMITED_SPEED); // 保护 configured_limited_speed
+        return configured_limited_speed;
+    }
+    if(file_logger) SPDLOG_DEBUG("已获取当前配置的限速: {}%", snap->limited_speed);
+    return snap->limited_speed;
 }
 
 std::vector<IOState> getTriggeredIOStates() {
-    std::lock_guard<std::mutex> lock(io_mutex); // 保护 io_list_indexed
     std::vector<IOState> states;
+    getTriggeredIOStates(states);
+    return states;
+}
 
-    // 根据内部 `already_triggered` 标志返回状态
+// 对外函数: 把当前已触发的 IO 写入调用者提供的 states，返回已触发数量.
+// states 的容量与各条目描述字符串的容量被复用，轮询方持有同一个 vector 反复调用时稳定后不再分配.
+int getTriggeredIOStates(std::vector<IOState>& states) {
+    // 根据最新发布的状态快照中的 `already_triggered` 标志返回状态，不获取 io_mutex
+    auto snap = load_status_snapshot();
+    if (!snap) {
+        states.clear();
+        return 0; // 服务启动前尚未发布快照，没有已触发的 IO
+    }
     if(file_logger) SPDLOG_DEBUG("准备获取当前标记为已触发 (already_triggered=true) 的 IO 列表...");
-    int triggered_count = 0;
-    for (const auto& io : io_list_indexed) {
-        if (io.is_configured && io.already_triggered) {
-            triggered_count++;
-            IOState state;
+    size_t triggered_count = 0;
+    for (const auto& io : snap->io_states) {
+        if (io.already_triggered) {
+            if (triggered_count == states.size()) {
+                states.emplace_back();
+            }
+            IOState& state = states[triggered_count++];
             state.io_index = io.io_index;
             state.reset_io_index = io.reset_io_index;
             state.is_triggered = io.already_triggered; // 此处应为 true
             state.trigger_time = io.trigger_time;
-            state.description = io.description;
-            states.push_back(state);
+            state.description.assign(status_description(*snap, io));
             if(file_logger) SPDLOG_DEBUG("找到已触发 IO: 索引 {}", io.io_index);
         }
     }
+    if (triggered_count < states.size()) {
+        states.erase(states.begin() + triggered_count, states.end());
+    }
 
     if(file_logger) SPDLOG_DEBUG("已获取 {} 个当前标记为已触发的 IO.", triggered_count);
-    return states;
+    return static_cast<int>(triggered_count);
 }
 
 // --- 服务生命周期函数 ---
 
+// 启动动作执行线程与监测线程. 配置已装载并发布快照后调用.
+static void start_safety_threads() {
+    // 启动控制器调用扇出线程 (供动作执行线程并发下发命令)
+    {
+        std::lock_guard<std::mutex> lock(controller_fanout.mutex);
+        controller_fanout.running = true;
+    }
+    for (auto& thread : controller_fanout.threads) {
+        thread = new std::thread(controller_fanout_thread);
+    }
+
+    // 启动动作执行线程 (须在监测线程之前，以便接收其投递的命令)
+    {
+        std::lock_guard<std::mutex> lock(action_mutex);
+        action_queue.reserve(ACTION_QUEUE_RESERVE);
+    }
+    action_thread_running = true;
+    action_thread = new std::thread(action_executor_thread);
+
+    // 启动运行状态刷新线程
+    {
+        std::lock_guard<std::mutex> lock(run_status_mutex);
+        run_status_running = true;
+        run_status_kicked = false;
+    }
+    run_status_thread = new std::thread(run_status_thread_func);
+
+    // 启动监测线程
+    thread_running = true;
+    monitor_thread = new std::thread(io_monitor_thread);
+    std::cout << "光栅安全控制线程启动成功" << std::endl;
+    if(file_logger) SPDLOG_INFO("光栅安全控制监测线程启动.");
+}
+
+// 分阶段启动: 日志 -> 从二进制快照装载配置并立即武装监测 -> (监测运行期间) 事件日志映射、
+// 无可用快照时解析 JSON、启动配置写入线程. 最后记录各阶段耗时.
+// 日志须在任何工作线程启动前完成，因为 file_logger 本身不是原子对象.
 void rasterSafetyService() {
+    const auto t_start = std::chrono::steady_clock::now();
+    monitor_armed_ns.store(0);
+
     // 忽略 SIGPIPE，防止写入关闭的 socket 时崩溃
     signal(SIGPIPE, SIG_IGN);
 
@@ -985,10 +5557,15 @@ void rasterSafetyService() {
         }
         if (log_init_success && file_sink) {
             std::vector<spdlog::sink_ptr> sinks{console_sink, file_sink};
-            file_logger = std::make_shared<spdlog::logger>("raster_safety", sinks.begin(), sinks.end());
+            // 异步模式: 调用线程只负责格式化并入队，控制台/文件写入与刷新都在后台日志线程完成
+            if (!spdlog::thread_pool()) {
+                spdlog::init_thread_pool(LOG_ASYNC_QUEUE_SIZE, 1);
+            }
+            file_logger = std::make_shared<spdlog::async_logger>("raster_safety", sinks.begin(), sinks.end(),
+                                                                 spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
             spdlog::register_logger(file_logger);
             file_logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] %v");
-            file_logger->flush_on(spdlog::level::info); // INFO 及以上立即刷新
+            file_logger->flush_on(spdlog::level::info); // INFO 及以上由后台线程立即刷新，不阻塞调用者
             spdlog::set_default_logger(file_logger);
             SPDLOG_INFO("光栅安全控制系统启动. 日志已初始化.");
         } else {
@@ -1002,36 +5579,74 @@ void rasterSafetyService() {
         std::cerr << "[光栅安全控制] 由于目录问题，文件日志未能完全初始化." << std::endl;
     }
 
-    // 加载配置
-    // 首次加载在此处发生. 后续更新通过 updateIOConfig.
+    const auto t_logger = std::chrono::steady_clock::now();
+
+    // 快速武装: 二进制快照可用时 (含最近触发状态) 立即装载并启动监测，不等待 JSON 解析与其余初始化
+    bool armed_from_snapshot = false;
     {
-        std::lock_guard<std::mutex> lock(io_mutex); // 保护配置加载
-        // load_from_file 自身会记录错误
-        if (!load_from_file()) {
-            std::cerr << "[光栅安全控制] 启动时配置文件读写存在问题." << std::endl;
-            // 继续使用 io_list_indexed 的默认构造函数加载的默认/空配置
-        } else {
-             std::cout << "[光栅安全控制] 配置文件加载成功." << std::endl;
-             if(file_logger) SPDLOG_INFO("配置文件加载成功.");
+        ProfiledLock lock(io_mutex, LOCK_SITE_SERVICE_START);
+        armed_from_snapshot = load_cached_config();
+        if (armed_from_snapshot) {
+            publish_status_snapshot();
         }
     }
+    if (armed_from_snapshot) {
+        start_safety_threads();
+    }
+    const auto t_snapshot = std::chrono::steady_clock::now();
 
+    // 映射事件日志. 失败时服务照常运行，仅不记录二进制事件. 追加以 ready 标志判断，可与监测线程并行完成.
+    if (!open_event_journal()) {
+        std::cerr << "[光栅安全控制] 事件日志初始化失败，将不记录二进制安全事件." << std::endl;
+    }
+    const auto t_journal = std::chrono::steady_clock::now();
 
-    // 在监测线程启动前，初始化受控机器人的 robot_states map 条目
-    {
-        std::lock_guard<std::mutex> lock(io_mutex);
-        for(int id : handled_robot_ids) {
-           getRobotState(id); // 确保 map 条目存在并获取初始状态
+    // 加载配置 (无可用快照时)
+    // 首次加载在此处发生. 后续更新通过 updateIOConfig.
+    if (!armed_from_snapshot) {
+        {
+            ProfiledLock lock(io_mutex, LOCK_SITE_SERVICE_START); // 保护配置加载
+            // load_from_file 自身会记录错误
+            if (!load_from_file()) {
+                std::cerr << "[光栅安全控制] 启动时配置文件读写存在问题." << std::endl;
+                // 继续使用 io_table 的默认/空配置
+            } else {
+                 std::cout << "[光栅安全控制] 配置文件加载成功." << std::endl;
+                 if(file_logger) SPDLOG_INFO("配置文件加载成功.");
+            }
+            publish_status_snapshot(); // 发布初始状态快照，查询接口从此不再需要 io_mutex
         }
+        start_safety_threads();
     }
+    const auto t_config = std::chrono::steady_clock::now();
 
+    // 启动配置写入线程 (启动期间累积的快照写入请求由其完成)
+    {
+        std::lock_guard<std::mutex> lock(config_save_mutex);
+        config_writer_running = true;
+    }
+    config_writer_thread = new std::thread(config_writer_thread_func);
+    {
+        std::lock_guard<std::mutex> lock(status_push_mutex);
+        status_push.running = true;
+    }
+    status_push_thread = new std::thread(status_push_thread_func);
+    const auto t_writer = std::chrono::steady_clock::now();
 
-    // 启动监测线程
-    thread_running = true;
-    // 确保在日志设置完成后创建线程
-    monitor_thread = new std::thread(io_monitor_thread);
-    std::cout << "光栅安全控制线程启动成功" << std::endl;
-    if(file_logger) SPDLOG_INFO("光栅安全控制监测线程启动.");
+    // 等待监测线程完成第一个评估周期后记录启动阶段耗时
+    auto to_ms = [](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / 1000.0;
+    };
+    for (int i = 0; i < 1000 && thread_running && monitor_armed_ns.load() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    int64_t armed_ns = monitor_armed_ns.load();
+    double armed_ms = armed_ns > 0 ? to_ms(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(armed_ns)) - t_start) : -1.0;
+    if(file_logger) SPDLOG_INFO("[启动耗时] 日志 {:.2f}ms, 快照装载 {:.2f}ms ({}), 事件日志 {:.2f}ms, JSON 配置 {:.2f}ms, 写入线程 {:.2f}ms; "
+                                "监测武装于启动后 {:.2f}ms, 全部完成 {:.2f}ms.",
+                                to_ms(t_logger - t_start), to_ms(t_snapshot - t_logger), armed_from_snapshot ? "已武装" : "不可用",
+                                to_ms(t_journal - t_snapshot), to_ms(t_config - t_journal), to_ms(t_writer - t_config),
+                                armed_ms, to_ms(t_writer - t_start));
 
 
     // 服务主循环 - 使主线程保持活动直到关机
@@ -1054,6 +5669,7 @@ void stopRasterSafetyService() {
 
     // 1. 通知监测线程停止
     thread_running = false; // 设置原子标志
+    wake_monitor_thread();  // 中断监测线程的周期等待
 
     // 2. 等待监测线程完成当前循环并退出
     if (monitor_thread != nullptr && monitor_thread->joinable()) {
@@ -1062,10 +5678,7 @@ void stopRasterSafetyService() {
         } else {
              std::cerr << "[光栅安全控制] 等待 IO 监测线程结束..." << std::endl;
         }
-        // 如果监测线程可能持有互斥锁，尝试在 join *之前* 获取锁可能会有帮助
-        // 尽管设置 thread_running=false 最终会使其退出循环，即使它处于 sleep 状态.
-        // 在复杂场景中，更好的方法是使用条件变量或中断机制.
-        // 对于这个简单的 sleep 循环，direct join 应该可行.
+        // 监测线程在条件变量上等待下一周期，上面的唤醒会使其立即检查 thread_running 并退出.
 
         monitor_thread->join(); // 阻塞直到线程函数返回
         if (file_logger) {
@@ -1085,15 +5698,85 @@ void stopRasterSafetyService() {
          }
     }
 
+    // 4. 停止运行状态刷新线程，然后停止动作执行线程 (先执行完已排队的命令)
+    if (run_status_thread != nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(run_status_mutex);
+            run_status_running = false;
+        }
+        run_status_cv.notify_all();
+        if (run_status_thread->joinable()) {
+            run_status_thread->join();
+        }
+        delete run_status_thread;
+        run_status_thread = nullptr;
+        if (file_logger) SPDLOG_INFO("[光栅安全控制] 运行状态刷新线程已结束.");
+    }
+    // 监测线程已退出，不再产生新命令
+    action_thread_running = false;
+    action_cv.notify_one();
+    if (action_thread != nullptr && action_thread->joinable()) {
+        if (file_logger) SPDLOG_INFO("[光栅安全控制] 等待动作执行线程结束...");
+        action_thread->join();
+        delete action_thread;
+        action_thread = nullptr;
+        if (file_logger) SPDLOG_INFO("[光栅安全控制] 动作执行线程已结束.");
+    }
+    // 动作执行线程已退出，不再有扇出任务
+    {
+        std::lock_guard<std::mutex> lock(controller_fanout.mutex);
+        controller_fanout.running = false;
+    }
+    controller_fanout.work_cv.notify_all();
+    for (auto& thread : controller_fanout.threads) {
+        if (thread != nullptr && thread->joinable()) {
+            thread->join();
+        }
+        delete thread;
+        thread = nullptr;
+    }
+
+    // 停止状态推送线程 (未发送的增量丢弃，HMI 重连后以 get_config 重新同步)
+    if (status_push_thread) {
+        {
+            std::lock_guard<std::mutex> lock(status_push_mutex);
+            status_push.running = false;
+            status_push.subscribed = false;
+            status_push.last_sent = nullptr;
+            status_push_subscribed.store(false);
+        }
+        status_push_cv.notify_all();
+        if (status_push_thread->joinable()) {
+            status_push_thread->join();
+        }
+        delete status_push_thread;
+        status_push_thread = nullptr;
+        if (file_logger) SPDLOG_INFO("[光栅安全控制] 状态推送线程已结束.");
+    }
+
+    // 停止配置写入线程 (写完尚未完成的保存请求后退出)
+    if (config_writer_thread) {
+        {
+            std::lock_guard<std::mutex> lock(config_save_mutex);
+            config_writer_running = false;
+        }
+        config_save_cv.notify_all();
+        if (file_logger) SPDLOG_INFO("[光栅安全控制] 等待配置写入线程结束...");
+        if (config_writer_thread->joinable()) {
+            config_writer_thread->join();
+        }
+        delete config_writer_thread;
+        config_writer_thread = nullptr;
+        if (file_logger) SPDLOG_INFO("[光栅安全控制] 配置写入线程已结束.");
+    }
+
     // --- 其他清理任务 (如果有) ---
     // Spdlog 清理 (可选，通常在退出时自动发生)
-     if (file_logger) {
-        file_logger->flush(); // 确保任何缓冲的日志已写入
-     }
     // spdlog::shutdown(); // 如果需要强制刷新/清理则调用
 
     if (file_logger) {
         SPDLOG_INFO("光栅安全控制服务已停止.");
+        file_logger->flush(); // 异步模式下请求后台线程写出队列中所有日志
     } else {
          std::cerr << "光栅安全控制服务已停止." << std::endl;
     }
@@ -1110,6 +5793,52 @@ static void handle_shutdown_signal(int signal_num) {
 }
 
 
+// 运行指标 (get_metrics 操作与基准测试程序共用). reset 为 true 时读取后清零全部直方图、去抖计数与锁统计
+Json::Value rasterSafetyGetMetrics(bool reset) {
+    const SafetyMetrics& m = safety_metrics;
+    Json::Value metrics(Json::objectValue);
+    metrics["trip_to_decision"] = histogram_to_json(m.trip_to_decision);
+    metrics["trip_queue_delay"] = histogram_to_json(m.trip_queue_delay);
+    metrics["trip_to_pause_call"] = histogram_to_json(m.trip_to_pause_call);
+    metrics["trip_to_paused"] = histogram_to_json(m.trip_to_paused);
+    metrics["trip_to_speed_limited"] = histogram_to_json(m.trip_to_speed_limited);
+    metrics["reset_to_decision"] = histogram_to_json(m.reset_to_decision);
+    metrics["reset_to_resume_call"] = histogram_to_json(m.reset_to_resume_call);
+    metrics["reset_to_resumed"] = histogram_to_json(m.reset_to_resumed);
+    metrics["cycle_duration"] = histogram_to_json(m.cycle_duration);
+    metrics["cycle_jitter"] = histogram_to_json(m.cycle_jitter);
+    Json::Value debounce(Json::objectValue);
+    debounce["filtered_trips"] = Json::UInt64(m.filtered_trips.load(std::memory_order_relaxed));
+    debounce["filtered_resets"] = Json::UInt64(m.filtered_resets.load(std::memory_order_relaxed));
+    Json::Value glitches(Json::arrayValue);
+    for (int io_index = 0; io_index <= 2048; ++io_index) {
+        uint32_t n = m.io_glitches[io_index].load(std::memory_order_relaxed);
+        if (n == 0) continue;
+        Json::Value item;
+        item["io_index"] = io_index;
+        item["glitches"] = n;
+        glitches.append(item);
+    }
+    debounce["io_glitches"] = glitches;
+    metrics["debounce"] = debounce;
+    metrics["io_mutex"] = lock_profile_to_json();
+
+    if (reset) {
+        SafetyMetrics& mm = safety_metrics;
+        LatencyHistogram* all[] = {&mm.trip_to_decision, &mm.trip_queue_delay, &mm.trip_to_pause_call, &mm.trip_to_paused,
+                                   &mm.trip_to_speed_limited,
+                                   &mm.reset_to_decision, &mm.reset_to_resume_call, &mm.reset_to_resumed,
+                                   &mm.cycle_duration, &mm.cycle_jitter};
+        for (auto* h : all) reset_histogram(*h);
+        mm.filtered_trips.store(0, std::memory_order_relaxed);
+        mm.filtered_resets.store(0, std::memory_order_relaxed);
+        for (auto& n : mm.io_glitches) n.store(0, std::memory_order_relaxed);
+        reset_lock_profile();
+        if(file_logger) SPDLOG_INFO("延迟统计已清零.");
+    }
+    return metrics;
+}
+
 // --- 请求处理函数 (来自 NRC Socket 回调) ---
 // root 参数现在预期是 {"operation": "...", ...} 这样的结构
 void rasterSafetyControl(const Json::Value &root) {
@@ -1124,7 +5853,7 @@ void rasterSafetyControl(const Json::Value &root) {
         response["reqRasterSafetyControlCB"] = Json::Value(Json::objectValue);
         response["reqRasterSafetyControlCB"]["status"] = false;
         response["reqRasterSafetyControlCB"]["message"] = "无效请求: 缺少或operation无效";
-        NRC_SendSocketCustomProtocal(0x927b, Json::FastWriter().write(response));
+        send_control_message(response);
         return;
     }
 
@@ -1135,7 +5864,54 @@ void rasterSafetyControl(const Json::Value &root) {
 
     if(file_logger) SPDLOG_INFO("收到光栅安全控制请求操作: {}", operation);
 
-    if (operation == "update_config") {
+    // 可选参数 cell: 单元名称. 带 cell 的 update_config / add_io / remove_io / patch_io / set_robot_config / get_config /
+    // reset_speed 只作用于该单元; 其余操作作用于整个进程，不接受 cell (add_cell 的 cell 为新单元名称)
+    std::string cell;
+    if (operation != "add_cell" && root.isMember("cell")) {
+        static const char* const process_wide_operations[] = {
+            "get_events", "get_metrics", "set_monitor_config", "set_debounce_config", "set_zone_config",
+            "subscribe", "unsubscribe", "set_lock_profiling"};
+        std::string message;
+        bool ok = true;
+        for (const char* name : process_wide_operations) {
+            if (operation == name) {
+                message = "操作 " + operation + " 作用于整个进程，不支持 cell 参数";
+                ok = false;
+            }
+        }
+        if (ok) ok = resolve_request_cell(root, cell, message);
+        if (!ok) {
+            if(file_logger) SPDLOG_WARN("光栅安全控制请求 {} 被拒绝: {}", operation, message);
+            response["reqRasterSafetyControlCB"]["status"] = false;
+            response["reqRasterSafetyControlCB"]["message"] = message;
+            send_control_message(response);
+            return;
+        }
+        response["reqRasterSafetyControlCB"]["cell"] = cell;
+    }
+
+    if (operation == "update_config" && !cell.empty()) {
+        // 单元配置: config_data 替换该单元的全部 IO. 限速值为整个进程共享，可省略; 给出时须与当前值相同
+        if (!root.isMember("config_data") || !root["config_data"].isArray() ||
+            (root.isMember("limited_speed") && !root["limited_speed"].isInt())) {
+            response["reqRasterSafetyControlCB"]["status"] = false;
+            response["reqRasterSafetyControlCB"]["message"] = "缺少或无效参数";
+        } else if (root.isMember("limited_speed") && root["limited_speed"].asInt() != getCurrentLimitedSpeed()) {
+            response["reqRasterSafetyControlCB"]["status"] = false;
+            response["reqRasterSafetyControlCB"]["message"] = "限速值为所有单元共享，请用不带 cell 的 update_config 修改";
+        } else {
+            std::vector<IOConfig> new_config_vec;
+            parse_io_config_items(root["config_data"], "更新单元配置", new_config_vec);
+            std::string message;
+            bool success = updateCellIOConfig(cell, new_config_vec, message);
+            if (!success) {
+                if(file_logger) SPDLOG_WARN("更新单元 {} 的配置失败: {}", cell, message);
+            }
+            response["reqRasterSafetyControlCB"]["status"] = success;
+            response["reqRasterSafetyControlCB"]["message"] = message;
+        }
+
+    } else if (operation == "update_config") {
         // 检查必要参数及其类型
         if (!root.isMember("limited_speed") || !root["limited_speed"].isInt() ||
             !root.isMember("config_data") || !root["config_data"].isArray())
@@ -1148,104 +5924,175 @@ void rasterSafetyControl(const Json::Value &root) {
             const Json::Value& config_data_json = root["config_data"];
 
             std::vector<IOConfig> new_config_vec;
-            // 从 Json::Value 解析到 vector<IOConfig> 并验证
+            // 从 Json::Value 直接解析到 vector<IOConfig> 并验证 (与配置文件共用同一解析)
             if(file_logger) SPDLOG_DEBUG("开始解析 config_data 数组，共 {} 个条目.", config_data_json.size());
-            int parsed_io_count = 0;
-            for (const auto& item : config_data_json) {
-                 if (!item.isObject()) {
-                      if(file_logger) SPDLOG_WARN("更新配置: config_data 数组中无效条目 (不是对象). 跳过.");
-                      continue;
-                 }
-                 if (!item.isMember("io_index") || !item["io_index"].isInt()) {
-                      if(file_logger) SPDLOG_WARN("更新配置: config_data 数组中无效条目 (缺少或无效 io_index). 跳过.");
-                      continue;
-                 }
-
-                 int io_index = item["io_index"].asInt();
-                 int reset_io_index = item.get("reset_io_index", 0).asInt(); // 默认 0
-                 int trigger_value_int = item.get("trigger_value", 1).asInt(); // 默认 1 (高电平)
-                 std::string description = item.get("description", "").asString();
-
-                 // 验证基本范围
-                 if (io_index < 0 || io_index > 2048) {
-                     if(file_logger) SPDLOG_WARN("更新配置: 配置条目中无效的 io_index {}. IO索引应在 0-2048 范围内. 跳过.", io_index);
-                     continue; // Skip invalid io_index
-                 }
-                 if (reset_io_index < 0 || reset_io_index > 2048) {
-                      if(file_logger) SPDLOG_WARN("更新配置: IO {} 的复位 io_index {} 无效，应在 0-2048 范围内. 为此条目将 reset_io_index设为 0.", io_index, reset_io_index);
-                      reset_io_index = 0; // Correct invalid reset index
-                 }
-                 if (trigger_value_int != 0 && trigger_value_int != 1) {
-                      if(file_logger) SPDLOG_WARN("更新配置: IO {} 的 trigger_value {} 无效. 应为 0 或 1. 使用默认值 1.", io_index, trigger_value_int);
-                      trigger_value_int = 1; // Correct invalid trigger value
-                 }
-
-
-                 // Create IOConfig and add to vector
-                 // IOConfig constructor takes int, but internally we use bool for trigger_value comparison
-                 IOConfig config(io_index, reset_io_index, trigger_value_int, description);
-                 new_config_vec.push_back(config);
-                 parsed_io_count++;
-                 if(file_logger) SPDLOG_DEBUG("已从请求中成功解析并添加 IO {} 到待更新列表.", io_index);
-            }
-            if(file_logger) SPDLOG_DEBUG("config_data 数组解析完成. 解析到 {} 个有效条目.", parsed_io_count);
-
+            parse_io_config_items(config_data_json, "更新配置", new_config_vec);
+            if(file_logger) SPDLOG_DEBUG("config_data 数组解析完成. 解析到 {} 个有效条目.", new_config_vec.size());
 
             // Call the internal update function with the validated vector
             bool success = updateIOConfig(new_config_vec, limited_speed);
             response["reqRasterSafetyControlCB"]["status"] = success;
-            response["reqRasterSafetyControlCB"]["message"] = success ? "配置已更新" : "配置更新失败 (请查看日志)";
+            response["reqRasterSafetyControlCB"]["message"] = success ? "配置已更新，正在后台保存" : "配置更新失败 (请查看日志)";
         }
 
     } else if (operation == "reset_speed") { // This means "reset triggers and attempt recovery"
-        // This operation does not require extra parameters in the request JSON
-        bool success = resetSpeed(); // Call the refactored reset function
-        response["reqRasterSafetyControlCB"]["status"] = success;
-        response["reqRasterSafetyControlCB"]["message"] = success ? "触发已重置，已尝试恢复" : "触发已重置，但安全条件仍然激活. 恢复失败.";
+        // 可选参数 zone (或 cell): 只复位该安全区域 (单元)，缺省复位全部
+        if (!cell.empty()) {
+            std::string message;
+            bool success = resetSafetyZone(cell, message);
+            response["reqRasterSafetyControlCB"]["status"] = success;
+            response["reqRasterSafetyControlCB"]["message"] = message;
+        } else if (root.isMember("zone")) {
+            if (!root["zone"].isString() || root["zone"].asString().empty()) {
+                response["reqRasterSafetyControlCB"]["status"] = false;
+                response["reqRasterSafetyControlCB"]["message"] = "无效参数 zone";
+                send_control_message(response);
+                return;
+            }
+            std::string message;
+            bool success = resetSafetyZone(root["zone"].asString(), message);
+            response["reqRasterSafetyControlCB"]["status"] = success;
+            response["reqRasterSafetyControlCB"]["message"] = message;
+            response["reqRasterSafetyControlCB"]["zone"] = root["zone"].asString();
+        } else {
+            bool success = resetSpeed(); // Call the refactored reset function
+            response["reqRasterSafetyControlCB"]["status"] = success;
+            response["reqRasterSafetyControlCB"]["message"] = success ? "触发已重置，已尝试恢复" : "触发已重置，但安全条件仍然激活. 恢复失败.";
+        }
         response["reqRasterSafetyControlCB"]["limited_speed"] = getCurrentLimitedSpeed(); // Return the configured speed value
         // Note: the actual speed is 0 if still limited, or back to normal run speed if successful.
 
     } else if (operation == "get_config") {
-        // This operation does not require extra parameters in the request JSON
-        response["reqRasterSafetyControlCB"]["status"] = true; // Assume success initially unless errors occur fetching data
-
-        response["reqRasterSafetyControlCB"]["limited_speed"] = getCurrentLimitedSpeed(); // Get the configured speed value
-
-        Json::Value config_data_array(Json::arrayValue);
-        std::vector<IOState> triggered_states = getTriggeredIOStates(); // Get currently triggered states (acquires internal lock)
-
-        // Access io_list_indexed to get all configured IOs (requires lock)
-        std::lock_guard<std::mutex> lock(io_mutex);
-        if(file_logger) SPDLOG_DEBUG("准备构建 get_config 响应的 config_data 数组...");
-        int configured_io_count = 0;
-        for (int i = 0; i < io_list_indexed.size(); ++i) {
-            const auto& io = io_list_indexed[i];
-            if (io.is_configured) {
-                configured_io_count++;
-                Json::Value item;
-                item["io_index"] = io.io_index;
-                item["trigger_value"] = io.trigger_value; // Return the stored int value (0 或 1)
-                item["reset_io_index"] = io.reset_io_index;
-                item["description"] = io.description;
-
-                // Check if this configured IO is present in the list of currently triggered states
-                bool is_currently_triggered = false;
-                for(const auto& triggered_io : triggered_states) {
-                    if (triggered_io.io_index == io.io_index) {
-                        is_currently_triggered = true;
-                        break;
-                    }
-                }
-                item["is_triggered"] = is_currently_triggered; // Add current triggered status
+        // Optional field: cell - 只返回该单元的 IO、机器人、区域与去抖配置
+        // 响应随 IO 数量增长，直接由快照写成文本发送，不经过 Json::Value
+        std::lock_guard<std::mutex> lock(control_writer_mutex);
+        write_config_response(operation, cell, control_text);
+        NRC_SendSocketCustomProtocal(0x927b, control_text.text());
+        return;
 
-                config_data_array.append(item);
-                if(file_logger) SPDLOG_DEBUG("添加到响应数组的已配置 IO: 索引 {}", io.io_index);
+    } else if (operation == "add_io" || operation == "remove_io" || operation == "patch_io") {
+        // add_io / patch_io: config_data (array of {io_index, reset_io_index, trigger_value, description}),
+        // patch_io 中除 io_index 外的字段均可省略; remove_io: io_indices (array of int)
+        IOConfigEditType type = operation == "add_io" ? IO_EDIT_ADD : (operation == "remove_io" ? IO_EDIT_REMOVE : IO_EDIT_PATCH);
+        std::vector<IOConfigEdit> edits;
+        std::string message;
+        bool success = parse_io_config_edits(root, type, edits, message) && apply_io_config_edits(edits, cell, message);
+        if (!success) {
+            if(file_logger) SPDLOG_WARN("增量配置 {} 失败: {}", operation, message);
+        }
+        response["reqRasterSafetyControlCB"]["status"] = success;
+        response["reqRasterSafetyControlCB"]["message"] = message;
+
+    } else if (operation == "get_events") {
+        // Optional fields: start_seq (uint, 从该序号向后翻页; 缺省返回最新的 limit 条), limit (int, 1-1000)
+        if (!event_journal.ready.load(std::memory_order_acquire)) {
+            response["reqRasterSafetyControlCB"]["status"] = false;
+            response["reqRasterSafetyControlCB"]["message"] = "事件日志不可用";
+        } else {
+            int limit = EVENT_QUERY_DEFAULT_LIMIT;
+            if (root.isMember("limit") && root["limit"].isInt()) {
+                limit = std::max(1, std::min(root["limit"].asInt(), EVENT_QUERY_MAX_LIMIT));
+            }
+            uint64_t latest = __atomic_load_n(&event_journal.header->next_seq, __ATOMIC_ACQUIRE);
+            uint64_t oldest = latest > EVENT_JOURNAL_CAPACITY ? latest - EVENT_JOURNAL_CAPACITY : 0;
+            uint64_t start = latest > uint64_t(limit) ? latest - limit : 0;
+            if (root.isMember("start_seq") && (root["start_seq"].isUInt64() || root["start_seq"].isUInt())) {
+                start = root["start_seq"].asUInt64();
             }
+            if (start < oldest) start = oldest;
+
+            Json::Value events(Json::arrayValue);
+            uint64_t seq = start;
+            EventRecord rec;
+            for (; seq < latest && events.size() < static_cast<Json::ArrayIndex>(limit); ++seq) {
+                if (!read_event(seq, rec)) continue; // 已被覆盖或未完成写入
+                Json::Value item(Json::objectValue);
+                item["seq"] = Json::UInt64(seq);
+                item["time_us"] = Json::Int64(rec.time_us);
+                item["type"] = event_type_name(rec.type);
+                item["io_index"] = rec.io_index;
+                item["robot_id"] = rec.robot_id;
+                item["from_state"] = rec.from_state == SYSTEM_STATE_LIMITED ? "LIMITED" : "NORMAL";
+                item["to_state"] = rec.to_state == SYSTEM_STATE_LIMITED ? "LIMITED" : "NORMAL";
+                item["call_ret"] = rec.call_ret;
+                item["status_after"] = rec.status_after;
+                item["confirm_ms"] = rec.confirm_ms;
+                events.append(item);
+            }
+            response["reqRasterSafetyControlCB"]["status"] = true;
+            response["reqRasterSafetyControlCB"]["events"] = events;
+            response["reqRasterSafetyControlCB"]["next_seq"] = Json::UInt64(seq);
+            response["reqRasterSafetyControlCB"]["oldest_seq"] = Json::UInt64(oldest);
+            response["reqRasterSafetyControlCB"]["latest_seq"] = Json::UInt64(latest);
+        }
+
+    } else if (operation == "get_metrics") {
+        // Optional field: reset (bool) - clear all histograms after reading
+        bool reset = root.isMember("reset") && root["reset"].isBool() && root["reset"].asBool();
+        response["reqRasterSafetyControlCB"]["status"] = true;
+        response["reqRasterSafetyControlCB"]["metrics"] = rasterSafetyGetMetrics(reset);
+
+    } else if (operation == "set_monitor_config") {
+        // Optional fields: period_ms, fast_period_ms, event_watchdog_ms, rt_priority, cpu_core, lock_memory, io_event_mode
+        std::string message;
+        bool success = update_monitor_settings(root, message);
+        response["reqRasterSafetyControlCB"]["status"] = success;
+        response["reqRasterSafetyControlCB"]["message"] = message;
+
+    } else if (operation == "set_debounce_config") {
+        // Required field: io (array of {io_index, trigger_samples, trigger_min_ms, reset_holdoff_ms}); optional: max_delay_ms
+        std::string message;
+        bool success = update_debounce_config(root, message);
+        response["reqRasterSafetyControlCB"]["status"] = success;
+        response["reqRasterSafetyControlCB"]["message"] = message;
+
+    } else if (operation == "set_zone_config") {
+        // Required field: zones (array of {name, io_indices, robot_ids}; empty array disables zoning)
+        std::string message;
+        bool success = update_zone_config(root, message);
+        response["reqRasterSafetyControlCB"]["status"] = success;
+        response["reqRasterSafetyControlCB"]["message"] = message;
+
+    } else if (operation == "set_robot_config") {
+        // Required field: robot_ids (array of int, 1-31); optional: cell - 只更换该单元的机器人
+        std::string message;
+        bool success = cell.empty() ? update_robot_config(root, message) : update_cell_robots(cell, root, message);
+        response["reqRasterSafetyControlCB"]["status"] = success;
+        response["reqRasterSafetyControlCB"]["message"] = message;
+
+    } else if (operation == "add_cell") {
+        // Required fields: cell (string), robot_ids (array of int, 1-31); optional: action ("pause" / "limit_speed")
+        std::string message;
+        bool success = add_cell(root, message);
+        response["reqRasterSafetyControlCB"]["status"] = success;
+        response["reqRasterSafetyControlCB"]["message"] = message;
+
+    } else if (operation == "remove_cell") {
+        // Required field: cell
+        std::string message = "缺少参数 cell";
+        bool success = !cell.empty() && remove_cell(cell, message);
+        response["reqRasterSafetyControlCB"]["status"] = success;
+        response["reqRasterSafetyControlCB"]["message"] = message;
+
+    } else if (operation == "subscribe" || operation == "unsubscribe") {
+        // Optional field (subscribe): min_interval_ms (int, 10-10000). Deltas are pushed as operation "status_push"
+        // against base_version; call get_config after subscribing for the initial full state.
+        std::string message;
+        uint64_t base_version = 0;
+        bool subscribe = operation == "subscribe";
+        bool success = update_status_subscription(root, subscribe, base_version, message);
+        response["reqRasterSafetyControlCB"]["status"] = success;
+        response["reqRasterSafetyControlCB"]["message"] = message;
+        if (success && subscribe) {
+            response["reqRasterSafetyControlCB"]["base_version"] = Json::UInt64(base_version);
         }
-        if(file_logger) SPDLOG_DEBUG("config_data 数组构建完成. 添加了 {} 个已配置 IO.", configured_io_count);
-        response["reqRasterSafetyControlCB"]["config_data"] = config_data_array;
-        // No specific message for get_config success unless an error occurred.
-        // If getTriggeredIOStates or getCurrentLimitedSpeed failed, status would be false already.
+
+    } else if (operation == "set_lock_profiling") {
+        // Required field: enabled (bool); optional: log_interval_ms (int, 1000-3600000), reset (bool)
+        std::string message;
+        bool success = update_lock_profiling(root, message);
+        response["reqRasterSafetyControlCB"]["status"] = success;
+        response["reqRasterSafetyControlCB"]["message"] = message;
 
     } else {
         std::cerr << "[光栅安全控制] 未知的操作类型: " + operation << std::endl;
@@ -1254,6 +6101,6 @@ void rasterSafetyControl(const Json::Value &root) {
         response["reqRasterSafetyControlCB"]["message"] = "未知操作";
     }
 
-    // Send the response back using JsonCpp's writer
-    NRC_SendSocketCustomProtocal(0x927b, Json::FastWriter().write(response));
+    // Send the response back through the shared writer
+    send_control_message(response);
 }
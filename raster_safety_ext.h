@@ -0,0 +1,48 @@
+/**
+ * @file raster_safety_ext.h
+ * @brief 光栅安全服务扩展接口 - 控制器后端替换、仿真控制器、单元配置与复位、运行指标
+ *
+ * rasterSafety.h 之外的对外入口. 仿真器、基准测试与测试程序只需包含本头文件.
+ */
+
+#ifndef RASTER_SAFETY_EXT_H
+#define RASTER_SAFETY_EXT_H
+
+#include "rasterSafety.h"
+#include <json/json.h>
+#include <string>
+#include <vector>
+
+// 控制器后端 - 安全路径上的全部控制器调用 (IO 读取、运行状态、作业名、暂停/恢复、报警通知)
+// 都经由此函数表. 缺省指向 NRC_* 接口; 仿真器或基准测试程序可通过 rasterSafetySetBackend 替换.
+// 各函数可能被监测线程、动作执行线程与 socket 回调并发调用，实现需线程安全.
+struct RasterSafetyBackend {
+    bool (*read_io)(int io_index);                            // NRC_ReadTcpBoolVar
+    int (*get_run_status)(int robot_id);                      // NRC_Rbt_GetProgramRunStatus: 0 停止, 1 暂停, 2 运行
+    int (*get_open_job)(int robot_id, std::string& job_name); // NRC_GetCurrentOpenJob
+    int (*pause_job)(int robot_id);                           // NRC_Rbt_PauseRunJobfile
+    int (*start_job)(const char* job_name);                   // NRC_StartRunJobfile
+    void (*error_report)(int level, const std::string& message); // NRC_TriggerErrorReport
+};
+
+// IO 变化通知入口 (由控制器的 TCP 布尔变量变化回调调用)
+void rasterSafetyNotifyIOChange();
+// 速度倍率接口注册函数 (控制器提供速度倍率设置时由集成方调用，传入 nullptr 取消注册)
+void rasterSafetySetSpeedOverrideHandler(int (*handler)(int robot_id, int percent));
+// 控制器后端替换接口 (传入 nullptr 恢复 NRC 缺省后端)
+void rasterSafetySetBackend(const RasterSafetyBackend* backend);
+// 仿真控制器接口: 按 JSON 描述安装仿真后端 / 设置 IO 静态电平 / 恢复 NRC 后端
+bool rasterSafetyStartSimulation(const Json::Value& config, std::string& error);
+void rasterSafetySimSetIO(int io_index, bool level);
+void rasterSafetyStopSimulation();
+// 按安全区域 (单元) 复位: 只清除该区域内 IO 的触发标志，其他区域保持受限
+bool resetSafetyZone(const std::string& zone, std::string& message);
+// 替换单元 cell 的全部 IO 配置 (即带 cell 的 update_config)，其他单元与单元外的 IO 不变
+bool updateCellIOConfig(const std::string& cell, const std::vector<IOConfig>& config, std::string& message);
+// 写入调用者缓冲区的已触发 IO 查询 (周期性轮询的调用方复用同一个 vector)
+int getTriggeredIOStates(std::vector<IOState>& states);
+// 运行指标 (与 get_metrics 操作返回的 metrics 字段相同): 延迟直方图、去抖计数与 io_mutex 锁统计.
+// reset 为 true 时读取后清零
+Json::Value rasterSafetyGetMetrics(bool reset);
+
+#endif // RASTER_SAFETY_EXT_H
@@ -0,0 +1,141 @@
+/**
+ * @file alloc_test.cpp
+ * @brief 稳态零堆分配测试 - 在仿真控制器上运行服务，用计数的全局 operator new 验证无触发、
+ *        持续受限与缓冲区查询期间整个进程 (监测、动作执行、状态刷新与写入线程) 都不分配堆内存.
+ *
+ * 触发与复位的瞬间 (事件、通知消息) 允许分配，只打印计数不做断言.
+ * 服务会在当前目录下创建配置与日志目录，由 CTest 在构建目录中运行.
+ */
+
+#include "raster_safety_ext.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<long> allocations{0};
+
+const int SETTLE_MS = 500;  // 配置更换或状态转换后等待稳定 (含仿真暂停/恢复延迟与写入线程合并)
+const int WINDOW_MS = 1000; // 每个测量窗口
+// 触发/复位后的状态快照受最小写入间隔 (SNAPSHOT_SAVE_MIN_INTERVAL_MS, 5s) 限制，可能延后写入;
+// 状态转换后的稳态窗口要等它落盘之后再开始
+const int SNAPSHOT_SETTLE_MS = 6000;
+
+void sleep_ms(int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+long count_window() {
+    long before = allocations.load();
+    sleep_ms(WINDOW_MS);
+    return allocations.load() - before;
+}
+
+uint64_t cycle_count() {
+    return rasterSafetyGetMetrics(false)["cycle_duration"]["count"].asUInt64();
+}
+
+int failures = 0;
+
+// 稳态窗口: 要求监测线程确实在循环，且整个窗口内没有任何堆分配
+void expect_quiet(const char* name) {
+    uint64_t cycles_before = cycle_count();
+    long n = count_window();
+    uint64_t cycles = cycle_count() - cycles_before;
+    bool ok = n == 0 && cycles > 0;
+    std::fprintf(stderr, "[%s] %s: %ld 次分配, %llu 个监测周期\n", ok ? "PASS" : "FAIL", name, n,
+                 static_cast<unsigned long long>(cycles));
+    if (!ok) failures++;
+}
+
+void report_transition(const char* name, long n) {
+    std::fprintf(stderr, "[INFO] %s: %ld 次分配\n", name, n);
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+    Json::Value sim;
+    sim["call_latency_us"] = 100;
+    std::string error;
+    if (!rasterSafetyStartSimulation(sim, error)) {
+        std::fprintf(stderr, "仿真启动失败: %s\n", error.c_str());
+        return 1;
+    }
+    std::thread service(rasterSafetyService);
+    sleep_ms(SETTLE_MS);
+
+    std::vector<IOConfig> config;
+    for (int io = 1; io <= 64; ++io) {
+        config.push_back(IOConfig(io, 0, 1, "alloc test io " + std::to_string(io)));
+    }
+    config.push_back(IOConfig(100, 101, 1, "需要复位按钮的光栅，描述超出短字符串优化长度"));
+    updateIOConfig(config, 40);
+    sleep_ms(SETTLE_MS);
+
+    expect_quiet("无触发");
+
+    long before = allocations.load();
+    rasterSafetySimSetIO(100, true);
+    sleep_ms(SETTLE_MS);
+    report_transition("触发 IO 100", allocations.load() - before);
+    rasterSafetySimSetIO(100, false);
+    sleep_ms(SNAPSHOT_SETTLE_MS);
+
+    expect_quiet("持续受限");
+
+    std::vector<IOState> states;
+    getTriggeredIOStates(states);
+    before = allocations.load();
+    for (int i = 0; i < 100; ++i) getTriggeredIOStates(states);
+    long n = allocations.load() - before;
+    bool ok = n == 0 && states.size() == 1;
+    std::fprintf(stderr, "[%s] 100 次缓冲区查询: %ld 次分配, %zu 个已触发 IO\n", ok ? "PASS" : "FAIL", n, states.size());
+    if (!ok) failures++;
+
+    before = allocations.load();
+    rasterSafetySimSetIO(101, true);
+    sleep_ms(SETTLE_MS);
+    rasterSafetySimSetIO(101, false);
+    sleep_ms(SNAPSHOT_SETTLE_MS);
+    report_transition("复位 IO 101", allocations.load() - before);
+
+    expect_quiet("复位后");
+
+    rasterSafetyStopSimulation();
+    stopRasterSafetyService();
+    service.join();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file cell_test.cpp
+ * @brief 单元 (cell) 路由测试 - 在仿真控制器上验证按单元的配置、复位与移除互不影响，以及单元文件损坏后的恢复.
+ *
+ * 分两个阶段，由 CTest 依次在同一目录中运行:
+ *   first   - 带 cell 的 update_config / add_io 拒绝其他单元的 IO 与单元外的 IO; 按单元复位不清除其他单元的触发;
+ *             remove_cell 之后其他单元的 IO 与锁存的触发保持不变. 结束前等待二进制快照落盘.
+ *   restart - 损坏单元 A 的配置文件后重启，A 的 IO (含专用复位 IO) 从二进制快照恢复.
+ * IO 归属通过触发后的描述判断: 被拒绝的请求不改变原条目的描述.
+ */
+
+#include "raster_safety_ext.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int SETTLE_MS = 500; // 配置更换或状态转换后等待稳定 (含写入线程合并与仿真暂停/恢复延迟)
+// 状态快照受最小写入间隔 (SNAPSHOT_SAVE_MIN_INTERVAL_MS, 5s) 限制，结束前等它落盘
+const int SNAPSHOT_SETTLE_MS = 6000;
+const char* const CELL_A_FILE = "raster_config/cells/A.json";
+
+void sleep_ms(int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void control(const char* text) {
+    Json::Value request;
+    Json::Reader().parse(text, request);
+    rasterSafetyControl(request);
+}
+
+// 已触发 IO 的描述，未触发时返回空串
+std::string triggered_description(int io_index) {
+    static std::vector<IOState> states;
+    getTriggeredIOStates(states);
+    for (const auto& state : states) {
+        if (state.io_index == io_index && state.is_triggered) return state.description;
+    }
+    return std::string();
+}
+
+// 短暂置位 IO 并返回触发期间的描述 (未配置的 IO 不会触发，返回空串)，之后释放
+std::string probe(int io_index) {
+    rasterSafetySimSetIO(io_index, true);
+    sleep_ms(SETTLE_MS);
+    std::string description = triggered_description(io_index);
+    rasterSafetySimSetIO(io_index, false);
+    sleep_ms(SETTLE_MS);
+    return description;
+}
+
+// 置位后释放带专用复位 IO 的 IO，使其保持锁存
+void latch(int io_index) {
+    rasterSafetySimSetIO(io_index, true);
+    sleep_ms(SETTLE_MS);
+    rasterSafetySimSetIO(io_index, false);
+    sleep_ms(SETTLE_MS);
+}
+
+int failures = 0;
+
+void expect(bool ok, const char* name, const std::string& detail) {
+    std::fprintf(stderr, "[%s] %s: %s\n", ok ? "PASS" : "FAIL", name, detail.c_str());
+    if (!ok) failures++;
+}
+
+void expect_description(const char* name, const std::string& actual, const std::string& expected) {
+    expect(actual == expected, name, "描述 \"" + actual + "\", 期望 \"" + expected + "\"");
+}
+
+void run_first() {
+    control("{\"operation\":\"set_robot_config\",\"robot_ids\":[1,2]}");
+    std::vector<IOConfig> global;
+    global.push_back(IOConfig(5, 0, 1, "global"));
+    updateIOConfig(global, 40);
+    control("{\"operation\":\"add_cell\",\"cell\":\"A\",\"robot_ids\":[1]}");
+    control("{\"operation\":\"add_cell\",\"cell\":\"B\",\"robot_ids\":[2]}");
+    sleep_ms(SETTLE_MS);
+
+    std::string message;
+    std::vector<IOConfig> cell_a;
+    cell_a.push_back(IOConfig(10, 11, 1, "a10"));
+    expect(updateCellIOConfig("A", cell_a, message), "配置单元 A", message);
+    std::vector<IOConfig> cell_b;
+    cell_b.push_back(IOConfig(20, 0, 1, "b20"));
+    cell_b.push_back(IOConfig(21, 22, 1, "b21"));
+    expect(updateCellIOConfig("B", cell_b, message), "配置单元 B", message);
+
+    // 带 cell 的 update_config 不能占用其他单元或单元外的 IO
+    std::vector<IOConfig> steal_other = cell_a;
+    steal_other.push_back(IOConfig(20, 0, 1, "steal"));
+    expect(!updateCellIOConfig("A", steal_other, message), "单元 A 占用单元 B 的 IO 被拒绝", message);
+    std::vector<IOConfig> steal_global = cell_a;
+    steal_global.push_back(IOConfig(5, 0, 1, "steal"));
+    expect(!updateCellIOConfig("A", steal_global, message), "单元 A 占用单元外的 IO 被拒绝", message);
+    // add_io 同样拒绝
+    control("{\"operation\":\"add_io\",\"cell\":\"B\",\"config_data\":"
+            "[{\"io_index\":10,\"reset_io_index\":0,\"trigger_value\":1,\"description\":\"steal\"}]}");
+    control("{\"operation\":\"add_io\",\"cell\":\"A\",\"config_data\":"
+            "[{\"io_index\":5,\"reset_io_index\":0,\"trigger_value\":1,\"description\":\"steal\"}]}");
+    sleep_ms(SETTLE_MS);
+
+    expect_description("单元外 IO 5 保持原配置", probe(5), "global");
+    expect_description("单元 B 的 IO 20 保持原配置", probe(20), "b20");
+    latch(10);
+    expect_description("单元 A 的 IO 10 保持原配置", triggered_description(10), "a10");
+
+    // 按单元复位只清除该单元的触发
+    latch(21);
+    expect(resetSafetyZone("B", message), "复位单元 B", message);
+    sleep_ms(SETTLE_MS);
+    expect(triggered_description(21).empty(), "单元 B 的 IO 21 已复位", triggered_description(21));
+    expect_description("单元 A 的 IO 10 仍锁存", triggered_description(10), "a10");
+
+    // 移除单元 B 不影响单元 A 的 IO 与锁存的触发，也不影响单元外的 IO
+    latch(21);
+    control("{\"operation\":\"remove_cell\",\"cell\":\"B\"}");
+    sleep_ms(SETTLE_MS);
+    expect_description("移除单元 B 后 IO 10 仍锁存", triggered_description(10), "a10");
+    expect(triggered_description(21).empty(), "单元 B 的 IO 21 随单元移除", triggered_description(21));
+    expect(probe(20).empty(), "单元 B 的 IO 20 随单元移除", "");
+    expect_description("移除单元 B 后单元外 IO 5 保持原配置", probe(5), "global");
+
+    // 复位 IO 10，留给重启阶段验证
+    rasterSafetySimSetIO(11, true);
+    sleep_ms(SETTLE_MS);
+    rasterSafetySimSetIO(11, false);
+    expect(triggered_description(10).empty(), "IO 10 经复位 IO 11 复位", triggered_description(10));
+    sleep_ms(SNAPSHOT_SETTLE_MS);
+}
+
+void run_restart() {
+    expect_description("重启后单元 A 的 IO 10 从快照恢复", probe(10), "a10");
+    latch(10);
+    rasterSafetySimSetIO(11, true);
+    sleep_ms(SETTLE_MS);
+    rasterSafetySimSetIO(11, false);
+    expect(triggered_description(10).empty(), "恢复的 IO 10 经复位 IO 11 复位", triggered_description(10));
+    expect(probe(20).empty(), "已移除的单元 B 未恢复", "");
+    expect_description("单元外 IO 5 保持原配置", probe(5), "global");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const bool restart = argc > 1 && std::strcmp(argv[1], "restart") == 0;
+    if (restart) {
+        // 损坏单元 A 的配置文件 (服务启动前)
+        std::ofstream(CELL_A_FILE, std::ios::trunc) << "{ not json";
+    }
+
+    Json::Value sim;
+    sim["call_latency_us"] = 100;
+    std::string error;
+    if (!rasterSafetyStartSimulation(sim, error)) {
+        std::fprintf(stderr, "仿真启动失败: %s\n", error.c_str());
+        return 1;
+    }
+    std::thread service(rasterSafetyService);
+    sleep_ms(SETTLE_MS);
+
+    if (restart) {
+        run_restart();
+    } else {
+        run_first();
+    }
+
+    rasterSafetyStopSimulation();
+    stopRasterSafetyService();
+    service.join();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file debounce_test.cpp
+ * @brief 去抖触发延迟上界测试 - 在仿真控制器上用脉冲波形驱动配置了去抖的 IO，验证
+ *        孤立毛刺被滤除、低占空比抖动在 max_delay_ms 之后的下一个脉冲上被强制触发，且强制触发后抖动期间保持已触发
+ *        (无专用复位 IO 时不在暂停/恢复之间往复)，抖动停止后才复位.
+ *
+ * 监测周期设为 1ms，判定留有调度余量. 服务会在当前目录下创建配置与日志目录，由 CTest 在构建目录中运行.
+ */
+
+#include "raster_safety_ext.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int SETTLE_MS = 500;        // 配置更换或状态转换后等待稳定
+const int TEST_IO = 10;           // 被测 IO (自动复位: reset_io_index 为 0)
+const int MAX_DELAY_MS = 20;      // 去抖触发延迟上界
+const int PULSE_MS = 3;           // 抖动脉冲宽度，远小于 trigger_samples 个采样
+const int PULSE_PERIOD_MS = 15;   // 抖动周期 (间隔小于 MAX_DELAY_MS)
+const int SLACK_MS = 15;          // 调度与采样余量
+const int LATCH_WINDOW_MS = 300;  // 抖动持续期间观察的窗口
+
+using Clock = std::chrono::steady_clock;
+
+void sleep_ms(int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+int elapsed_ms(Clock::time_point since) {
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - since).count());
+}
+
+bool io_triggered() {
+    static std::vector<IOState> states;
+    getTriggeredIOStates(states);
+    for (const auto& state : states) {
+        if (state.io_index == TEST_IO && state.is_triggered) return true;
+    }
+    return false;
+}
+
+uint64_t filtered_trips() {
+    return rasterSafetyGetMetrics(false)["debounce"]["filtered_trips"].asUInt64();
+}
+
+// 重新安装仿真后端，被测 IO 使用给定脉冲波形 (pulse_ms 为 0 表示恒为 false)
+bool start_wave(int pulse_ms, int period_ms, int phase_ms) {
+    Json::Value sim;
+    sim["call_latency_us"] = 100;
+    if (pulse_ms > 0) {
+        Json::Value wave;
+        wave["io_index"] = TEST_IO;
+        wave["level"] = false;
+        wave["pulse_ms"] = pulse_ms;
+        wave["period_ms"] = period_ms;
+        wave["phase_ms"] = phase_ms;
+        sim["io"].append(wave);
+    }
+    std::string error;
+    if (!rasterSafetyStartSimulation(sim, error)) {
+        std::fprintf(stderr, "仿真启动失败: %s\n", error.c_str());
+        return false;
+    }
+    rasterSafetyNotifyIOChange();
+    return true;
+}
+
+int failures = 0;
+
+void expect(bool ok, const char* name, const std::string& detail) {
+    std::fprintf(stderr, "[%s] %s: %s\n", ok ? "PASS" : "FAIL", name, detail.c_str());
+    if (!ok) failures++;
+}
+
+} // namespace
+
+int main() {
+    if (!start_wave(0, 0, 0)) return 1;
+    std::thread service(rasterSafetyService);
+    sleep_ms(SETTLE_MS);
+
+    Json::Value monitor;
+    monitor["operation"] = "set_monitor_config";
+    monitor["period_ms"] = 1;
+    monitor["fast_period_ms"] = 1;
+    rasterSafetyControl(monitor);
+
+    std::vector<IOConfig> config;
+    config.push_back(IOConfig(TEST_IO, 0, 1, "debounce test io"));
+    updateIOConfig(config, 40);
+
+    // 触发需 8 个连续采样并持续 5ms: 3ms 的脉冲永远满足不了样本条件，只能经延迟上界触发
+    Json::Value debounce;
+    debounce["operation"] = "set_debounce_config";
+    debounce["max_delay_ms"] = MAX_DELAY_MS;
+    Json::Value entry;
+    entry["io_index"] = TEST_IO;
+    entry["trigger_samples"] = 8;
+    entry["trigger_min_ms"] = 5;
+    debounce["io"].append(entry);
+    rasterSafetyControl(debounce);
+    sleep_ms(SETTLE_MS);
+
+    // 孤立毛刺: 单个脉冲不触发，计入滤除的毛刺
+    uint64_t glitches_before = filtered_trips();
+    if (!start_wave(PULSE_MS, 0, 50)) return 1;
+    bool tripped = false;
+    for (int i = 0; i < 200 && !tripped; ++i) {
+        tripped = io_triggered();
+        sleep_ms(1);
+    }
+    uint64_t glitches = filtered_trips() - glitches_before;
+    expect(!tripped && glitches == 1, "孤立毛刺被滤除",
+           std::string(tripped ? "已触发" : "未触发") + ", 滤除毛刺 " + std::to_string(glitches) + " 次");
+
+    // 低占空比抖动: 自首个脉冲起到达 max_delay_ms 后的下一个脉冲上触发
+    if (!start_wave(PULSE_MS, PULSE_PERIOD_MS, 0)) return 1;
+    const Clock::time_point chatter_start = Clock::now();
+    int trip_ms = -1;
+    while (elapsed_ms(chatter_start) < 500) {
+        if (io_triggered()) {
+            trip_ms = elapsed_ms(chatter_start);
+            break;
+        }
+        sleep_ms(1);
+    }
+    expect(trip_ms >= 0 && trip_ms <= MAX_DELAY_MS + PULSE_PERIOD_MS + SLACK_MS, "抖动在延迟上界内触发",
+           "触发耗时 " + std::to_string(trip_ms) + "ms (max_delay_ms " + std::to_string(MAX_DELAY_MS) + "ms)");
+
+    // 强制触发锁存: 抖动持续期间不复位
+    int drops = 0;
+    bool was_triggered = true;
+    const Clock::time_point latch_start = Clock::now();
+    while (elapsed_ms(latch_start) < LATCH_WINDOW_MS) {
+        bool now_triggered = io_triggered();
+        if (was_triggered && !now_triggered) drops++;
+        was_triggered = now_triggered;
+        sleep_ms(1);
+    }
+    expect(trip_ms >= 0 && drops == 0 && was_triggered, "抖动期间保持已触发",
+           std::to_string(LATCH_WINDOW_MS) + "ms 内复位 " + std::to_string(drops) + " 次");
+
+    // 抖动停止后按保持期复位
+    if (!start_wave(0, 0, 0)) return 1;
+    const Clock::time_point quiet_start = Clock::now();
+    int reset_ms = -1;
+    while (elapsed_ms(quiet_start) < 500) {
+        if (!io_triggered()) {
+            reset_ms = elapsed_ms(quiet_start);
+            break;
+        }
+        sleep_ms(1);
+    }
+    expect(reset_ms >= 0, "抖动停止后复位", "复位耗时 " + std::to_string(reset_ms) + "ms");
+
+    rasterSafetyStopSimulation();
+    stopRasterSafetyService();
+    service.join();
+    return failures == 0 ? 0 : 1;
+}